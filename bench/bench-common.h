@@ -0,0 +1,47 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bench/bench-common.h
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#ifndef BENCH_COMMON_H_
+#define BENCH_COMMON_H_
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "all.h"
+#include "protos.h"
+
+/* Returns a monotonic timestamp in seconds */
+static inline double BenchNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Prints one result line: name, items, seconds and items/sec */
+static inline void BenchReport(const char *name, const char *unit, double items, double secs)
+{
+	printf("%-28s %12.0f %-8s %8.3f s %14.0f %s/s\n",
+		   name, items, unit, secs, secs > 0 ? items / secs : 0, unit);
+}
+
+/* Keeps the compiler from optimizing away benchmark results */
+extern volatile unsigned long bench_sink;
+
+/* benchmarks */
+
+void bench_propid(void);
+void bench_tree_build(void);
+void bench_save(void);
+void bench_snapshot(void);
+
+#endif /* BENCH_COMMON_H_ */
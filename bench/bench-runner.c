@@ -0,0 +1,61 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bench/bench-runner.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include "bench-common.h"
+
+#include <string.h>
+
+volatile unsigned long bench_sink;
+
+static const struct
+{
+	const char *name;
+	void (*func)(void);
+} benchmarks[] =
+{
+	{ "propid",	bench_propid },
+	{ "tree",	bench_tree_build },
+	{ "save",	bench_save },
+	{ "snapshot", bench_snapshot },
+	{ NULL,		NULL }
+};
+
+
+/**************************************************************************
+*** Function:	main
+***				Runs all benchmarks or only those given on the command line
+**************************************************************************/
+
+int main(int argc, char *argv[])
+{
+	int found = 0;
+
+	for(int i = 0; benchmarks[i].name; i++)
+	{
+		int run = argc < 2;
+		for(int j = 1; j < argc && !run; j++)
+			run = !strcmp(argv[j], benchmarks[i].name);
+
+		if(run)
+		{
+			benchmarks[i].func();
+			found++;
+		}
+	}
+
+	if(!found)
+	{
+		fprintf(stderr, "unknown benchmark. available:");
+		for(int i = 0; benchmarks[i].name; i++)
+			fprintf(stderr, " %s", benchmarks[i].name);
+		fprintf(stderr, "\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bench/propid.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include "bench-common.h"
+
+#include <string.h>
+
+#define PROPID_ROUNDS 2000000
+
+
+/**************************************************************************
+*** Function:	LinearLookup
+***				Former lookup of MakeProperties(): linear scan of sgf_token[]
+*** Parameters: id ... property ID
+*** Returns:	token or TKN_UNKNOWN
+**************************************************************************/
+
+static token LinearLookup(const char *id)
+{
+	for(int i = 1; sgf_token[i].id; i++)
+		if(!strcmp(id, sgf_token[i].id))
+			return (token)i;
+	return TKN_UNKNOWN;
+}
+
+
+/**************************************************************************
+*** Function:	bench_propid
+***				Compares tokens/sec of linear scan vs. LookupToken()
+***				on a move-heavy mix of property IDs
+**************************************************************************/
+
+void bench_propid(void)
+{
+	/* mix resembles a typical game record: mostly moves, some markup */
+	static const char *ids[] = {
+		"B", "W", "B", "W", "B", "W", "B", "W", "C", "B", "W", "BL", "WL",
+		"B", "W", "B", "W", "LB", "TR", "B", "W", "AB", "AW", "XY", "B", "W"
+	};
+	const size_t num_ids = sizeof(ids) / sizeof(ids[0]);
+	unsigned long sum;
+	double start, linear, lookup;
+
+	SetupTokenIndex();				/* usually done by SetupSGFInfo() */
+	sum = 0;
+	start = BenchNow();
+	for(int r = 0; r < PROPID_ROUNDS; r++)
+		for(size_t i = 0; i < num_ids; i++)
+			sum += LinearLookup(ids[i]);
+	linear = BenchNow() - start;
+	bench_sink = sum;
+
+	sum = 0;
+	start = BenchNow();
+	for(int r = 0; r < PROPID_ROUNDS; r++)
+		for(size_t i = 0; i < num_ids; i++)
+			sum += LookupToken(ids[i]);
+	lookup = BenchNow() - start;
+	bench_sink += sum;
+
+	BenchReport("propid: linear strcmp scan", "tokens", (double)PROPID_ROUNDS * num_ids, linear);
+	BenchReport("propid: LookupToken", "tokens", (double)PROPID_ROUNDS * num_ids, lookup);
+}
@@ -0,0 +1,109 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bench/save-io.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include "bench-common.h"
+
+#include <string.h>
+
+#define SAVE_GAMES		20000
+#define SAVE_ROUNDS		5
+#define SAVE_FILE		"sgfc-bench-save.sgf"
+
+static size_t saved_bytes;
+
+
+/**************************************************************************
+*** Function:	CountingClose
+***				SaveBufferIO close() that records the size of the output
+**************************************************************************/
+
+static int CountingClose(struct SaveFileHandler *sfh, U_LONG error)
+{
+	saved_bytes += (size_t)(sfh->fh.memh.pos - sfh->fh.memh.buffer);
+	return SaveBufferIO_close(sfh, error);
+}
+
+static struct SaveFileHandler *SetupCountingBufferIO(void)
+{
+	return SetupSaveBufferIO(NULL, CountingClose);
+}
+
+
+/**************************************************************************
+*** Function:	TimeSave
+***				Saves the same SGFInfo several times
+*** Parameters: sgfc	  ... loaded and parsed SGF data
+***				setup_sfh ... SaveFileHandler to use
+*** Returns:	seconds
+**************************************************************************/
+
+static double TimeSave(struct SGFInfo *sgfc, struct SaveFileHandler *(*setup_sfh)(void))
+{
+	double start = BenchNow();
+
+	for(int i = 0; i < SAVE_ROUNDS; i++)
+		SaveSGF(sgfc, setup_sfh, SAVE_FILE);
+	return BenchNow() - start;
+}
+
+
+/**************************************************************************
+*** Function:	bench_save
+***				Throughput of SaveSGF() for file and buffer IO. The
+***				collection has moves, markup and comments of varying
+***				length (with soft linebreaks and escaped chars).
+**************************************************************************/
+
+void bench_save(void)
+{
+	static const char game[] =
+		"(;GM[1]FF[4]SZ[19]PB[Black]PW[White]GC[A game with a game comment "
+		"that is long enough to be split into more than one line when saved]"
+		";B[pd]C[First move: star point \\] with escaped bracket];W[dp]LB[dd:A][pp:B]"
+		";B[qq]C[This is a longer comment which discusses the move in some detail, "
+		"so that the text is wrapped several times when the line length exceeds the "
+		"limit. It also contains\nlinebreaks.];W[qc]TR[aa][ab][ac][ad]"
+		"(;B[jj])(;B[kk]C[variation]))\n";
+	struct SGFInfo *sgfc = SetupSGFInfo(NULL);
+	size_t len = SAVE_GAMES * (sizeof(game) - 1);
+	char *buffer = SaveMalloc(NULL, len, "benchmark buffer"), *c;
+	double secs;
+
+	for(c = buffer; c < buffer + len; c += sizeof(game) - 1)
+		memcpy(c, game, sizeof(game) - 1);
+	sgfc->print_error_handler = NULL;	/* only timing is of interest */
+	sgfc->options->add_sgfc_ap_property = false;
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + len;
+	if(!LoadSGFFromFileBuffer(sgfc) || !ParseSGF(sgfc))
+	{
+		FreeSGFInfo(sgfc);
+		return;
+	}
+
+	saved_bytes = 0;
+	secs = TimeSave(sgfc, SetupCountingBufferIO);
+	BenchReport("save to buffer", "KB", (double)saved_bytes / 1024, secs);
+
+	secs = TimeSave(sgfc, SetupSaveFileIO);	/* same output as above */
+	BenchReport("save to file", "KB", (double)saved_bytes / 1024, secs);
+	remove(SAVE_FILE);
+
+	size_t size;
+	SaveSGFToBuffer(sgfc, NULL, 0, &size);
+	char *out = SaveMalloc(NULL, size, "benchmark buffer");
+	secs = BenchNow();
+	for(int i = 0; i < SAVE_ROUNDS; i++)
+		SaveSGFToBuffer(sgfc, out, size, NULL);
+	secs = BenchNow() - secs;
+	BenchReport("save to caller's buffer", "KB", (double)saved_bytes / 1024, secs);
+	free(out);
+
+	FreeSGFInfo(sgfc);
+}
@@ -0,0 +1,117 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bench/snapshot-load.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include "bench-common.h"
+
+#include <string.h>
+
+#define SNAPSHOT_GAMES		20000
+#define SNAPSHOT_ROUNDS		5
+#define SNAPSHOT_SGF		"sgfc-bench-snapshot.sgf"
+#define SNAPSHOT_FILE		"sgfc-bench-snapshot.snap"
+
+
+/**************************************************************************
+*** Function:	TimeLoad
+***				Loads the same file several times
+*** Parameters: snapshot ... true: LoadSnapshot(), false: LoadSGF() & ParseSGF()
+*** Returns:	seconds
+**************************************************************************/
+
+static double TimeLoad(bool snapshot)
+{
+	double secs = 0, start;
+
+	for(int i = 0; i < SNAPSHOT_ROUNDS; i++)
+	{
+		struct SGFInfo *sgfc = SetupSGFInfo(NULL);
+		sgfc->print_error_output_hook = NULL;	/* only timing is of interest */
+
+		start = BenchNow();
+		if(snapshot)
+			LoadSnapshot(sgfc, SNAPSHOT_FILE);
+		else if(LoadSGF(sgfc, SNAPSHOT_SGF))
+			ParseSGF(sgfc);
+		secs += BenchNow() - start;
+
+		bench_sink = (unsigned long)sgfc->error_count;
+		FreeSGFInfo(sgfc);
+	}
+	return secs;
+}
+
+
+/**************************************************************************
+*** Function:	FileSize
+***				Size of a file
+*** Parameters: name ... filename/path
+*** Returns:	size in bytes (0 if file can't be opened)
+**************************************************************************/
+
+static double FileSize(const char *name)
+{
+	FILE *file = fopen(name, "rb");
+	long size = 0;
+
+	if(file)
+	{
+		if(!fseek(file, 0, SEEK_END))
+			size = ftell(file);
+		fclose(file);
+	}
+	return size > 0 ? (double)size : 0;
+}
+
+
+/**************************************************************************
+*** Function:	bench_snapshot
+***				Load time of a collection from SGF text (load & check)
+***				versus loading the binary snapshot of the checked trees,
+***				and the size of both files
+**************************************************************************/
+
+void bench_snapshot(void)
+{
+	static const char game[] =
+		"(;GM[1]FF[4]SZ[19]PB[Black]PW[White]KM[6.5]GC[A game with a game comment]"
+		";B[pd]C[First move: star point \\] with escaped bracket];W[dp]LB[dd:A][pp:B]"
+		";B[qq]C[This is a longer comment which discusses the move in some detail.]"
+		";W[qc]TR[aa][ab][ac][ad];B[oc];W[qf];B[nd];W[cd](;B[jj])(;B[kk]C[variation]))\n";
+	struct SGFInfo *sgfc = SetupSGFInfo(NULL);
+	FILE *file = fopen(SNAPSHOT_SGF, "wb");
+	double secs, sgf_size, snap_size;
+
+	if(!file)
+	{
+		FreeSGFInfo(sgfc);
+		return;
+	}
+	for(int i = 0; i < SNAPSHOT_GAMES; i++)
+		fwrite(game, 1, sizeof(game) - 1, file);
+	fclose(file);
+
+	sgfc->print_error_output_hook = NULL;
+	if(LoadSGF(sgfc, SNAPSHOT_SGF) && ParseSGF(sgfc))
+		SaveSnapshot(sgfc, SNAPSHOT_FILE);
+	FreeSGFInfo(sgfc);
+
+	sgf_size = FileSize(SNAPSHOT_SGF);
+	snap_size = FileSize(SNAPSHOT_FILE);
+
+	secs = TimeLoad(false);
+	BenchReport("load & check SGF", "games", SNAPSHOT_GAMES * SNAPSHOT_ROUNDS, secs);
+	printf("%-28s %12.0f %s\n", "SGF file size", sgf_size, "bytes");
+	secs = TimeLoad(true);
+	BenchReport("load snapshot", "games", SNAPSHOT_GAMES * SNAPSHOT_ROUNDS, secs);
+	printf("%-28s %12.0f %-8s %8.2f x SGF size\n", "snapshot file size", snap_size, "bytes",
+		   sgf_size > 0 ? snap_size / sgf_size : 0);
+
+	remove(SNAPSHOT_SGF);
+	remove(SNAPSHOT_FILE);
+}
@@ -0,0 +1,81 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bench/tree-build.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include "bench-common.h"
+
+#include <string.h>
+
+#define COLLECTION_GAMES	100000
+#define WIDE_VARIATIONS		100000
+
+
+/**************************************************************************
+*** Function:	LoadAndParse
+***				Loads and parses an in-memory SGF file
+*** Parameters: buffer ... SGF data (taken over, freed by FreeSGFInfo)
+***				len	   ... length of data
+*** Returns:	seconds
+**************************************************************************/
+
+static double LoadAndParse(char *buffer, size_t len)
+{
+	struct SGFInfo *sgfc = SetupSGFInfo(NULL);
+	double start;
+
+	sgfc->print_error_handler = NULL;	/* only timing is of interest */
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + len;
+
+	start = BenchNow();
+	if(LoadSGFFromFileBuffer(sgfc))
+		ParseSGF(sgfc);
+	start = BenchNow() - start;
+
+	bench_sink = (unsigned long)sgfc->error_count;
+	FreeSGFInfo(sgfc);
+	return start;
+}
+
+
+/**************************************************************************
+*** Function:	bench_tree_build
+***				Game collection (many root nodes) and a single node with
+***				many variations. Time per item has to stay constant
+***				when the number of items grows.
+**************************************************************************/
+
+void bench_tree_build(void)
+{
+	static const char game[] = "(;GM[1]FF[4]SZ[19]PB[Black]PW[White];B[pd];W[dp];B[qq])\n";
+	char name[64], *buffer, *c;
+	size_t len;
+
+	for(int n = COLLECTION_GAMES / 4; n <= COLLECTION_GAMES; n *= 2)
+	{
+		len = (size_t)n * (sizeof(game) - 1);
+		buffer = SaveMalloc(NULL, len, "benchmark buffer");
+		for(c = buffer; c < buffer + len; c += sizeof(game) - 1)
+			memcpy(c, game, sizeof(game) - 1);
+
+		sprintf(name, "collection %d games", n);
+		BenchReport(name, "games", n, LoadAndParse(buffer, len));
+	}
+
+	for(int n = WIDE_VARIATIONS / 4; n <= WIDE_VARIATIONS; n *= 2)
+	{
+		buffer = SaveMalloc(NULL, 32 + (size_t)n * 8, "benchmark buffer");
+		c = buffer + sprintf(buffer, "(;GM[1]FF[4]SZ[19]");
+		for(int i = 0; i < n; i++)
+			c += sprintf(c, "(;B[%c%c])", 'a' + i % 19, 'a' + (i / 19) % 19);
+		*c++ = ')';
+
+		sprintf(name, "%d variations", n);
+		BenchReport(name, "nodes", n, LoadAndParse(buffer, (size_t)(c - buffer)));
+	}
+}
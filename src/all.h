@@ -10,7 +10,9 @@
 **************************************************************************/
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <iconv.h>
 
 /* #define VERSION_NO_MAIN */		/* In case you've written a new main()
@@ -149,8 +151,10 @@ struct SGFCError {
 #define FE_WRONG_ENCODING		(73UL | E_FATAL_ERROR | E_SEARCHPOS)
 #define WS_CA_DIFFERS			(74UL | E_WARNING_STRICT | E_SEARCHPOS | E_CRITICAL)
 #define E_MULTIPLE_ENCODINGS	(75UL | E_FATAL_ERROR | E_SEARCHPOS)
+#define FE_BAD_SNAPSHOT			(76UL | E_FATAL_ERROR)
+#define FE_BATCH_OPTION			(77UL | E_FATAL_ERROR)
 
-#define MAX_ERROR_NUM	75UL
+#define MAX_ERROR_NUM	77UL
 
 
 /* order must match order in sgf_token[] !! */
@@ -216,14 +220,23 @@ typedef enum {
 #define PARSE_POS       0x0002u
 
 #define MAX_BOARDSIZE	52
+#define MAX_BITBOARD_SIZE	19	/* Go boards up to this size: bitboard.c */
 
 #define MAX_REORDER_VARIATIONS 100
 
-/* separate structure, so that it can be re-used when iterating the node tree */
-struct PathBoard
+#define MAX_THREADS		256		/* batch & parallel mode */
+
+/* chains of stones with their pseudo-liberties (number of stone/empty point
+** pairs), kept up to date by Do_Move(); shared by all variations like the
+** board. Entries are valid for positions with stones only. */
+struct ChainBoard
 {
-	U_LONG board[MAX_BOARDSIZE*MAX_BOARDSIZE];
-	U_LONG num;
+	bool valid;			/* false: board changed (setup) -> rebuild before next move */
+	U_SHORT *head;		/* position of first stone of chain */
+	U_SHORT *next;		/* next stone of chain (circular list) */
+	U_SHORT *libs;		/* pseudo-liberties of chain (at position of head) */
+	U_SHORT *size;		/* number of stones of chain (at position of head) */
+	U_SHORT data[];
 };
 
 struct BoardStatus
@@ -233,9 +246,37 @@ struct BoardStatus
 	int bwidth;				/* copy of sgf->info->bwidth */
 	int bheight;			/* copy of sgf->info->bheight */
 	unsigned char *board;
-	U_SHORT *markup;
-	bool markup_changed;	/* markup field changed */
-	struct PathBoard *paths;	/* board for capturing stones */
+	U_SHORT *markup;		/* markup flags of current node (ST_xxx) */
+	struct MarkupList *markup_list;	/* positions with markup flags set */
+	struct ChainBoard *chains;	/* chains of stones for capturing (or NULL) */
+	struct BitBoard *bits;	/* bit board instead of chains (or NULL) */
+	uint64_t hash;			/* Zobrist hash of board (see ZobristKey()) */
+	uint64_t setup_hash;	/* hash after setup part of node (see Check_Properties()) */
+	struct BoardJournal *journal;	/* undo log of board/chains (or NULL) */
+};
+
+/* positions of markup set in current node: only these are cleared for
+** the next node (SetMarkup() / ClearMarkup()); shared like the markup */
+struct MarkupList
+{
+	size_t num;
+	U_SHORT pos[];
+};
+
+/* board & chains are shared by all variations: changes within a variation
+** are logged and rolled back when the variation is done (UndoBoard()) */
+struct BoardUndo
+{
+	size_t index;			/* < area: board position; else: area + chain data index */
+	U_SHORT old;			/* previous value */
+};
+
+struct BoardJournal
+{
+	struct SGFInfo *sgfc;	/* for GrowStack() */
+	struct BoardUndo *undo;
+	size_t num;
+	size_t max;
 };
 
 #define MXY(x,y) ((y)*st->bwidth + (x))
@@ -251,8 +292,7 @@ struct PropValue
 	char *value2;				/* value2 for compose value type */
 	size_t value2_len;
 
-	U_LONG row;
-	U_LONG col;
+	U_LONG pos;					/* buffer position (see ResolvePosition) */
 };
 
 
@@ -263,14 +303,14 @@ struct Property
 	U_CHAR  priority;			/* for sorting properties within a node */
 
 	token id;
-	char *idstr;				/* original ID string including lowercase (for TKN_UNKNOWN, error reporting, ...) */
+	const char *idstr;			/* original ID string including lowercase (for TKN_UNKNOWN, error reporting, ...) */
+								/* interned: equal strings have equal pointers (see InternPropID) */
 	U_SHORT flags;				/* copy of sgf_token[].flags (may get changed programmatically) */
 
 	struct PropValue *value;	/* value list head */
 	struct PropValue *valend;
 
-	U_LONG row;
-	U_LONG col;
+	U_LONG pos;					/* buffer position (see ResolvePosition) */
 };
 
 
@@ -282,12 +322,13 @@ struct Node
 	struct Node *parent;		/* tree */
 	struct Node *child;
 	struct Node *sibling;
+	struct Node *last_child;	/* last sibling of child (O(1) append) */
 
 	struct Property *prop;		/* prop list head */
 	struct Property *last;
 
-	U_LONG row;
-	U_LONG col;
+	U_LONG pos;					/* buffer position (see ResolvePosition) */
+	uint64_t hash;				/* Go: Zobrist hash of position after node */
 };
 
 
@@ -306,6 +347,20 @@ struct TreeInfo
 	const char *encoding_name;
 
 	struct Node *root;	/* root node of this tree */
+
+	const char *source;		/* original text of tree in buffer or NULL */
+	size_t source_len;		/* (see options->verbatim) */
+	unsigned long long source_hash;	/* HashGameTree() after loading */
+	bool modified;			/* tree got changed by ParseSGF() */
+};
+
+/* game tree loaded without any messages (see options->verbatim) */
+struct SourceTree
+{
+	struct Node *root;
+	const char *start;		/* '(' ... ')' in buffer */
+	size_t len;
+	unsigned long long hash;
 };
 
 
@@ -370,6 +425,11 @@ struct SGFCOptions
 	const char *outfile;
 	const char *forced_encoding;
 	const char *default_encoding;
+	const char *snapshot;		/* --write-snapshot: file name (or NULL) */
+
+	const char **batch_files;	/* batch mode: files, @listfiles, directories */
+	int batch_count;
+	int threads;				/* batch/parallel mode: number of worker threads (0: #CPUs) */
 
 	enum option_linebreaks linebreaks;
 	enum option_findstart find_start;
@@ -394,6 +454,11 @@ struct SGFCOptions
 	bool strict_checking;
 	bool reorder_variations;
 	bool add_sgfc_ap_property;
+	bool batch;
+	bool parallel;				/* load, check & save game trees of a collection in parallel */
+	bool verbatim;				/* save unmodified game trees as they were loaded */
+	bool read_snapshot;			/* infile is a snapshot (see LoadSnapshot) */
+	bool position_hashes;		/* print Zobrist hash of each node */
 
 	bool error_enabled[MAX_ERROR_NUM];
 	bool delete_property[NUM_SGF_TOKENS];
@@ -411,14 +476,37 @@ struct SaveFileHandler {
 	int (*open)(struct SaveFileHandler *, const char *, const char *);
 	/* close() also gets error code, so that it knows whether writing finished successfully */
 	int (*close)(struct SaveFileHandler *, U_LONG);
+	/* putc == NULL: block handler, which provides write() (see below) */
 	int (*putc)(struct SaveFileHandler *, int);
 	union {
 		FILE *file;
 		struct MemoryIOHandle memh;
 	} fh; /* fh ... "file" handle (unnamed unions != C99) */
+
+	/* Members below are used only by block handlers (putc == NULL, as set
+	 * up by SetupSaveFileIO() and SetupSaveBufferIO()). SaveSGF() neither
+	 * reads nor writes them for handlers with putc(), so these may leave
+	 * them uninitialized. */
+	/* write() writes a block of bytes, returns false on error */
+	int (*write)(struct SaveFileHandler *, const char *, size_t);
+	/* exact_size: SaveSGF() measures the size of each file before open()
+	 * and sets size_hint to it (otherwise size_hint is 0) */
+	bool exact_size;
+	size_t size_hint;
 };
 
-/* The big singleton -- contains everything that needs to be known throughout SGFC */
+/* The big singleton -- contains everything that needs to be known throughout SGFC
+ *
+ * Thread safety: all state of the library core lives in SGFInfo (and the
+ * structures it references). Different SGFInfo instances may be used
+ * concurrently on different threads; a single instance must not be shared
+ * between threads without external locking. Error reporting and the
+ * out-of-memory policy are per instance (hooks below, set by SetupSGFInfo()).
+ * The default output hook prints to stdout, the default OOM policy
+ * terminates the process. Global data (sgf_token[], error messages) is
+ * read-only; the property ID index is built once (pthread_once(), see
+ * SetupTokenIndex() for non-POSIX builds).
+ * Interactive mode (-i) reads from stdin. */
 struct SGFInfo
 {
 	struct Node *first;	/* node list head */
@@ -429,10 +517,16 @@ struct SGFInfo
 	struct TreeInfo *info;	/* pointer to info for current GameTree */
 
 	struct Node *root;		/* first root node (tree) */
+	struct Node *last_root;	/* last root node (O(1) append) */
 
 	char *buffer;			/* file buffer */
 	const char *b_end;		/* file buffer end address */
-	const char *start;		/* start of SGF data within buffer */
+	const char *start;		/* start of SGF data within buffer (or decoded_buffer) */
+	bool buffer_mapped;		/* buffer was mmap()ed by ReadSGFFile() -> see FreeSGFBuffer() */
+	bool buffer_writable;	/* ReadSGFFile(): buffer is writable with '\0' at b_end, i.e. */
+							/* may become decoded_buffer (contents get modified then) */
+	char *decoded_buffer;	/* decoded buffer (OPTION_ENCODING_EVERYTHING); may be buffer */
+	const char *decoded_end;	/* end of decoded_buffer; property values may point into it */
 	char *global_encoding_name;		/* only used in case of OPTION_ENCODING_EVERYTHING */
 
 	struct SGFCOptions *options;
@@ -441,8 +535,36 @@ struct SGFInfo
 	int critical_count;
 	int warning_count;
 	int ignored_count;
+	U_LONG _messages;	/* number of PrintError() calls (see BuildGameTree) */
+
+	/* error reporting: handler decides, output hook prints (may be NULL) */
+	bool (*print_error_handler)(U_LONG, struct SGFInfo *, va_list);
+	void (*print_error_output_hook)(struct SGFInfo *, struct SGFCError *);
+	/* called when memory runs out; must not return (exit() or longjmp()) */
+	void (*oom_panic_hook)(struct SGFInfo *, const char *);
+	void *user_data;		/* for use by hooks; not touched by SGFC */
 
 	struct ErrorC_internal *_error_c;
+	struct MemArena *_arena;	/* nodes, properties, values (see ArenaAlloc) */
+	struct IDTable *_id_table;	/* interned property IDs (see InternPropID) */
+	struct PosIndex *_pos_index;	/* buffer position -> row & column (see load.c) */
+	struct IConvCache *_iconv_cache;	/* iconv descriptors (see AcquireIConV) */
+	struct TextBatch *_text_batch;	/* text values decoded per tree (see DecodeTreeTexts) */
+	struct SourceTree *_source;		/* loaded game trees (see options->verbatim) */
+	size_t _num_source;
+	size_t _max_source;
+};
+
+/* for decoding several values in one go (see DecodeSegments) */
+struct DecodeSegment
+{
+	char *in;			/* input, filled in by caller */
+	size_t in_len;
+	size_t out_offset;	/* decoded value within output buffer */
+	size_t out_len;
+	size_t illegal;		/* offset of first illegal byte sequence or (size_t)-1 */
+	size_t fatal;		/* offset of fatal error (if !ok) */
+	bool ok;
 };
 
 /* for defining properties (see sgf_token[] in properties.c) */
@@ -0,0 +1,247 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 bitboard.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+*** Notes:	Go boards up to MAX_BITBOARD_SIZE are kept as bit masks (one
+***			for each color) in addition to BoardStatus.board. Chains and
+***			their liberties are found by bitwise flood-fill, so no chain
+***			information has to be maintained (or undone) between moves.
+***
+***			Bit of position (x,y) is y*BIT_STRIDE + x. The column at
+***			x = BIT_STRIDE-1 is never on board: shifting a mask by one
+***			position doesn't wrap around into the next/previous row.
+**************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "all.h"
+#include "protos.h"
+
+
+#define BIT_STRIDE	(MAX_BITBOARD_SIZE + 1)
+#define BIT_WORDS	((MAX_BITBOARD_SIZE * BIT_STRIDE + 63) / 64)
+
+struct BitBoard
+{
+	int bwidth;
+	int bheight;
+	uint64_t on_board[BIT_WORDS];	/* all positions of the board */
+	uint64_t black[BIT_WORDS];
+	uint64_t white[BIT_WORDS];
+};
+
+#define BIT_WORD(bit)	((bit) / 64)
+#define BIT_MASK(bit)	((uint64_t)1 << ((bit) % 64))
+
+
+/**************************************************************************
+*** Function:	SetupBitBoard
+***				Allocates an empty bit board
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				bwidth	... board width (<= MAX_BITBOARD_SIZE)
+***				bheight	... board height (<= MAX_BITBOARD_SIZE)
+*** Returns:	pointer to BitBoard (free() when done)
+**************************************************************************/
+
+struct BitBoard *SetupBitBoard(struct SGFInfo *sgfc, int bwidth, int bheight)
+{
+	struct BitBoard *bb = SaveCalloc(sgfc, sizeof(struct BitBoard), "bit board buffer");
+	int x, y, bit;
+
+	bb->bwidth = bwidth;
+	bb->bheight = bheight;
+	for(y = 0; y < bheight; y++)
+		for(x = 0; x < bwidth; x++)
+		{
+			bit = y * BIT_STRIDE + x;
+			bb->on_board[BIT_WORD(bit)] |= BIT_MASK(bit);
+		}
+	return bb;
+}
+
+
+/**************************************************************************
+*** Function:	SetBitBoard
+***				Changes a position of the bit board
+*** Parameters: bb	  ... bit board
+***				pos	  ... position (MXY)
+***				color ... EMPTY, BLACK or WHITE
+*** Returns:	-
+**************************************************************************/
+
+void SetBitBoard(struct BitBoard *bb, int pos, unsigned char color)
+{
+	int bit = (pos / bb->bwidth) * BIT_STRIDE + pos % bb->bwidth;
+
+	bb->black[BIT_WORD(bit)] &= ~BIT_MASK(bit);
+	bb->white[BIT_WORD(bit)] &= ~BIT_MASK(bit);
+	if(color == BLACK)
+		bb->black[BIT_WORD(bit)] |= BIT_MASK(bit);
+	else if(color == WHITE)
+		bb->white[BIT_WORD(bit)] |= BIT_MASK(bit);
+}
+
+
+/**************************************************************************
+*** Function:	Dilate
+***				Adds all neighbours to a set of positions
+*** Parameters: bb	... bit board
+***				m	... positions
+***				out	... output: positions and their neighbours
+*** Returns:	-
+**************************************************************************/
+
+static void Dilate(const struct BitBoard *bb, const uint64_t *m, uint64_t *out)
+{
+	uint64_t lower, upper;
+	int i;
+
+	for(i = 0; i < BIT_WORDS; i++)
+	{
+		lower = i > 0 ? m[i-1] : 0;
+		upper = i < BIT_WORDS-1 ? m[i+1] : 0;
+		out[i] = (m[i]
+				  | m[i] << 1 | lower >> 63
+				  | m[i] >> 1 | upper << 63
+				  | m[i] << BIT_STRIDE | lower >> (64 - BIT_STRIDE)
+				  | m[i] >> BIT_STRIDE | upper << (64 - BIT_STRIDE))
+				 & bb->on_board[i];
+	}
+}
+
+
+/**************************************************************************
+*** Function:	IsLiberty
+***				Checks if a bit is an empty position of the board
+*** Parameters: bb	... bit board
+***				bit	... bit of position (may be outside of board)
+*** Returns:	true / false
+**************************************************************************/
+
+static bool IsLiberty(const struct BitBoard *bb, int bit)
+{
+	int w = BIT_WORD(bit);
+
+	if(bit < 0 || w >= BIT_WORDS)
+		return false;
+	return (bb->on_board[w] & ~(bb->black[w] | bb->white[w]) & BIT_MASK(bit)) != 0;
+}
+
+
+/**************************************************************************
+*** Function:	FloodChain
+***				Finds the chain of a stone, stops as soon as the
+***				chain is known to have a liberty
+*** Parameters: bb		... bit board
+***				stones	... stones of the chain's color
+***				bit		... bit of the stone
+***				chain	... output: stones of chain (complete only if
+***							there are no liberties)
+*** Returns:	true: chain has a liberty / false: no liberties
+**************************************************************************/
+
+static bool FloodChain(const struct BitBoard *bb, const uint64_t *stones, int bit, uint64_t *chain)
+{
+	uint64_t grown[BIT_WORDS], libs, changed;
+	int i;
+
+	if(IsLiberty(bb, bit - 1) || IsLiberty(bb, bit + 1) ||		/* usual case */
+	   IsLiberty(bb, bit - BIT_STRIDE) || IsLiberty(bb, bit + BIT_STRIDE))
+		return true;
+
+	memset(chain, 0, BIT_WORDS * sizeof(uint64_t));
+	chain[BIT_WORD(bit)] = BIT_MASK(bit);
+
+	do {
+		Dilate(bb, chain, grown);
+		libs = changed = 0;
+		for(i = 0; i < BIT_WORDS; i++)
+		{
+			libs |= grown[i] & ~(bb->black[i] | bb->white[i]);
+			grown[i] &= stones[i];
+			changed |= grown[i] ^ chain[i];
+			chain[i] = grown[i];
+		}
+		if(libs)
+			return true;
+	} while(changed);
+
+	return false;
+}
+
+
+/**************************************************************************
+*** Function:	RemoveBits
+***				Removes a chain from the bit board
+*** Parameters: bb		 ... bit board
+***				stones	 ... stones of the chain's color
+***				chain	 ... stones of the chain
+***				captured ... output: positions (MXY) of removed stones
+*** Returns:	number of removed stones
+**************************************************************************/
+
+static int RemoveBits(const struct BitBoard *bb, uint64_t *stones, const uint64_t *chain, int *captured)
+{
+	/* de Bruijn sequence: index of lowest set bit without loop */
+	static const int lowest[64] = {
+		 0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6 };
+	uint64_t w, b;
+	int bit, num = 0, i;
+
+	for(i = 0; i < BIT_WORDS; i++)
+	{
+		stones[i] &= ~chain[i];
+		for(w = chain[i]; w; w ^= b)
+		{
+			b = w & (~w + 1);
+			bit = i * 64 + lowest[(b * UINT64_C(0x03f79d71b4cb0a89)) >> 58];
+			captured[num++] = (bit / BIT_STRIDE) * bb->bwidth + bit % BIT_STRIDE;
+		}
+	}
+	return num;
+}
+
+
+/**************************************************************************
+*** Function:	CaptureBits
+***				Removes enemy chains without liberties next to a
+***				move, and finally the chain of the move in case of
+***				suicide (stone has to be set with SetBitBoard() first)
+*** Parameters: bb		 ... bit board
+***				pos		 ... position of move (MXY)
+***				color	 ... color of move
+***				captured ... output: positions (MXY) of removed stones
+***							 (size: board area)
+*** Returns:	number of removed stones
+**************************************************************************/
+
+int CaptureBits(struct BitBoard *bb, int pos, unsigned char color, int *captured)
+{
+	uint64_t chain[BIT_WORDS];
+	uint64_t *own = color == BLACK ? bb->black : bb->white;
+	uint64_t *enemy = color == BLACK ? bb->white : bb->black;
+	int x = pos % bb->bwidth, y = pos / bb->bwidth;
+	int bit = y * BIT_STRIDE + x, nb[4], num = 0, removed = 0, i;
+
+	if(x > 0)				nb[num++] = bit - 1;
+	if(y > 0)				nb[num++] = bit - BIT_STRIDE;
+	if(x < bb->bwidth-1)	nb[num++] = bit + 1;
+	if(y < bb->bheight-1)	nb[num++] = bit + BIT_STRIDE;
+
+	for(i = 0; i < num; i++)				/* check for prisoners */
+		if(enemy[BIT_WORD(nb[i])] & BIT_MASK(nb[i]) && !FloodChain(bb, enemy, nb[i], chain))
+			removed += RemoveBits(bb, enemy, chain, captured + removed);
+
+	if(!removed && !FloodChain(bb, own, bit, chain))	/* check for suicide */
+		removed = RemoveBits(bb, own, chain, captured);
+
+	return removed;
+}
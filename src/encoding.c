@@ -14,19 +14,189 @@
 #include <errno.h>
 #include <math.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "all.h"
 #include "protos.h"
 
 
+/* Cache of iconv descriptors (iconv_open() is expensive, e.g. glibc loads
+** gconv modules). Descriptors are shared by all game trees with the same
+** encoding and stay open for the next file if the SGFInfo is reused (or if
+** the cache is shared, see ShareIConvCache). Unused descriptors are closed
+** least recently used first if the cache is full. */
+
+#define ICONV_CACHE_SIZE	8
+#define ICONV_NAME_SIZE		64		/* longer names aren't cached */
+
+struct IConvEntry
+{
+	char name[ICONV_NAME_SIZE];		/* normalized (upper case) */
+	iconv_t cd;
+	unsigned int refs;				/* number of users (AcquireIConV) */
+	unsigned long last_used;
+};
+
+struct IConvCache
+{
+	struct IConvEntry entry[ICONV_CACHE_SIZE];
+	size_t num;
+	unsigned long clock;
+	unsigned int users;				/* number of SGFInfo structures */
+};
+
+
+/**************************************************************************
+*** Function:	SetupIConvCache
+***				Creates an empty cache of iconv descriptors
+*** Parameters: sgfc ... pointer to SGFInfo structure (for error reporting)
+*** Returns:	pointer to cache
+**************************************************************************/
+
+struct IConvCache *SetupIConvCache(struct SGFInfo *sgfc)
+{
+	struct IConvCache *cache = SaveCalloc(sgfc, sizeof(struct IConvCache), "iconv cache");
+	cache->users = 1;
+	return cache;
+}
+
+
+/**************************************************************************
+*** Function:	ShareIConvCache
+***				Lets an SGFInfo use a given cache instead of its own, e.g.
+***				for a series of files. The cache must not be used by
+***				two threads at the same time.
+*** Parameters: sgfc  ... pointer to SGFInfo structure
+***				cache ... pointer to cache
+*** Returns:	-
+**************************************************************************/
+
+void ShareIConvCache(struct SGFInfo *sgfc, struct IConvCache *cache)
+{
+	FreeIConvCache(sgfc->_iconv_cache);
+	cache->users++;
+	sgfc->_iconv_cache = cache;
+}
+
+
+/**************************************************************************
+*** Function:	FreeIConvCache
+***				Releases a cache; closes all descriptors and frees the
+***				cache if it isn't used by any other SGFInfo
+*** Parameters: cache ... pointer to cache (may be NULL)
+*** Returns:	-
+**************************************************************************/
+
+void FreeIConvCache(struct IConvCache *cache)
+{
+	if(!cache || --cache->users)
+		return;
+
+	for(size_t i = 0; i < cache->num; i++)
+		iconv_close(cache->entry[i].cd);
+	free(cache);
+}
+
+
+/**************************************************************************
+*** Function:	AcquireIConV
+***				Gets a descriptor for conversion to UTF-8 from the cache
+***				of SGFInfo; opens it if it isn't cached yet.
+***				Has to be released with ReleaseIConV().
+*** Parameters: sgfc	 ... pointer to SGFInfo structure
+***				encoding ... name of encoding
+*** Returns:	iconv descriptor or (iconv_t)-1 (unknown encoding)
+**************************************************************************/
+
+iconv_t AcquireIConV(struct SGFInfo *sgfc, const char *encoding)
+{
+	struct IConvCache *cache;
+	struct IConvEntry *e = NULL;
+	char name[ICONV_NAME_SIZE];
+	size_t i, len = strlen(encoding);
+	iconv_t cd;
+
+	if(len >= ICONV_NAME_SIZE)
+		return iconv_open("UTF-8", encoding);
+
+	for(i = 0; i <= len; i++)
+		name[i] = (char)toupper((unsigned char)encoding[i]);
+
+	if(!sgfc->_iconv_cache)
+		sgfc->_iconv_cache = SetupIConvCache(sgfc);
+	cache = sgfc->_iconv_cache;
+
+	for(i = 0; i < cache->num; i++)
+		if(!strcmp(cache->entry[i].name, name))
+		{
+			e = &cache->entry[i];
+			iconv(e->cd, NULL, 0, NULL, 0);		/* reset internal iconv state */
+			e->refs++;
+			e->last_used = ++cache->clock;
+			return e->cd;
+		}
+
+	cd = iconv_open("UTF-8", encoding);
+	if(cd == (iconv_t)-1)
+		return cd;
+
+	if(cache->num < ICONV_CACHE_SIZE)
+		e = &cache->entry[cache->num++];
+	else								/* evict least recently used */
+	{
+		for(i = 0; i < ICONV_CACHE_SIZE; i++)
+			if(!cache->entry[i].refs && (!e || cache->entry[i].last_used < e->last_used))
+				e = &cache->entry[i];
+		if(!e)							/* all in use: don't cache */
+			return cd;
+		iconv_close(e->cd);
+	}
+
+	strcpy(e->name, name);
+	e->cd = cd;
+	e->refs = 1;
+	e->last_used = ++cache->clock;
+	return cd;
+}
+
+
+/**************************************************************************
+*** Function:	ReleaseIConV
+***				Gives back a descriptor obtained by AcquireIConV()
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				cd	 ... iconv descriptor
+*** Returns:	-
+**************************************************************************/
+
+void ReleaseIConV(struct SGFInfo *sgfc, iconv_t cd)
+{
+	struct IConvCache *cache = sgfc->_iconv_cache;
+
+	if(cache)
+		for(size_t i = 0; i < cache->num; i++)
+			if(cache->entry[i].cd == cd)
+			{
+				cache->entry[i].refs--;
+				return;
+			}
+	iconv_close(cd);					/* not cached */
+}
+
+
 /**************************************************************************
 *** Function:	OpenIconV
 ***				Safely opens an iconv descriptor for the given encoding
 ***				Falls back to default_encoding if specified encoding fails,
 ***				forced_encoding overrides any provided encoding.
+***				Descriptors are taken from the cache (see AcquireIConV).
 *** Parameters: sgfc		  ... pointer to SGFInfo structure
 ***				encoding	  ... name of desired encoding or NULL for default
 ***				encoding_name ... output parameter: holds name of selected encoding
-*** Returns:	pointer to iconv descriptor
+*** Returns:	pointer to iconv descriptor (release with ReleaseIConV)
 **************************************************************************/
 
 iconv_t OpenIconV(struct SGFInfo *sgfc, const char *encoding, const char **encoding_name)
@@ -35,7 +205,7 @@ iconv_t OpenIconV(struct SGFInfo *sgfc, const char *encoding, const char **encod
 
 	if(sgfc->options->forced_encoding)
 	{
-		cd = iconv_open("UTF-8", sgfc->options->forced_encoding);
+		cd = AcquireIConV(sgfc, sgfc->options->forced_encoding);
 		if(encoding_name)
 			*encoding_name = sgfc->options->forced_encoding;
 	}
@@ -43,14 +213,14 @@ iconv_t OpenIconV(struct SGFInfo *sgfc, const char *encoding, const char **encod
 	{
 		if(encoding)
 		{
-			cd = iconv_open("UTF-8", encoding);
+			cd = AcquireIConV(sgfc, encoding);
 			if(encoding_name)
 				*encoding_name = encoding;
 			if(cd != (iconv_t)-1)
 				return cd;
 			PrintError(WS_ENCODING_FALLBACK, sgfc, encoding, sgfc->options->default_encoding);
 		}
-		cd = iconv_open("UTF-8", sgfc->options->default_encoding);
+		cd = AcquireIConV(sgfc, sgfc->options->default_encoding);
 		if(encoding_name)
 			*encoding_name = sgfc->options->default_encoding;
 	}
@@ -67,12 +237,13 @@ iconv_t OpenIconV(struct SGFInfo *sgfc, const char *encoding, const char **encod
 *** Function:	DetectEncoding
 ***				Searches for CA[] property in buffer; starts from sgfc->current
 ***				Contains mini-parser which might pick up different CA[] than load.c
-*** Parameters: c	  ... start of buffer
+*** Parameters: sgfc  ... pointer to SGFInfo structure
+***				c	  ... start of buffer
 ***				b_end ... end of buffer
 *** Returns:	pointer to encoding name (needs to be freed) or NULL
 **************************************************************************/
 
-char *DetectEncoding(const char *c, const char *b_end)
+char *DetectEncoding(struct SGFInfo *sgfc, const char *c, const char *b_end)
 {
 	int state = 1, brace_state = 1, brace_count = 0;
 
@@ -84,17 +255,17 @@ char *DetectEncoding(const char *c, const char *b_end)
 
 	/* check for Unicode BOM */
 	if(*c == (char)0xFE && *(c+1) == (char)0xFF)
-		return SaveDupString("UTF-16BE", 0, "encoding");
+		return SaveDupString(sgfc, "UTF-16BE", 0, "encoding");
 	if(*c == (char)0xFF && *(c+1) == (char)0xFE)
 	{
 		if(!*(c+2) && !*(c+3))
-			return SaveDupString("UTF-32LE", 0, "encoding");
-		return SaveDupString("UTF-16LE", 0, "encoding");
+			return SaveDupString(sgfc, "UTF-32LE", 0, "encoding");
+		return SaveDupString(sgfc, "UTF-16LE", 0, "encoding");
 	}
 	if(!*c && !*(c+1) && *(c+2) == (char)0xFE && *(c+3) == (char)0xFF)
-		return SaveDupString("UTF-32BE", 0, "encoding");
+		return SaveDupString(sgfc, "UTF-32BE", 0, "encoding");
 	if(*c == (char)0xEF && *(c+1) == (char)0xBB && *(c+2) == (char)0xBF)
-		return SaveDupString("UTF-8", 0, "encoding");
+		return SaveDupString(sgfc, "UTF-8", 0, "encoding");
 
 	/* assume that while not necessarily ASCII-safe, that the encoding
 	 * has ASCII characters at ASCII codepoints, i.e. we can search for "(CA[]".
@@ -144,7 +315,8 @@ char *DetectEncoding(const char *c, const char *b_end)
 	while(c_end < b_end && *c_end != ']')
 		c_end++;
 	size_t len = (size_t)(c_end - c);
-	char *ca_value = SaveDupString(c, len, "encoding");
+	/* len 0 would mean strlen(), but buffer isn't 0-terminated */
+	char *ca_value = SaveDupString(sgfc, len ? c : "", len, "encoding");
 	if(!Parse_Charset(ca_value, &len) || !len)
 	{
 		free(ca_value);
@@ -154,50 +326,84 @@ char *DetectEncoding(const char *c, const char *b_end)
 }
 
 
+/* output buffer of ConvertSegment(); 'size' excludes the byte for '\0' */
+struct DecodeOutput
+{
+	char *buffer;
+	size_t size;
+	size_t used;
+};
+
+
 /**************************************************************************
-*** Function:	DecodeBuffer
-***				Decodes specified buffer using provided iconv descriptor.
-***				Scales output buffer incrementally, but might
-***				might allocate more memory than strictly necessary.
+*** Function:	GrowDecodeOutput
+***				Enlarges output buffer of ConvertSegment()
+*** Parameters: sgfc		... pointer to SGFInfo structure
+***				out			... output buffer
+***				needed		... estimated number of bytes still needed
+*** Returns:	-
+**************************************************************************/
+
+static void GrowDecodeOutput(struct SGFInfo *sgfc, struct DecodeOutput *out, float needed)
+{
+	size_t increase = (size_t)(lrintf(needed*1.05f)) + 12; /* +5% + 3x 4 byte wide chars */
+	size_t new_size = out->size + increase;
+	/* +1 for \0 termination of buffer */
+	char *new_buffer = SaveMalloc(sgfc, new_size+1, "temporary buffer for encoding conversion");
+
+	if(out->buffer)
+	{
+		memcpy(new_buffer, out->buffer, out->used);
+		free(out->buffer);
+	}
+	out->buffer = new_buffer;
+	out->size = new_size;
+}
+
+
+/**************************************************************************
+*** Function:	ConvertSegment
+***				Decodes one segment of input and appends the result
+***				to the output buffer. Illegal byte sequences are
+***				replaced by U+FFFD (follow up errors are squashed).
 *** Parameters: sgfc		... pointer to SGFInfo structure
 ***				cd			... iconv conversion descriptor
-***				buffer		... start of input buffer
-***				size		... size of input buffer
-***				err_offset	... byte offset for error reporting purposes
-***				buffer_end	... output variable: end of decoded buffer
-*** Returns:	pointer to decoded buffer or NULL
+***				buffer		... start of input segment
+***				size		... size of input segment
+***				out			... output buffer (grown as needed)
+***				pending		... size of input still to come after this
+***								segment (for estimating buffer growth)
+***				illegal		... output variable: offset of first illegal
+***								byte sequence, or (size_t)-1 if none
+***				fatal		... output variable: offset of fatal error
+*** Returns:	true on success, false on fatal error
+***				(output of the segment is incomplete then)
 **************************************************************************/
 
-char *DecodeBuffer(struct SGFInfo *sgfc, iconv_t cd,
-				   char *buffer, size_t size, U_LONG err_offset,
-				   const char **buffer_end)
+static bool ConvertSegment(struct SGFInfo *sgfc, iconv_t cd, char *buffer, size_t size,
+						   struct DecodeOutput *out, size_t pending,
+						   size_t *illegal, size_t *fatal)
 {
-	char *out_buffer, *out_pos, *in_buffer;
-	size_t in_left, out_size, result, out_left, err_left = 0;
+	char *out_pos, *in_buffer = buffer;
+	size_t in_left = size, out_left, result, err_left = 0;
+	size_t out_start = out->used;
 	bool resize_out = false, add_replacement = false;
-	bool illegal_sequence_error = false;
-
-	in_buffer = buffer;
-	out_size = in_left = size;
-	/* +1 for \0 termination of buffer */
-	out_buffer = SaveMalloc(out_size + 1, "buffer for encoding conversion");
-	out_pos = out_buffer;
-	out_left = out_size;
 
+	*illegal = (size_t)-1;
 	iconv(cd, NULL, 0, NULL, 0);    /* reset internal iconv state */
 
 	while(in_left)
 	{
+		out_pos = out->buffer + out->used;
+		out_left = out->size - out->used;
 		result = iconv(cd, &in_buffer, &in_left, &out_pos, &out_left);
+		out->used = (size_t)(out_pos - out->buffer);
 		if(result == (size_t)-1)
 		{
 			if(errno == EINVAL || errno == EILSEQ)	/* illegal bytes found */
 			{
-				if(!illegal_sequence_error)
-				{
-					illegal_sequence_error = true;
-					PrintError(WS_ENCODING_ERRORS, sgfc, (size_t)(in_buffer - buffer) + err_offset);
-				}
+				if(*illegal == (size_t)-1)
+					*illegal = (size_t)(in_buffer - buffer);
 				in_buffer++;
 				in_left--;
 				if(err_left != in_left+1)	 /* squash follow up errors */
@@ -213,18 +419,9 @@ char *DecodeBuffer(struct SGFInfo *sgfc, iconv_t cd,
 			if(errno == E2BIG || resize_out)	/* destination buffer is full */
 			{
 				/* bytes needed are estimated based on encoding progress so far
-				 * +1 because of edge case of out_size==in_left */
-				float needed = (float)in_left * (float)out_size / (float)(out_size - in_left + 1);
-				size_t increase = (size_t)(lrintf(needed*1.05f)) + 12; /* +5% + 3x 4 byte wide chars */
-				size_t new_size = out_size + increase;
-				/* +1 for \0 termination of buffer */
-				char *new_buffer = SaveMalloc(new_size+1, "temporary buffer for encoding conversion");
-				memcpy(new_buffer, out_buffer, out_size);
-				out_pos = new_buffer + (out_pos - out_buffer);
-				out_left += increase;
-				free(out_buffer);
-				out_buffer = new_buffer;
-				out_size = new_size;
+				 * +1 because of edge case of all input left */
+				size_t done = out->used - out_start;
+				GrowDecodeOutput(sgfc, out, (float)(in_left + pending) * (float)(done + 1) / (float)(size - in_left + 1));
 				if(!resize_out)
 					continue;
 				resize_out = false;
@@ -232,30 +429,270 @@ char *DecodeBuffer(struct SGFInfo *sgfc, iconv_t cd,
 
 			if(add_replacement)	/* add replacement character for illegal chars */
 			{
+				out_pos = out->buffer + out->used;
 				*out_pos++ = (char)0xEF; /* UTF-8 encoded replacement character */
 				*out_pos++ = (char)0xBF; /* U+FFFD */
 				*out_pos++ = (char)0xBD;
-				out_left -= 3;
+				out->used += 3;
 				add_replacement = false;
 				continue;
 			}
 
-			free(out_buffer);
-			iconv_close(cd);
-			PrintError(FE_ENCODING_ERROR, sgfc, (size_t)(in_buffer - buffer) + err_offset);
-			return NULL;
+			*fatal = (size_t)(in_buffer - buffer);
+			return false;
 		}
 	}
-	*out_pos = 0;  /* \0-terminate for convenience */
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	DecodeBuffer
+***				Decodes specified buffer using provided iconv descriptor.
+***				Scales output buffer incrementally, but might
+***				might allocate more memory than strictly necessary.
+*** Parameters: sgfc		... pointer to SGFInfo structure
+***				cd			... iconv conversion descriptor
+***				buffer		... start of input buffer
+***				size		... size of input buffer
+***				err_offset	... byte offset for error reporting purposes
+***				buffer_end	... output variable: end of decoded buffer
+*** Returns:	pointer to decoded buffer or NULL
+**************************************************************************/
+
+char *DecodeBuffer(struct SGFInfo *sgfc, iconv_t cd,
+				   char *buffer, size_t size, U_LONG err_offset,
+				   const char **buffer_end)
+{
+	struct DecodeOutput out = {NULL, 0, 0};
+	size_t illegal, fatal;
+	bool ok;
+
+	/* +1 for \0 termination of buffer */
+	out.buffer = SaveMalloc(sgfc, size + 1, "buffer for encoding conversion");
+	out.size = size;
+
+	ok = ConvertSegment(sgfc, cd, buffer, size, &out, 0, &illegal, &fatal);
+	if(illegal != (size_t)-1)
+		PrintError(WS_ENCODING_ERRORS, sgfc, illegal + err_offset);
+	if(!ok)
+	{
+		free(out.buffer);
+		PrintError(FE_ENCODING_ERROR, sgfc, fatal + err_offset);
+		return NULL;
+	}
+
+	out.buffer[out.used] = 0;  /* \0-terminate for convenience */
 	if(buffer_end)
-		*buffer_end = out_pos;
-	return out_buffer;
+		*buffer_end = out.buffer + out.used;
+	return out.buffer;
+}
+
+
+/**************************************************************************
+*** Function:	DecodeSegments
+***				Decodes several independent segments in one go into a
+***				single output buffer. Each segment is converted as if
+***				DecodeBuffer() were called on it (i.e. iconv state is
+***				reset and incomplete sequences at the end of a segment
+***				don't continue into the next one). No errors are printed;
+***				they are recorded in the segment structures instead.
+*** Parameters: sgfc		... pointer to SGFInfo structure
+***				cd			... iconv conversion descriptor
+***				seg			... segments (in, in_len filled in by caller)
+***				num			... number of segments
+***				out_size	... output variable: size of returned buffer
+*** Returns:	buffer with the decoded segments, each followed by '\0'
+***				(caller has to free it); output of a segment with a fatal
+***				error is empty.
+**************************************************************************/
+
+char *DecodeSegments(struct SGFInfo *sgfc, iconv_t cd,
+					 struct DecodeSegment *seg, size_t num, size_t *out_size)
+{
+	struct DecodeOutput out = {NULL, 0, 0};
+	size_t i, total = 0;
+
+	for(i = 0; i < num; i++)
+		total += seg[i].in_len + 1;
+	out.buffer = SaveMalloc(sgfc, total + 1, "buffer for encoding conversion");
+	out.size = total;
+
+	for(i = 0; i < num; i++, seg++)
+	{
+		total -= seg->in_len + 1;
+		seg->out_offset = out.used;
+		seg->ok = ConvertSegment(sgfc, cd, seg->in, seg->in_len, &out, total, &seg->illegal, &seg->fatal);
+		if(!seg->ok)
+			out.used = seg->out_offset;
+		seg->out_len = out.used - seg->out_offset;
+		if(out.used == out.size)
+			GrowDecodeOutput(sgfc, &out, (float)(num - i) * 4);
+		out.buffer[out.used++] = 0;
+	}
+	*out_size = out.used;
+	return out.buffer;
+}
+
+
+/* Probes for IsIdentityConversion(): all ASCII chars, and ASCII chars
+** plus UTF-8 sequences of 2, 3 and 4 bytes (U+00E4, U+20AC, U+1D11E) */
+#define ASCII_PROBE_SIZE	128
+#define UTF8_PROBE_SIZE		(128 + 9)
+
+
+/**************************************************************************
+*** Function:	SkipASCII
+***				Finds the end of a run of ASCII chars (< 0x80).
+***				Uses SSE2/AVX2 if available.
+*** Parameters: s ... start position
+***				e ... end position of buffer
+*** Returns:	pointer to first non-ASCII byte (or e)
+**************************************************************************/
+
+static const char *SkipASCII(const char *s, const char *e)
+{
+#if defined(__AVX2__)
+	while(e - s >= 32)
+	{
+		unsigned int high = (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)s));
+		if(high)
+			return s + __builtin_ctz(high);
+		s += 32;
+	}
+#endif
+#if defined(__SSE2__)
+	while(e - s >= 16)
+	{
+		unsigned int high = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)s));
+		if(high)
+			return s + __builtin_ctz(high);
+		s += 16;
+	}
+#endif
+
+	while(s < e && !(*s & 0x80))
+		s++;
+	return s;
+}
+
+
+/**************************************************************************
+*** Function:	IsValidUTF8
+***				Checks whether the buffer is well-formed UTF-8, i.e.
+***				without overlong forms, surrogates, and code points
+***				beyond U+10FFFF. Runs of ASCII chars are skipped in bulk.
+*** Parameters: s	  ... start of buffer
+***				e	  ... end of buffer
+***				ascii ... output variable: buffer is pure ASCII
+*** Returns:	true if buffer is valid UTF-8
+**************************************************************************/
+
+static bool IsValidUTF8(const char *s, const char *e, bool *ascii)
+{
+	const unsigned char *c;
+	unsigned char lo, hi;
+	int follow;
+
+	*ascii = true;
+	while((s = SkipASCII(s, e)) < e)
+	{
+		*ascii = false;
+		c = (const unsigned char *)s;
+		lo = 0x80;
+		hi = 0xBF;
+		if(*c >= 0xC2 && *c <= 0xDF)		follow = 1;
+		else if(*c >= 0xE0 && *c <= 0xEF)
+		{
+			follow = 2;
+			if(*c == 0xE0)		lo = 0xA0;	/* overlong */
+			else if(*c == 0xED)	hi = 0x9F;	/* surrogates */
+		}
+		else if(*c >= 0xF0 && *c <= 0xF4)
+		{
+			follow = 3;
+			if(*c == 0xF0)		lo = 0x90;	/* overlong */
+			else if(*c == 0xF4)	hi = 0x8F;	/* > U+10FFFF */
+		}
+		else
+			return false;
+
+		if(e - s <= follow || c[1] < lo || c[1] > hi)
+			return false;
+		for(int i = 2; i <= follow; i++)
+			if((c[i] & 0xC0) != 0x80)
+				return false;
+		s += follow + 1;
+	}
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	IsIdentityConversion
+***				Tests whether iconv leaves the probe unchanged
+***				(i.e. if valid input may be copied instead of decoded)
+*** Parameters: cd	  ... iconv conversion descriptor
+***				probe ... probe text
+***				size  ... size of probe
+*** Returns:	true/false
+**************************************************************************/
+
+static bool IsIdentityConversion(iconv_t cd, const char *probe, size_t size)
+{
+	char in[UTF8_PROBE_SIZE], out[4 * UTF8_PROBE_SIZE];
+	char *in_pos = in, *out_pos = out;
+	size_t in_left = size, out_left = sizeof(out);
+
+	memcpy(in, probe, size);
+	iconv(cd, NULL, 0, NULL, 0);	/* reset internal iconv state */
+	if(iconv(cd, &in_pos, &in_left, &out_pos, &out_left) == (size_t)-1 ||
+	   iconv(cd, NULL, 0, &out_pos, &out_left) == (size_t)-1)
+		return false;
+	return (size_t)(out_pos - out) == size && !memcmp(in, out, size);
+}
+
+
+/**************************************************************************
+*** Function:	NeedsDecoding
+***				Checks whether the buffer has to be run through iconv.
+***				That's not the case for pure ASCII (if the encoding
+***				maps ASCII to itself) and for valid UTF-8 (if the encoding
+***				is UTF-8). Invalid sequences always go to iconv, so that
+***				they are reported and replaced as usual.
+*** Parameters: cd	  ... iconv conversion descriptor
+***				s	  ... start of buffer
+***				e	  ... end of buffer
+*** Returns:	true/false
+**************************************************************************/
+
+static bool NeedsDecoding(iconv_t cd, const char *s, const char *e)
+{
+	char probe[UTF8_PROBE_SIZE];
+	bool utf8, ascii;
+
+	for(int i = 0; i < ASCII_PROBE_SIZE; i++)
+		probe[i] = (char)i;
+	memcpy(probe + ASCII_PROBE_SIZE, "\xC3\xA4\xE2\x82\xAC\xF0\x9D\x84\x9E", UTF8_PROBE_SIZE - ASCII_PROBE_SIZE);
+
+	utf8 = IsIdentityConversion(cd, probe, UTF8_PROBE_SIZE);
+	if(!utf8 && !IsIdentityConversion(cd, probe, ASCII_PROBE_SIZE))
+		return true;
+
+	if(!IsValidUTF8(s, e, &ascii))
+		return true;
+	return !ascii && !utf8;
 }
 
 
 /**************************************************************************
 *** Function:	DecodeSGFBuffer
 ***				Decodes complete SGF buffer
+***				If the buffer is already valid in the target encoding,
+***				iconv isn't used: the buffer itself is returned if it is
+***				writable (see SGFInfo.buffer_writable) or if it's a file
+***				mapping and values won't be sliced out of it (option
+***				verbatim), otherwise a copy.
 *** Parameters: sgfc		  ... pointer to SGFInfo structure
 ***				encbuffer_end ... output variable: end of decoded buffer
 ***				encoding_name ... output variable: name of encoding used
@@ -264,21 +701,38 @@ char *DecodeBuffer(struct SGFInfo *sgfc, iconv_t cd,
 
 char *DecodeSGFBuffer(struct SGFInfo *sgfc, const char **encbuffer_end, char **encoding_name)
 {
-	char *encoding = DetectEncoding(sgfc->buffer, sgfc->b_end);		/* might be NULL! */
+	char *encoding = DetectEncoding(sgfc, sgfc->buffer, sgfc->b_end);		/* might be NULL! */
 	const char *selected_encoding;
 	iconv_t cd = OpenIconV(sgfc, encoding, &selected_encoding);
 	if(encoding != selected_encoding)
 	{
 		free(encoding);
-		*encoding_name = SaveDupString(selected_encoding, 0, "encoding name");
+		*encoding_name = SaveDupString(sgfc, selected_encoding, 0, "encoding name");
 	}
 	else
 		*encoding_name = encoding;
 	if(!cd)
 		return NULL;
 
+	if(!NeedsDecoding(cd, sgfc->buffer, sgfc->b_end))
+	{
+		size_t size = (size_t)(sgfc->b_end - sgfc->buffer);
+		char *copy = sgfc->buffer;
+
+		ReleaseIConV(sgfc, cd);
+		if(!sgfc->buffer_writable && !(sgfc->buffer_mapped && sgfc->options->verbatim))
+		{
+			/* +1 for \0 termination of buffer */
+			copy = SaveMalloc(sgfc, size + 1, "buffer for encoding conversion");
+			memcpy(copy, sgfc->buffer, size);
+			copy[size] = 0;
+		}
+		*encbuffer_end = copy + size;
+		return copy;
+	}
+
 	char *encoded_buffer = DecodeBuffer(sgfc, cd, sgfc->buffer, (size_t)(sgfc->b_end - sgfc->buffer),
 										0, encbuffer_end);
-	iconv_close(cd);
+	ReleaseIConV(sgfc, cd);
 	return encoded_buffer;
 }
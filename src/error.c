@@ -7,6 +7,11 @@
 ***
 **************************************************************************/
 
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L		/* for strerror_r() */
+#define HAVE_STRERROR_R
+#endif
+
 #include <stdlib.h>
 #include <stdarg.h>
 #include <errno.h>
@@ -16,12 +21,6 @@
 #include "protos.h"
 
 
-/* Error reporting hooks */
-bool (*print_error_handler)(U_LONG, struct SGFInfo *, va_list) = PrintErrorHandler;
-void (*print_error_output_hook)(struct SGFCError *) = PrintErrorOutputHook;
-void (*oom_panic_hook)(const char *) = ExitWithOOMError;
-
-
 static const char *error_mesg[] =
 {
 		"unknown command '%s' (-h for help)\n",
@@ -114,6 +113,9 @@ static const char *error_mesg[] =
 		"charset encoding detection went wrong! Please use --encoding to override.\n",
 		"different charset encodings stored in one file (will cause troubles with applications)\n",
 		"different encodings in one file detected. Use option -E2/3 to parse this file\n",
+/* 75 */
+		"snapshot file '%s' %s\n",
+		"option '%s' cannot be used with --batch (-h for help)\n",
 };
 
 
@@ -128,7 +130,8 @@ struct ErrorC_internal {
 
 	char accumulate[ACCUMULATE_SIZE];
 	size_t acc_count;
-	U_LONG acc_row;		/* type & position of last accumulate error */
+	U_LONG acc_pos;		/* type & position of last accumulate error */
+	U_LONG acc_row;
 	U_LONG acc_col;
 	U_LONG acc_type;
 
@@ -139,13 +142,13 @@ struct ErrorC_internal {
 /**************************************************************************
 *** Function:	SetupErrorC_internal
 ***				Allocate and initialize internal data structure local to error.c
-*** Parameters: -
+*** Parameters: sgfc ... pointer to SGFInfo structure
 *** Returns:	pointer to internal structure
 **************************************************************************/
 
-struct ErrorC_internal *SetupErrorC_internal(void)
+struct ErrorC_internal *SetupErrorC_internal(struct SGFInfo *sgfc)
 {
-	struct ErrorC_internal *errc = SaveCalloc(sizeof(struct ErrorC_internal), "static error.c struct");
+	struct ErrorC_internal *errc = SaveCalloc(sgfc, sizeof(struct ErrorC_internal), "static error.c struct");
 	errc->acc_type = E_NO_ERROR;
 	return errc;
 }
@@ -153,16 +156,19 @@ struct ErrorC_internal *SetupErrorC_internal(void)
 
 /**************************************************************************
 *** Function:	PrintError
-***				Variadic wrapper around PrintErrorHandler
+***				Variadic wrapper around sgfc->print_error_handler
+***				(PrintErrorHandler by default)
 **************************************************************************/
 
 int PrintError(U_LONG type, struct SGFInfo *sgfc, ...) {
 	int result = 0;
 
 	va_list arglist;
+	if(type != E_NO_ERROR)
+		sgfc->_messages++;				/* also disabled & not printed ones */
 	va_start(arglist, sgfc);
-	if (print_error_handler)
-		result = (*print_error_handler)(type, sgfc, arglist);
+	if (sgfc->print_error_handler)
+		result = (*sgfc->print_error_handler)(type, sgfc, arglist);
 	va_end(arglist);
 	return result;
 }
@@ -173,9 +179,10 @@ int PrintError(U_LONG type, struct SGFInfo *sgfc, ...) {
 ***				Special error printer in case when memory runs out
 ***				Panics: does not return; does not free up resources; just dies
 ***				Might be called, when SGFInfo is not properly set up yet.
+***				Default oom_panic_hook of SGFInfo.
 **************************************************************************/
 
-void ExitWithOOMError(const char *detail)
+void ExitWithOOMError(struct SGFInfo *sgfc, const char *detail)
 {
 	int err_num = FE_OUT_OF_MEMORY & M_ERROR_NUM;
 	fprintf(E_OUTPUT, "Fatal error %d: ", err_num);
@@ -199,7 +206,7 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 	int print_c = 0;
 	struct SGFCError error = {0, NULL, 0, 0, 0};
 	char *error_msg_buffer = NULL, *val_pos = NULL, *illegal = NULL;
-	U_LONG row = 0, col = 0;
+	U_LONG pos = 0, row = 0, col = 0;
 	size_t illegal_count;
 	va_list argtmp;
 
@@ -231,8 +238,8 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 
 	if(type & E_SEARCHPOS)			/* get pointer to position if required */
 	{
-		row = va_arg(arglist, U_LONG);
-		col = va_arg(arglist, U_LONG);
+		pos = va_arg(arglist, U_LONG);
+		ResolvePosition(sgfc, pos, &row, &col);
 
 		if(row == sgfc->_error_c->last_row && col == sgfc->_error_c->last_col &&
 		   type == sgfc->_error_c->last_type && type & E_DEL_DOUBLE)
@@ -259,9 +266,9 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 				   (sgfc->_error_c->acc_col + sgfc->_error_c->acc_count != col) ||
 				   ((sgfc->_error_c->acc_type & M_ERROR_NUM) != (type & M_ERROR_NUM)))
 				{
-					PrintError(sgfc->_error_c->acc_type, sgfc,
-							   sgfc->_error_c->acc_row, sgfc->_error_c->acc_col, false);
-					sgfc->_error_c->acc_row = row;	/* set new */
+					PrintError(sgfc->_error_c->acc_type, sgfc, sgfc->_error_c->acc_pos, false);
+					sgfc->_error_c->acc_pos = pos;	/* set new */
+					sgfc->_error_c->acc_row = row;
 					sgfc->_error_c->acc_col = col;
 					sgfc->_error_c->acc_type = type;
 				}
@@ -269,6 +276,7 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 			else								/* first error */
 			{
 				sgfc->_error_c->acc_type = type;	/* set data */
+				sgfc->_error_c->acc_pos = pos;
 				sgfc->_error_c->acc_row = row;
 				sgfc->_error_c->acc_col = col;
 			}
@@ -289,8 +297,7 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 					illegal += chunk;
 				}
 				/* flush accumulate buffer (sets acc_count=0) */
-				PrintError(sgfc->_error_c->acc_type, sgfc,
-						   sgfc->_error_c->acc_row, sgfc->_error_c->acc_col, false);
+				PrintError(sgfc->_error_c->acc_type, sgfc, sgfc->_error_c->acc_pos, false);
 			}
 			/* any remainders should now be small enough to fit */
 			if(illegal_count)
@@ -308,8 +315,7 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 	else								/* not an ACCUMULATE type */
 	if(sgfc->_error_c->acc_count)	/* any errors waiting? */
 		/* flush buffer and continue ! */
-		PrintError(sgfc->_error_c->acc_type, sgfc,
-				   sgfc->_error_c->acc_row, sgfc->_error_c->acc_col, false);
+		PrintError(sgfc->_error_c->acc_type, sgfc, sgfc->_error_c->acc_pos, false);
 
 	if(type == E_NO_ERROR)
 		return true;
@@ -377,8 +383,8 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 		error.lib_errno = errno;
 
 	error.error = type;
-	if(print_error_output_hook)
-		(*print_error_output_hook)(&error);		/* call output hook function */
+	if(sgfc->print_error_output_hook)
+		(*sgfc->print_error_output_hook)(sgfc, &error);	/* call output hook function */
 	free(error_msg_buffer);
 	return true;
 }
@@ -387,11 +393,12 @@ bool PrintErrorHandler(U_LONG type, struct SGFInfo *sgfc, va_list arglist) {
 /**************************************************************************
 *** Function:	PrintErrorOutputHook
 ***				Prints an error message to E_OUTPUT (stdout)
-*** Parameters: error ... structure that contains error information
+*** Parameters: sgfc  ... pointer to SGFInfo structure
+***				error ... structure that contains error information
 *** Returns:    -
 **************************************************************************/
 
-void PrintErrorOutputHook(struct SGFCError *error)
+void PrintErrorOutputHook(struct SGFInfo *sgfc, struct SGFCError *error)
 {
 	CommonPrintErrorOutputHook(error, E_OUTPUT);
 }
@@ -420,9 +427,13 @@ void CommonPrintErrorOutputHook(struct SGFCError *error, FILE *stream)
 
 	if(error->error & E_ERRNO)			/* print DOS error message? */
 	{
-		char *err;
-		err = strerror(error->lib_errno);
+#ifdef HAVE_STRERROR_R
+		char err[256];						/* strerror() isn't thread-safe */
+		if(!strerror_r(error->lib_errno, err, sizeof(err)))
+#else
+		const char *err = strerror(error->lib_errno);
 		if(err)
+#endif
 			fprintf(stream, "%s\n", err);
 		else
 			fprintf(stream, "error code: %d\n", error->lib_errno);
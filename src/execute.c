@@ -14,87 +14,362 @@
 
 
 /**************************************************************************
-*** Function:	MakeCapture
-***				Captures stones on marked by RecursiveCapture
-*** Parameters: x ... x position
-***				y ... y position
+*** Function:	SetupChainBoard
+***				Allocates chain information for an empty board
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				area ... number of board positions
+*** Returns:	pointer to ChainBoard (free() when done)
+**************************************************************************/
+
+struct ChainBoard *SetupChainBoard(struct SGFInfo *sgfc, size_t area)
+{
+	struct ChainBoard *cb = SaveMalloc(sgfc, sizeof(struct ChainBoard) + 4 * area * sizeof(U_SHORT),
+									   "chain board buffer");
+	cb->head = cb->data;
+	cb->next = cb->head + area;
+	cb->libs = cb->next + area;
+	cb->size = cb->libs + area;
+	cb->valid = true;						/* empty board has no chains */
+	return cb;
+}
+
+
+/**************************************************************************
+*** Function:	ZobristKey
+***				Returns the Zobrist key of a stone: output number
+***				2 * pos + 0 for black / 1 for white (counting from 0)
+***				of SplitMix64 with seed 0. The hash of a
+***				position is the XOR of the keys of all its stones; hashes
+***				are comparable for boards of the same size only.
+*** Parameters: pos	  ... position (MXY)
+***				color ... BLACK or WHITE
+*** Returns:	64bit key
+**************************************************************************/
+
+uint64_t ZobristKey(int pos, unsigned char color)
+{
+	uint64_t z = ((uint64_t)pos * 2 + (color == WHITE) + 1) * UINT64_C(0x9e3779b97f4a7c15);
+
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+
+/**************************************************************************
+*** Function:	Journal
+***				Logs the previous value of a board / chain entry
+*** Parameters: j	  ... journal
+***				index ... see struct BoardUndo
+***				old	  ... previous value
 *** Returns:	-
 **************************************************************************/
 
-static void MakeCapture(int x, int y, struct BoardStatus *st)
+static void Journal(struct BoardJournal *j, size_t index, U_SHORT old)
 {
-	if(st->paths->board[MXY(x,y)] != st->paths->num)
-		return;
+	if(j->num == j->max)
+		j->undo = GrowStack(j->sgfc, j->undo, &j->max, sizeof(struct BoardUndo));
+	j->undo[j->num].index = index;
+	j->undo[j->num].old = old;
+	j->num++;
+}
+
+
+/**************************************************************************
+*** Function:	SetBoard / SetChain
+***				Changes a board position / chain entry (logged if
+***				there's a journal)
+*** Parameters: st	  ... board status
+***				pos	  ... position / field ... pointer to chain entry
+***				value ... new value
+*** Returns:	-
+**************************************************************************/
 
-	st->board[MXY(x,y)] = EMPTY;
-	st->paths->board[MXY(x,y)] = 0;
+static inline void SetBoard(struct BoardStatus *st, int pos, unsigned char value)
+{
+	if(st->journal)
+		Journal(st->journal, (size_t)pos, st->board[pos]);
+	if(st->board[pos])
+		st->hash ^= ZobristKey(pos, st->board[pos]);
+	if(value)
+		st->hash ^= ZobristKey(pos, value);
+	st->board[pos] = value;
+	if(st->bits)
+		SetBitBoard(st->bits, pos, value);
+}
 
-	/* recursive calls */
-	if(x > 0) MakeCapture(x - 1, y, st);
-	if(y > 0) MakeCapture(x, y - 1, st);
-	if(x < st->bwidth-1) MakeCapture(x + 1, y, st);
-	if(y < st->bheight-1) MakeCapture(x, y + 1, st);
+static inline void SetChain(struct BoardStatus *st, U_SHORT *field, int value)
+{
+	if(st->journal)
+		Journal(st->journal, (size_t)(st->bwidth * st->bheight + (field - st->chains->data)), *field);
+	*field = (U_SHORT)value;
 }
 
 
 /**************************************************************************
-*** Function:	RecursiveCapture
-***				Checks for capturing stones
-***				marks its path on path_board with path_num
-*** Parameters: color ... enemy color
-***				x	  ... x position
-***				y	  ... y position
-*** Returns:	true if capture / false if liberty found
+*** Function:	UndoBoard
+***				Rolls back board & chains to an earlier journal state
+***				(hash is restored by the caller with the board status)
+*** Parameters: st	 ... board status
+***				mark ... number of journal entries to keep
+*** Returns:	-
 **************************************************************************/
 
-static bool RecursiveCapture(unsigned char color, int x, int y, struct BoardStatus *st)
+void UndoBoard(struct BoardStatus *st, size_t mark)
 {
-	if(!st->board[MXY(x,y)])
-		return false;		/* liberty found */
+	struct BoardJournal *j = st->journal;
+	size_t area = (size_t)(st->bwidth * st->bheight);
+	struct BoardUndo *u;
 
-	if(st->board[MXY(x,y)] == color)
-		return true;		/* enemy found */
+	while(j->num > mark)
+	{
+		u = &j->undo[--j->num];
+		if(u->index < area)
+		{
+			st->board[u->index] = (unsigned char)u->old;
+			if(st->bits)
+				SetBitBoard(st->bits, (int)u->index, (unsigned char)u->old);
+		}
+		else
+			st->chains->data[u->index - area] = u->old;
+	}
+}
 
-	if(st->paths->board[MXY(x,y)] == st->paths->num)
-		return true;
 
-	st->paths->board[MXY(x,y)] = st->paths->num;
+/**************************************************************************
+*** Function:	SetMarkup
+***				Sets a markup flag (position is remembered for
+***				clearing it before the next node)
+*** Parameters: st	 ... board status
+***				pos	 ... position (MXY)
+***				flag ... ST_xxx flag
+*** Returns:	-
+**************************************************************************/
 
-	/* recursive calls */
-	if(x > 0 			 && !RecursiveCapture(color, x - 1, y, st))	return false;
-	if(y > 0 			 && !RecursiveCapture(color, x, y - 1, st))	return false;
-	if(x < st->bwidth-1  && !RecursiveCapture(color, x + 1, y, st))	return false;
-	if(y < st->bheight-1 && !RecursiveCapture(color, x, y + 1, st))	return false;
+static void SetMarkup(struct BoardStatus *st, int pos, U_SHORT flag)
+{
+	if(!st->markup[pos])
+		st->markup_list->pos[st->markup_list->num++] = (U_SHORT)pos;
+	st->markup[pos] |= flag;
+}
 
-	return true;
+
+/**************************************************************************
+*** Function:	ClearMarkup
+***				Clears markup flags set by previous node
+*** Parameters: st ... board status
+*** Returns:	-
+**************************************************************************/
+
+void ClearMarkup(struct BoardStatus *st)
+{
+	struct MarkupList *ml = st->markup_list;
+
+	while(ml->num)
+		st->markup[ml->pos[--ml->num]] = 0;
 }
 
 
 /**************************************************************************
-*** Function:	CaptureStones
-***				Calls RecursiveCapture and does capture if necessary
-*** Parameters: st	  ... board status
-***				color ... color of enemy stones
-***				x	  ... column
-***				y	  ... row
+*** Function:	Neighbours
+***				Gets the positions next to a position
+*** Parameters: st	... board status
+***				pos	... position (MXY)
+***				nb	... output: up to 4 positions
+*** Returns:	number of neighbours
+**************************************************************************/
+
+static int Neighbours(const struct BoardStatus *st, int pos, int nb[4])
+{
+	int x = pos % st->bwidth, y = pos / st->bwidth, num = 0;
+
+	if(x > 0)				nb[num++] = pos - 1;
+	if(y > 0)				nb[num++] = pos - st->bwidth;
+	if(x < st->bwidth-1)	nb[num++] = pos + 1;
+	if(y < st->bheight-1)	nb[num++] = pos + st->bwidth;
+	return num;
+}
+
+
+/**************************************************************************
+*** Function:	MergeChains
+***				Merges the chains of two stones of same color
+***				(stones of the smaller chain get the new head)
+*** Parameters: st ... board status
+***				a  ... position of stone of first chain
+***				b  ... position of stone of second chain
+*** Returns:	-
+**************************************************************************/
+
+static void MergeChains(struct BoardStatus *st, int a, int b)
+{
+	struct ChainBoard *cb = st->chains;
+	U_SHORT ha = cb->head[a], hb = cb->head[b], s, tmp;
+
+	if(ha == hb)
+		return;
+	if(cb->size[ha] < cb->size[hb])
+	{
+		tmp = ha; ha = hb; hb = tmp;
+	}
+
+	s = hb;
+	do {
+		SetChain(st, &cb->head[s], ha);
+		s = cb->next[s];
+	} while(s != hb);
+
+	tmp = cb->next[ha];						/* join circular lists */
+	SetChain(st, &cb->next[ha], cb->next[hb]);
+	SetChain(st, &cb->next[hb], tmp);
+	SetChain(st, &cb->size[ha], cb->size[ha] + cb->size[hb]);
+	SetChain(st, &cb->libs[ha], cb->libs[ha] + cb->libs[hb]);
+}
+
+
+/**************************************************************************
+*** Function:	BuildChains
+***				Rebuilds the chains from the board (after setup
+***				properties or moves onto occupied positions)
+*** Parameters: st ... board status
+*** Returns:	-
+**************************************************************************/
+
+static void BuildChains(struct BoardStatus *st)
+{
+	struct ChainBoard *cb = st->chains;
+	int area = st->bwidth * st->bheight, nb[4], num, pos, i, libs;
+
+	for(pos = 0; pos < area; pos++)
+	{
+		if(!st->board[pos])
+			continue;
+		num = Neighbours(st, pos, nb);
+		for(libs = 0, i = 0; i < num; i++)
+			if(!st->board[nb[i]])
+				libs++;
+		SetChain(st, &cb->head[pos], pos);
+		SetChain(st, &cb->next[pos], pos);
+		SetChain(st, &cb->size[pos], 1);
+		SetChain(st, &cb->libs[pos], libs);
+	}
+
+	for(pos = 0; pos < area; pos++)		/* right & lower neighbour is enough */
+	{
+		if(!st->board[pos])
+			continue;
+		if((pos + 1) % st->bwidth && st->board[pos + 1] == st->board[pos])
+			MergeChains(st, pos, pos + 1);
+		if(pos + st->bwidth < area && st->board[pos + st->bwidth] == st->board[pos])
+			MergeChains(st, pos, pos + st->bwidth);
+	}
+	cb->valid = true;
+}
+
+
+/**************************************************************************
+*** Function:	AddChainStone
+***				Adds a stone on an empty position to the chains
+*** Parameters: st	... board status (stone is already set on board)
+***				pos	... position of new stone
 *** Returns:	-
 **************************************************************************/
 
-static void CaptureStones(struct BoardStatus *st, unsigned char color, int x, int y)
+static void AddChainStone(struct BoardStatus *st, int pos)
 {
-	if(x < 0 || y < 0 || x >= st->bwidth || y >= st->bheight)
-		return;		/* not on board */
+	struct ChainBoard *cb = st->chains;
+	int nb[4], num, i, libs = 0;
+
+	num = Neighbours(st, pos, nb);
+	for(i = 0; i < num; i++)
+	{
+		if(!st->board[nb[i]])
+			libs++;
+		else								/* pos was a liberty of neighbour */
+			SetChain(st, &cb->libs[cb->head[nb[i]]], cb->libs[cb->head[nb[i]]] - 1);
+	}
+	SetChain(st, &cb->head[pos], pos);
+	SetChain(st, &cb->next[pos], pos);
+	SetChain(st, &cb->size[pos], 1);
+	SetChain(st, &cb->libs[pos], libs);
+
+	for(i = 0; i < num; i++)
+		if(st->board[nb[i]] == st->board[pos])
+			MergeChains(st, pos, nb[i]);
+}
 
-	if(!st->board[MXY(x,y)] || st->board[MXY(x,y)] == color)
-		return;		/* liberty or friend found */
 
-	st->paths->num++;
+/**************************************************************************
+*** Function:	RemoveChain
+***				Captures a chain (adds liberties to its neighbours)
+*** Parameters: st	 ... board status
+***				head ... position of head of chain
+*** Returns:	-
+**************************************************************************/
 
-	if(RecursiveCapture(color, x, y, st))	/* made prisoners? */
-		MakeCapture(x, y, st);				/* ->update board position */
+static void RemoveChain(struct BoardStatus *st, U_SHORT head)
+{
+	struct ChainBoard *cb = st->chains;
+	int nb[4], num, i;
+	U_SHORT s = head;
+
+	do {
+		SetBoard(st, s, EMPTY);
+		s = cb->next[s];
+	} while(s != head);
+
+	do {
+		num = Neighbours(st, s, nb);
+		for(i = 0; i < num; i++)
+			if(st->board[nb[i]])
+				SetChain(st, &cb->libs[cb->head[nb[i]]], cb->libs[cb->head[nb[i]]] + 1);
+		s = cb->next[s];
+	} while(s != head);
 }
 
 
+/**************************************************************************
+*** Function:	PlayStone
+***				Puts a stone on the board, removes enemy chains without
+***				liberties next to it, and finally its own chain in case
+***				of suicide
+*** Parameters: st	  ... board status
+***				pos	  ... position of move
+***				color ... color of move
+*** Returns:	-
+**************************************************************************/
+
+static void PlayStone(struct BoardStatus *st, int pos, unsigned char color)
+{
+	struct ChainBoard *cb = st->chains;
+	int nb[4], num, i;
+	bool occupied = st->board[pos] != EMPTY;
+
+	SetBoard(st, pos, color);
+	if(st->bits)
+	{
+		int captured[MAX_BITBOARD_SIZE * MAX_BITBOARD_SIZE];
+
+		num = CaptureBits(st->bits, pos, color, captured);
+		for(i = 0; i < num; i++)
+			SetBoard(st, captured[i], EMPTY);
+		return;
+	}
+
+	if(occupied || !cb->valid)
+		BuildChains(st);
+	else
+		AddChainStone(st, pos);
+
+	num = Neighbours(st, pos, nb);
+	for(i = 0; i < num; i++)				/* check for prisoners */
+		if(st->board[nb[i]] && st->board[nb[i]] != color && !cb->libs[cb->head[nb[i]]])
+			RemoveChain(st, cb->head[nb[i]]);
+
+	if(!cb->libs[cb->head[pos]])			/* check for suicide */
+		RemoveChain(st, cb->head[pos]);
+}
+
 
 /**************************************************************************
 *** Function:	Do_Move
@@ -116,7 +391,7 @@ bool Do_Move(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 
 	if(st->annotate & ST_MOVE)	/* there's a move already? */
 	{
-		PrintError(E_TWO_MOVES_IN_NODE, sgfc, p->row, p->col);
+		PrintError(E_TWO_MOVES_IN_NODE, sgfc, p->pos);
 		SplitNode(sgfc, n, 0, p->id, true);
 		return true;
 	}
@@ -131,20 +406,14 @@ bool Do_Move(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 	color = (unsigned char)sgf_token[p->id].data;
 
 	if(st->board[MXY(x,y)])
-		PrintError(WS_ILLEGAL_MOVE, sgfc, p->row, p->col);
+		PrintError(WS_ILLEGAL_MOVE, sgfc, p->pos);
 
-	st->board[MXY(x,y)] = color;
-	CaptureStones(st, color, x - 1, y);		/* check for prisoners */
-	CaptureStones(st, color, x + 1, y);
-	CaptureStones(st, color, x, y - 1);
-	CaptureStones(st, color, x, y + 1);
-	CaptureStones(st, (unsigned char)~color, x, y);		/* check for suicide */
+	PlayStone(st, MXY(x,y), color);
 
 	if(sgfc->options->del_move_markup)		/* if del move markup, then */
 	{										/* mark move position as markup */
-		st->markup[MXY(x,y)] |= ST_MARKUP;	/* -> other markup at this */
-		st->markup_changed = true;			/* position will be deleted */
-	}
+		SetMarkup(st, MXY(x,y), ST_MARKUP);	/* -> other markup at this */
+	}										/* position will be deleted */
 
 	return true;
 }
@@ -164,6 +433,7 @@ bool Do_AddStones(struct SGFInfo *sgfc, struct Node *n, struct Property *p, stru
 {
 	int x, y;
 	unsigned char color;
+	uint64_t h;
 	struct PropValue *v;
 
 	if(sgfc->info->GM != 1)		/* game != Go? */
@@ -179,22 +449,25 @@ bool Do_AddStones(struct SGFInfo *sgfc, struct Node *n, struct Property *p, stru
 
 		if(st->markup[MXY(x,y)] & ST_ADDSTONE)
 		{
-			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->row, v->col, v->value, "AddStone", p->idstr);
+			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->pos, v->value, "AddStone", p->idstr);
 			v = DelPropValue(p, v);
 			continue;
 		}
 
-		st->markup[MXY(x,y)] |= ST_ADDSTONE;
-		st->markup_changed = true;
+		SetMarkup(st, MXY(x,y), ST_ADDSTONE);
 
 		if(st->board[MXY(x,y)] == color)		/* Add property is redundant */
 		{
-			PrintError(WS_ADDSTONE_REDUNDANT, sgfc, v->row, v->col, v->value, p->idstr);
+			PrintError(WS_ADDSTONE_REDUNDANT, sgfc, v->pos, v->value, p->idstr);
 			v = DelPropValue(p, v);
 			continue;
 		}
 
-		st->board[MXY(x,y)] = color;
+		h = st->hash;
+		SetBoard(st, MXY(x,y), color);
+		st->setup_hash ^= h ^ st->hash;		/* see Check_Properties() */
+		if(st->chains)
+			st->chains->valid = false;
 		v = v->next;
 	}
 
@@ -229,12 +502,11 @@ bool Do_Letter(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct
 
 		if(st->markup[MXY(x,y)] & ST_LABEL)
 		{
-			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->row, v->col, v->value, "Label", p->idstr);
+			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->pos, v->value, "Label", p->idstr);
 		}
 		else
 		{
-			st->markup[MXY(x,y)] |= ST_LABEL;
-			st->markup_changed = true;
+			SetMarkup(st, MXY(x,y), ST_LABEL);
 			NewPropValue(sgfc, n, TKN_LB, v->value, letter, false);
 			letter[0]++;
 		}
@@ -272,12 +544,11 @@ bool Do_Mark(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 
 		if(st->markup[MXY(x,y)] & ST_MARKUP)
 		{
-			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->row, v->col, v->value, "Markup", p->idstr);
+			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->pos, v->value, "Markup", p->idstr);
 		}
 		else
 		{
-			st->markup[MXY(x,y)] |= ST_MARKUP;
-			st->markup_changed = true;
+			SetMarkup(st, MXY(x,y), ST_MARKUP);
 
 			if(st->board[MXY(x,y)])
 				NewPropValue(sgfc, n, TKN_TR, v->value, NULL, false);
@@ -322,7 +593,7 @@ bool Do_Markup(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct
 		{
 			if(empty)	/* if we already have an empty value */
 			{
-				PrintError(E_EMPTY_VALUE_DELETED, sgfc, v->row, v->col, "Markup", p->idstr);
+				PrintError(E_EMPTY_VALUE_DELETED, sgfc, v->pos, "Markup", p->idstr);
 				v = DelPropValue(p, v);
 				continue;
 			}
@@ -337,13 +608,12 @@ bool Do_Markup(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct
 
 		if(st->markup[MXY(x,y)] & flag)
 		{
-			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->row, v->col, v->value, "Markup", p->idstr);
+			PrintError(E_POSITION_NOT_UNIQUE, sgfc, v->pos, v->value, "Markup", p->idstr);
 			v = DelPropValue(p, v);
 			continue;
 		}
 
-		st->markup[MXY(x,y)] |= flag;
-		st->markup_changed = true;
+		SetMarkup(st, MXY(x,y), flag);
 		v = v->next;
 	}
 
@@ -353,7 +623,7 @@ bool Do_Markup(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct
 		while(v) {
 			if(!v->value_len)
 			{
-				PrintError(E_EMPTY_VALUE_DELETED, sgfc, v->row, v->col, "Markup", p->idstr);
+				PrintError(E_EMPTY_VALUE_DELETED, sgfc, v->pos, "Markup", p->idstr);
 				v = DelPropValue(p, v);
 				continue;
 			}
@@ -384,11 +654,11 @@ bool Do_Annotate(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struc
 
 	if((st->annotate & ST_ANN_BM) && p->id == TKN_TE) /* DO (doubtful) */
 	{
-		PrintError(E4_BM_TE_IN_NODE, sgfc, p->row, p->col, "BM-TE", "DO");
+		PrintError(E4_BM_TE_IN_NODE, sgfc, p->pos, "BM-TE", "DO");
 		hlp = FindProperty(n, TKN_BM);
 		hlp->id = TKN_DO;
-		free(hlp->idstr);
-		hlp->idstr = SaveDupString(sgf_token[TKN_DO].id, 0, "DO id string");
+		hlp->idstr = sgf_token[TKN_DO].id;
+		OwnPropValue(sgfc, hlp->value);
 		hlp->value->value[0] = 0;
 		hlp->value->value_len = 0;
 		return false;
@@ -396,11 +666,11 @@ bool Do_Annotate(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struc
 
 	if(st->annotate & ST_ANN_TE && p->id == TKN_BM)	/* IT (interesting) */
 	{
-		PrintError(E4_BM_TE_IN_NODE, sgfc, p->row, p->col, "TE-BM", "IT");
+		PrintError(E4_BM_TE_IN_NODE, sgfc, p->pos, "TE-BM", "IT");
 		hlp = FindProperty(n, TKN_TE);
 		hlp->id = TKN_IT;
-		free(hlp->idstr);
-		hlp->idstr = SaveDupString(sgf_token[TKN_IT].id, 0, "DO id string");
+		hlp->idstr = sgf_token[TKN_IT].id;
+		OwnPropValue(sgfc, hlp->value);
 		hlp->value->value[0] = 0;
 		hlp->value->value_len = 0;
 		return false;
@@ -408,13 +678,13 @@ bool Do_Annotate(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struc
 
 	if(st->annotate & flag)
 	{
-		PrintError(E_ANNOTATE_NOT_UNIQUE, sgfc, p->row, p->col, p->idstr);
+		PrintError(E_ANNOTATE_NOT_UNIQUE, sgfc, p->pos, p->idstr);
 		return false;
 	}
 
 	if((flag & (ST_ANN_MOVE|ST_KO)) && !(st->annotate & ST_MOVE))
 	{
-		PrintError(E_ANNOTATE_WITHOUT_MOVE, sgfc, p->row, p->col, p->idstr);
+		PrintError(E_ANNOTATE_WITHOUT_MOVE, sgfc, p->pos, p->idstr);
 		return false;
 	}
 
@@ -437,7 +707,7 @@ bool Do_Root(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 {
 	if(n->parent)
 	{
-		PrintError(E_ROOTP_NOT_IN_ROOTN, sgfc, p->row, p->col, p->idstr);
+		PrintError(E_ROOTP_NOT_IN_ROOTN, sgfc, p->pos, p->idstr);
 		return false;
 	}
 	return true;
@@ -461,8 +731,9 @@ bool Do_GInfo(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct B
 
 	if(st->ginfo && (st->ginfo != n))
 	{
-		PrintError(E4_GINFO_ALREADY_SET, sgfc, p->row, p->col, p->idstr,
-			 	   st->ginfo->row, st->ginfo->col);
+		U_LONG row, col;
+		ResolvePosition(sgfc, st->ginfo->pos, &row, &col);
+		PrintError(E4_GINFO_ALREADY_SET, sgfc, p->pos, p->idstr, row, col);
 		return false;
 	}
 
@@ -471,13 +742,13 @@ bool Do_GInfo(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct B
 		return true;
 
 	if(FindProperty(n, TKN_KM))
-		PrintError(W_INT_KOMI_FOUND, sgfc, p->row, p->col, "deleted (<KM> property found)");
+		PrintError(W_INT_KOMI_FOUND, sgfc, p->pos, "deleted (<KM> property found)");
 	else
 	{
-		PrintError(W_INT_KOMI_FOUND, sgfc, p->row, p->col, "converted to <KM>");
+		PrintError(W_INT_KOMI_FOUND, sgfc, p->pos, "converted to <KM>");
 
 		ki = strtol(p->value->value, NULL, 10);		/* we can ignore errors here */
-		new_km = SaveMalloc(p->value->value_len+3, "new KM number value");
+		new_km = SaveMalloc(sgfc, p->value->value_len+3, "new KM number value");
 		if(ki % 2)	sprintf(new_km, "%ld.5", ki/2);
 		else		sprintf(new_km, "%ld", ki/2);
 		NewPropValue(sgfc, n, TKN_KM, new_km, NULL, false);
@@ -508,7 +779,7 @@ bool Do_View(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 	{
 		if(v->next)
 		{
-			PrintError(E_BAD_VW_VALUES, sgfc, p->row, p->col,
+			PrintError(E_BAD_VW_VALUES, sgfc, p->pos,
 			  		   "values after '[]' value found", "deleted");
 			v = v->next;
 			while(v)
@@ -522,7 +793,7 @@ bool Do_View(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 	{
 		if(!v->value_len)	/* '[]' within other values */
 		{
-			PrintError(E_BAD_VW_VALUES, sgfc, v->row, v->col,
+			PrintError(E_BAD_VW_VALUES, sgfc, v->pos,
 			  		   "empty value found in list", "deleted");
 			v = DelPropValue(p, v);
 		}
@@ -547,7 +818,7 @@ bool Do_View(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 
 			if(!ExpandPointList(sgfc, p, v, false))
 			{
-				PrintError(E_BAD_VW_VALUES, sgfc, v->row, v->col,
+				PrintError(E_BAD_VW_VALUES, sgfc, v->pos,
 			   			   "illegal FF[3] definition", "deleted");
 				return false;
 			}
@@ -555,7 +826,7 @@ bool Do_View(struct SGFInfo *sgfc, struct Node *n, struct Property *p, struct Bo
 			DelPropValue(p, v);
 		}
 		else		/* looks like FF4 definition (wrong FF set?) */
-			PrintError(E_BAD_VW_VALUES, sgfc, p->row, p->col,
+			PrintError(E_BAD_VW_VALUES, sgfc, p->pos,
 			  		   "FF[4] definition in older FF found", "parsing done anyway");
 	}
 
@@ -602,16 +602,16 @@ static int PromptGameInfo(struct SGFInfo *sgfc, struct Property *p,
 
 	if(!sgfc->options->interactive)
 	{
-		PrintError(E4_FAULTY_GC, sgfc, v->row, v->col, v->value, p->idstr, "(not corrected!)");
+		PrintError(E4_FAULTY_GC, sgfc, v->pos, v->value, p->idstr, "(not corrected!)");
 		return true;
 	}
 
 	size = v->value_len;
 	if(size < 25)		/* CorrectDate may use up to 15 chars */
 		size = 25;
-	newgi = SaveDupString(v->value, size, "game info value buffer");
+	newgi = SaveDupString(sgfc, v->value, size, "game info value buffer");
 
-	PrintError(E4_FAULTY_GC, sgfc, v->row, v->col, v->value, p->idstr, "");
+	PrintError(E4_FAULTY_GC, sgfc, v->pos, v->value, p->idstr, "");
 
 	while(true)
 	{
@@ -635,9 +635,8 @@ static int PromptGameInfo(struct SGFInfo *sgfc, struct Property *p,
 			ret = (*Parse_Value)(inp, 0);
 			if(ret == 1)
 			{
-				free(v->value);
 				v->value_len = strlen(inp);
-				v->value = SaveMalloc(v->value_len+4, "game info value buffer");
+				v->value = ArenaAllocString(sgfc, v->value_len+4);
 				strcpy(v->value, inp);
 				break;
 			}
@@ -647,7 +646,7 @@ static int PromptGameInfo(struct SGFInfo *sgfc, struct Property *p,
 			{
 				size = (strlen(inp) > 25) ? strlen(inp) : 25;
 				free(newgi);
-				newgi = SaveDupString(inp, size, "game info value buffer");
+				newgi = SaveDupString(sgfc, inp, size, "game info value buffer");
 			}
 		}
 		else					/* [return] */
@@ -690,7 +689,7 @@ bool Check_GameInfo(struct SGFInfo *sgfc, struct Property *p, struct PropValue *
 	size = (v->value_len > 25-8) ? (v->value_len + 8) : (25+1);
 	/* correct functions may use up to 25 bytes; +8 because time in hours multiplies by 3600 and adds ".0" */
 
-	val = SaveMalloc(size, "result value buffer");
+	val = SaveMalloc(sgfc, size, "result value buffer");
 	strcpy(val, v->value);
 	size_t val_len = v->value_len;
 	res = (*parse)(val, &val_len);
@@ -708,20 +707,18 @@ bool Check_GameInfo(struct SGFInfo *sgfc, struct Property *p, struct PropValue *
 		switch(res)
 		{
 			case 0:
-				PrintError(E4_FAULTY_GC, sgfc, v->row, v->col, v->value, p->idstr, "(NOT CORRECTED!)");
+				PrintError(E4_FAULTY_GC, sgfc, v->pos, v->value, p->idstr, "(NOT CORRECTED!)");
 				break;
 			case -1:
-				PrintError(E4_BAD_VALUE_CORRECTED, sgfc, v->row, v->col, v->value, p->idstr, val);
-				free(v->value);
-				v->value = val;
-				v->value_len = val_len;
-				return true;
+				PrintError(E4_BAD_VALUE_CORRECTED, sgfc, v->pos, v->value, p->idstr, val);
+				res = 2;
+				break;
 		}
 	}
 
-	if(res == 2)
+	if(res == 2)	/* corrected value may be longer than original */
 	{
-		strcpy(v->value, val);
+		v->value = ArenaDupString(sgfc, val, val_len);
 		v->value_len = val_len;
 	}
 
@@ -13,15 +13,35 @@
 ***			and read/modify load->current
 **************************************************************************/
 
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L		/* for mmap(), posix_madvise() */
+#define HAVE_MMAP
+#endif
+
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "all.h"
 #include "protos.h"
 
 #define SGF_EOF			(load->current >= load->b_end)
+#define SGF_POS(p)		((U_LONG)((p) - load->buffer) + 1)	/* see ResolvePosition */
 
 /* Internal data structure for load.c functions */
 struct LoadInfo
@@ -32,11 +52,79 @@ struct LoadInfo
 	const char *b_end;
 
 	const char *current;	/* actual read position (cursor) in buffer */
-	U_LONG cur_row;			/* row & column associated with current */
-	U_LONG cur_col;
 	U_LONG lowercase;		/* load.c: number of lowercase chars in front of propID */
 
 	bool is_utf8;			/* if buffer is already decoded, it's in UTF-8 */
+
+	struct LoadChunk *chunk;	/* parallel mode: chunk loaded by this job (or NULL) */
+};
+
+
+/* Position index: maps buffer positions to row & column.
+** The lexer only records byte positions (offset + 1, 0 == no position).
+** Row & column are calculated on demand by replaying the lexer's walk
+** through the buffer (NextCharInBuffer) from the nearest checkpoint.
+** Checkpoints are recorded at every line start and at least every
+** POS_CP_DISTANCE bytes, as far as positions have been requested. */
+
+#define POS_CP_DISTANCE	1024
+
+struct PosCheckpoint
+{
+	U_LONG offset;			/* offset of a char the lexer stepped on */
+	U_LONG row;
+	U_LONG col;
+	size_t skip;			/* index of next entry in PosIndex.skips[] */
+};
+
+struct PosIndex
+{
+	const char *buffer;		/* buffer the lexer worked on */
+	const char *b_end;
+	bool is_utf8;
+
+	U_LONG *skips;			/* offsets where FindStart() skipped '[aa]' */
+	size_t num_skips;		/* without counting columns */
+	size_t max_skips;
+
+	struct PosCheckpoint *cp;
+	size_t num_cp;
+	size_t max_cp;
+	struct PosCheckpoint walk;	/* how far checkpoints have been recorded */
+	struct PosCheckpoint last;	/* last resolved position (errors are mostly */
+};								/* reported in ascending order) */
+
+
+/* Parallel mode: the buffer is split into chunks at guessed boundaries
+** of game trees (see SplitIntoChunks). Each chunk is loaded by a job with
+** its own worker SGFInfo. A chunk is only valid if the lexer of the chunk
+** before stopped exactly where the chunk starts (see LoadChunks). */
+
+#define PARALLEL_CHUNK_SIZE	(64*1024)	/* minimum average chunk size */
+#define CHUNKS_PER_THREAD	4
+
+struct LoadChunk
+{
+	U_LONG start;			/* buffer offset: lexer is in front of FindStart() */
+	U_LONG end;				/* buffer offset where lexer stopped */
+	bool last;				/* lexing of the file ended within this chunk */
+	struct SGFInfo *sgfc;	/* worker SGFInfo (NULL: not loaded / merged) */
+
+	char **terminators;		/* value slices, terminated when merged */
+	size_t num_terminators;
+	size_t max_terminators;
+
+	struct PosCheckpoint *cp;	/* root nodes and end; relative to start */
+	size_t num_cp;
+	size_t max_cp;
+};
+
+struct ParallelLoad
+{
+	struct LoadInfo *load;	/* LoadInfo of the file */
+	int miss;				/* result of FindStart() in front of first chunk */
+	struct LoadChunk *chunks;
+	size_t num_chunks;
 };
 
 
@@ -94,17 +182,342 @@ static const char *NextCharInBuffer(const char **c, const char *end, U_LONG step
 }
 
 
+/**************************************************************************
+*** Function:	ScanValueRun
+***				Finds the end of a run of plain chars inside a property value,
+***				i.e. the next break char, '\\', '\r' or '\n'.
+***				Uses SSE2/AVX2 if available.
+*** Parameters: s		 ... start position
+***				e		 ... end position of buffer
+***				end		 ... break char
+*** Returns:	pointer to first char after the run (or e)
+**************************************************************************/
+
+static const char *ScanValueRun(const char *s, const char *e, char end)
+{
+#if defined(__AVX2__)
+	const __m256i v_end = _mm256_set1_epi8(end), v_esc = _mm256_set1_epi8('\\');
+	const __m256i v_cr = _mm256_set1_epi8('\r'), v_lf = _mm256_set1_epi8('\n');
+
+	while(e - s >= 32)
+	{
+		__m256i c = _mm256_loadu_si256((const __m256i *)s);
+		__m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, v_end), _mm256_cmpeq_epi8(c, v_esc)),
+									_mm256_or_si256(_mm256_cmpeq_epi8(c, v_cr), _mm256_cmpeq_epi8(c, v_lf)));
+		unsigned int special = (unsigned int)_mm256_movemask_epi8(m);
+		if(special)
+			return s + __builtin_ctz(special);
+		s += 32;
+	}
+#endif
+#if defined(__SSE2__)
+	{
+		const __m128i v_end = _mm_set1_epi8(end), v_esc = _mm_set1_epi8('\\');
+		const __m128i v_cr = _mm_set1_epi8('\r'), v_lf = _mm_set1_epi8('\n');
+
+		while(e - s >= 16)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i *)s);
+			__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, v_end), _mm_cmpeq_epi8(c, v_esc)),
+									 _mm_or_si128(_mm_cmpeq_epi8(c, v_cr), _mm_cmpeq_epi8(c, v_lf)));
+			unsigned int special = (unsigned int)_mm_movemask_epi8(m);
+			if(special)
+				return s + __builtin_ctz(special);
+			s += 16;
+		}
+	}
+#endif
+
+	while(s < e && *s != end && *s != '\\' && *s != '\r' && *s != '\n')
+		s++;
+	return s;
+}
+
+
 /**************************************************************************
 *** Function:	NextChar
 ***				Convience wrapper for NextCharInBuffer
 *** Parameters: load ... pointer to LoadInfo structure
-*** Returns:	current position; row & col are updated accordingly
+*** Returns:	current position
 **************************************************************************/
 
 static const char *NextChar(struct LoadInfo *load)
 {
-	return NextCharInBuffer(&load->current, load->b_end, 1,
-						 	&load->cur_row, &load->cur_col, load->is_utf8);
+	return NextCharInBuffer(&load->current, load->b_end, 1, NULL, NULL, load->is_utf8);
+}
+
+
+/**************************************************************************
+*** Function:	NewPosIndex
+***				Creates an empty position index (see struct PosIndex)
+***				that starts at the given buffer offset
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				buffer	... buffer of the lexer
+***				b_end	... end of buffer
+***				is_utf8 ... buffer is UTF-8 encoded
+***				offset	... offset of a char the lexer stepped on
+***				row		... row & column of that char
+***				col
+*** Returns:	pointer to position index
+**************************************************************************/
+
+static struct PosIndex *NewPosIndex(struct SGFInfo *sgfc, const char *buffer, const char *b_end,
+									bool is_utf8, U_LONG offset, U_LONG row, U_LONG col)
+{
+	struct PosIndex *idx = SaveCalloc(sgfc, sizeof(struct PosIndex), "position index");
+
+	idx->buffer = buffer;
+	idx->b_end = b_end;
+	idx->is_utf8 = is_utf8;
+	idx->walk.offset = offset;
+	idx->walk.row = row;
+	idx->walk.col = col;
+
+	idx->max_cp = 64;
+	idx->cp = SaveMalloc(sgfc, idx->max_cp * sizeof(struct PosCheckpoint), "position index");
+	idx->cp[0] = idx->walk;
+	idx->num_cp = 1;
+	idx->last = idx->walk;
+	return idx;
+}
+
+
+/**************************************************************************
+*** Function:	SetupPosIndex
+***				Creates an empty position index for the buffer of the lexer
+***				(see struct PosIndex)
+*** Parameters: load ... pointer to LoadInfo structure
+*** Returns:	-
+**************************************************************************/
+
+static void SetupPosIndex(struct LoadInfo *load)
+{
+	load->sgfc->_pos_index = NewPosIndex(load->sgfc, load->buffer, load->b_end,
+										 load->is_utf8, 0, 1, 1);
+}
+
+
+/**************************************************************************
+*** Function:	AddPositionSkip
+***				Records that the lexer jumps over '[aa]' at current position
+***				without stepping through it (see FindStart)
+*** Parameters: load ... pointer to LoadInfo structure
+*** Returns:	-
+**************************************************************************/
+
+static void AddPositionSkip(struct LoadInfo *load)
+{
+	struct PosIndex *idx = load->sgfc->_pos_index;
+
+	if(idx->num_skips == idx->max_skips)
+	{
+		idx->max_skips = idx->max_skips ? idx->max_skips * 2 : 16;
+		idx->skips = SaveRealloc(load->sgfc, idx->skips, idx->max_skips * sizeof(U_LONG), "position index");
+	}
+	idx->skips[idx->num_skips++] = (U_LONG)(load->current - load->buffer);
+}
+
+
+/**************************************************************************
+*** Function:	PosIndexStep
+***				Steps through the buffer exactly like the lexer did.
+***				Runs of chars other than linebreaks are taken in one go,
+***				but not beyond limit. Trailing UTF-8 continuation bytes
+***				are left to NextCharInBuffer (linebreak handling).
+*** Parameters: idx	  ... pointer to position index
+***				st	  ... position & row/col state (gets updated)
+***				limit ... offset where a run ends at the latest
+*** Returns:	-
+**************************************************************************/
+
+static void PosIndexStep(const struct PosIndex *idx, struct PosCheckpoint *st, U_LONG limit)
+{
+	const char *c = idx->buffer + st->offset;
+	const char *r = c, *run_end;
+	U_LONG cols = 0;
+
+	if(st->skip < idx->num_skips)
+	{
+		if(idx->skips[st->skip] == st->offset)
+		{
+			st->offset += 4;	/* '[aa]' skipped by FindStart() */
+			st->skip++;
+			return;
+		}
+		if(idx->skips[st->skip] < limit)
+			limit = idx->skips[st->skip];
+	}
+
+	run_end = idx->buffer + limit;
+	while(r < run_end && *r != '\r' && *r != '\n')
+	{
+		if(!idx->is_utf8 || (*r & 0xc0) != 0x80)
+			cols++;
+		r++;
+	}
+	if(idx->is_utf8)					/* continuation bytes count 0 columns */
+		while(r > c && (r[-1] & 0xc0) == 0x80)
+			r--;
+
+	if(r > c)
+	{
+		c = r;
+		st->col += cols;
+	}
+	else
+		NextCharInBuffer(&c, idx->b_end, 1, &st->row, &st->col, idx->is_utf8);
+
+	st->offset = (U_LONG)(c - idx->buffer);
+}
+
+
+/**************************************************************************
+*** Function:	ExtendPosIndex
+***				Records checkpoints up to the given offset
+*** Parameters: sgfc   ... pointer to SGFInfo structure
+***				idx	   ... pointer to position index
+***				offset ... buffer offset
+*** Returns:	-
+**************************************************************************/
+
+static void ExtendPosIndex(struct SGFInfo *sgfc, struct PosIndex *idx, U_LONG offset)
+{
+	U_LONG end = (U_LONG)(idx->b_end - idx->buffer);
+
+	/* don't step beyond offset: a skip might still get recorded there */
+	while(idx->walk.offset < offset && idx->walk.offset < end)
+	{
+		U_LONG row = idx->walk.row;
+		U_LONG limit = idx->cp[idx->num_cp-1].offset + POS_CP_DISTANCE;
+
+		PosIndexStep(idx, &idx->walk, limit < offset ? limit : offset);
+
+		if(idx->walk.row != row ||
+		   idx->walk.offset - idx->cp[idx->num_cp-1].offset >= POS_CP_DISTANCE)
+		{
+			if(idx->num_cp == idx->max_cp)
+			{
+				idx->max_cp *= 2;
+				idx->cp = SaveRealloc(sgfc, idx->cp, idx->max_cp * sizeof(struct PosCheckpoint), "position index");
+			}
+			idx->cp[idx->num_cp++] = idx->walk;
+		}
+	}
+}
+
+
+/**************************************************************************
+*** Function:	LocatePosition
+***				Finds the lexer's state (row, column, ...) at a buffer offset
+*** Parameters: sgfc   ... pointer to SGFInfo structure
+***				idx	   ... pointer to position index
+***				offset ... buffer offset (within range of index)
+*** Returns:	state at offset (or at the last char in front of offset
+***				if lexer never stopped at offset)
+**************************************************************************/
+
+static struct PosCheckpoint LocatePosition(struct SGFInfo *sgfc, struct PosIndex *idx, U_LONG offset)
+{
+	struct PosCheckpoint st, prev;
+	size_t lo, hi;
+
+	ExtendPosIndex(sgfc, idx, offset);
+
+	lo = 0;							/* find last checkpoint <= offset */
+	hi = idx->num_cp;
+	while(hi - lo > 1)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if(idx->cp[mid].offset <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	st = idx->cp[lo];
+	if(idx->last.offset > st.offset && idx->last.offset <= offset)
+		st = idx->last;
+	prev = st;
+	while(st.offset < offset && st.offset < (U_LONG)(idx->b_end - idx->buffer))
+	{
+		prev = st;
+		PosIndexStep(idx, &st, offset);
+	}
+	if(st.offset > offset)			/* lexer never stopped at offset */
+		st = prev;
+
+	idx->last = st;
+	return st;
+}
+
+
+/**************************************************************************
+*** Function:	ResolvePosition
+***				Calculates row & column of a buffer position, as counted
+***				by the lexer: linebreaks (\r\n, \n\r) start a new row,
+***				UTF-8 continuation bytes don't count as column.
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				pos	 ... buffer position (see PropValue.pos) or 0
+***				row	 ... returns row number (0 if there is no position)
+***				col	 ... returns column (0 if there is no position)
+*** Returns:	-
+**************************************************************************/
+
+void ResolvePosition(struct SGFInfo *sgfc, U_LONG pos, U_LONG *row, U_LONG *col)
+{
+	struct PosIndex *idx = sgfc->_pos_index;
+	struct PosCheckpoint st;
+
+	*row = *col = 0;
+	if(!pos || !idx || pos - 1 > (U_LONG)(idx->b_end - idx->buffer) ||
+	   pos - 1 < idx->cp[0].offset)
+		return;
+
+	st = LocatePosition(sgfc, idx, pos - 1);
+	*row = st.row;
+	*col = st.col;
+}
+
+
+/**************************************************************************
+*** Function:	FreePosIndex
+***				Frees the position index of SGFInfo (if any)
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+static void FreePosIndex(struct SGFInfo *sgfc)
+{
+	if(!sgfc->_pos_index)
+		return;
+
+	free(sgfc->_pos_index->skips);
+	free(sgfc->_pos_index->cp);
+	free(sgfc->_pos_index);
+	sgfc->_pos_index = NULL;
+}
+
+
+/**************************************************************************
+*** Function:	SetupPosIndexAt
+***				Gives a worker SGFInfo (parallel mode) a position index
+***				of the file's buffer, which starts at the given position.
+***				Positions in front of it can't be resolved by the worker.
+*** Parameters: worker ... pointer to worker SGFInfo
+***				sgfc   ... pointer to SGFInfo of file
+***				pos	   ... buffer position the lexer stepped on (or 0)
+***				row	   ... row & column of pos (see ResolvePosition)
+***				col
+*** Returns:	-
+**************************************************************************/
+
+void SetupPosIndexAt(struct SGFInfo *worker, const struct SGFInfo *sgfc, U_LONG pos, U_LONG row, U_LONG col)
+{
+	const struct PosIndex *idx = sgfc->_pos_index;
+
+	FreePosIndex(worker);
+	if(pos && idx)
+		worker->_pos_index = NewPosIndex(worker, idx->buffer, idx->b_end, idx->is_utf8, pos - 1, row, col);
 }
 
 
@@ -120,38 +533,42 @@ static const char *NextChar(struct LoadInfo *load)
 ***				mode	... INSIDE  : do escaping ('\')
 ***							OUTSIDE : detect faulty chars
 ***							P_ERROR : print UNEXPECTED_EOF error message
-***				row		... row number associated with 's'
-***				col		... column number associated with 's'
 *** Returns:	pointer to break char or NULL if buffer end was reached.
-***				(in case of NULL, row & col reflect position at buffer end)
 **************************************************************************/
 
 static const char *SkipText(struct LoadInfo *load, const char *s, const char *e,
-							char end, unsigned int mode, U_LONG *row, U_LONG *col)
+							char end, unsigned int mode)
 {
 	while(s < e)
 	{
+		if(!(mode & OUTSIDE))	/* bulk skip plain chars inside value */
+		{
+			s = ScanValueRun(s, e, end);
+			if(s == e)
+				break;
+		}
+
 		if(*s == end)			/* found break char? */
 			return s;
 
 		if(mode & OUTSIDE)		/* '.. [] ..' */
 		{
 			if(!isspace((unsigned char)*s))
-				PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, *row, *col, true, s);
+				PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, SGF_POS(s), true, s);
 		}
 		else					/* '[ .... ]' */
 		{
 			if(*s == '\\')		/* escaping */
 			{
-				NextCharInBuffer(&s, e, 2, row, col, load->is_utf8);
+				NextCharInBuffer(&s, e, 2, NULL, NULL, load->is_utf8);
 				continue;
 			}
 		}
-		NextCharInBuffer(&s, e, 1, row, col, load->is_utf8);
+		NextCharInBuffer(&s, e, 1, NULL, NULL, load->is_utf8);
 	}
 
 	if(mode & P_ERROR)
-		PrintError(E_UNEXPECTED_EOF, load->sgfc, *row, *col);
+		PrintError(E_UNEXPECTED_EOF, load->sgfc, SGF_POS(e));
 
 	return NULL;
 }
@@ -168,15 +585,14 @@ static const char *SkipText(struct LoadInfo *load, const char *s, const char *e,
 
 static bool SkipSGFText(struct LoadInfo *load, char brk, unsigned int mode)
 {
-	const char *pos = SkipText(load, load->current, load->b_end,
-							   brk, mode, &load->cur_row, &load->cur_col);
+	const char *pos = SkipText(load, load->current, load->b_end, brk, mode);
 
 	load->lowercase = 0;		/* we are no longer parsing for GetNextSGFChar -> reset */
 
 	/* Reached end of buffer? */
 	if (!pos)
 	{
-		load->current = load->b_end;	/* row & col already updated by SkipText */
+		load->current = load->b_end;
 		return false;
 	}
 
@@ -210,7 +626,7 @@ static bool GetNextSGFChar(struct LoadInfo *load, bool print_error, U_LONG error
 			case '(':
 			case ')':
 			case '[':	if(print_error && lc)
-							PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc, load->cur_row, load->cur_col-lc,
+							PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc, SGF_POS(load->current)-lc,
 				  				       true, load->current-lc, lc);
 						load->lowercase = 0;
 						return true;
@@ -227,10 +643,10 @@ static bool GetNextSGFChar(struct LoadInfo *load, bool print_error, U_LONG error
 							if(print_error)
 							{
 								if(lc)
-									PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc, load->cur_row, load->cur_col-lc,
+									PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc, SGF_POS(load->current)-lc,
 											   true, load->current-lc, lc);
 								if(!isspace((unsigned char)*load->current))
-									PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, load->cur_row, load->cur_col,
+									PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, SGF_POS(load->current),
 											   true, load->current);
 							}
 							lc = 0;
@@ -242,7 +658,7 @@ static bool GetNextSGFChar(struct LoadInfo *load, bool print_error, U_LONG error
 	}
 
 	if(error != E_NO_ERROR)
-		PrintError(error, load->sgfc, load->cur_row, load->cur_col);
+		PrintError(error, load->sgfc, SGF_POS(load->current));
 	load->lowercase = 0;
 	return false;
 }
@@ -278,6 +694,76 @@ static bool SkipValues(struct LoadInfo *load, bool print_error)
 }
 
 
+/**************************************************************************
+*** Function:	TerminateSlice
+***				Terminates a value slice of the decoded buffer with '\0'.
+***				Chunks loaded in parallel only note the position, because
+***				other jobs may still read the buffer there and the chunk
+***				might get discarded (see LoadChunks).
+*** Parameters: load ... pointer to LoadInfo structure
+***				end	 ... end of slice (break char)
+*** Returns:	-
+**************************************************************************/
+
+static void TerminateSlice(struct LoadInfo *load, char *end)
+{
+	struct LoadChunk *chunk = load->chunk;
+
+	if(!chunk)
+	{
+		*end = 0;
+		return;
+	}
+
+	if(chunk->num_terminators == chunk->max_terminators)
+		chunk->terminators = GrowStack(load->sgfc, chunk->terminators,
+									   &chunk->max_terminators, sizeof(char *));
+	chunk->terminators[chunk->num_terminators++] = end;
+}
+
+
+/**************************************************************************
+*** Function:	AddValue
+***				Adds a value to the property. If the buffer is our own
+***				decoded copy, the value isn't copied but points into the
+***				buffer: the break char (']' or ':') is replaced by '\0'
+***				(except with option verbatim).
+***				(-> IsBufferSlice, OwnPropValue)
+*** Parameters: load 	... pointer to LoadInfo structure
+***				p		... pointer to property
+***				pos		... buffer position of property value
+***				s, len	... first value
+***				s2, len2 ... second value (or NULL)
+*** Returns:	-
+**************************************************************************/
+
+static void AddValue(struct LoadInfo *load, struct Property *p, U_LONG pos,
+					 const char *s, size_t len, const char *s2, size_t len2)
+{
+	struct SGFInfo *sgfc = load->sgfc;
+	struct PropValue *v;
+
+	/* verbatim: buffer has to stay untouched (see WriteVerbatim) */
+	if(load->buffer != sgfc->decoded_buffer || sgfc->options->verbatim)
+	{
+		AddPropValue(sgfc, p, pos, s, len, s2, len2);
+		return;
+	}
+
+	/* slices are terminated behind the lexer, which never looks back */
+	v = AddPropValue(sgfc, p, pos, NULL, 0, NULL, 0);
+	v->value = sgfc->decoded_buffer + (s - load->buffer);
+	TerminateSlice(load, v->value + len);
+	v->value_len = len;
+	if(s2)
+	{
+		v->value2 = sgfc->decoded_buffer + (s2 - load->buffer);
+		TerminateSlice(load, v->value2 + len2);
+		v->value2_len = len2;
+	}
+}
+
+
 /**************************************************************************
 *** Function:	NewValue
 ***				Adds one property value to the given property
@@ -289,8 +775,7 @@ static bool SkipValues(struct LoadInfo *load, bool print_error)
 
 static bool NewValue(struct LoadInfo *load, struct Property *p, U_SHORT flags)
 {
-	U_LONG row = load->cur_row;
-	U_LONG col = load->cur_col;
+	U_LONG pos = SGF_POS(load->current);
 
 	const char *s = NextChar(load);		/* points to char after '[' */
 	if(!s)
@@ -303,23 +788,25 @@ static bool NewValue(struct LoadInfo *load, struct Property *p, U_SHORT flags)
 
 	if(flags & (PVT_COMPOSE|PVT_WEAKCOMPOSE))	/* compose datatype? */
 	{
-		const char *t = SkipText(load, s, load->current, ':', INSIDE, NULL, NULL);
+		const char *t = SkipText(load, s, load->current, ':', INSIDE);
 		if(!t)
 		{
 			if(flags & PVT_WEAKCOMPOSE)	/* no compose -> parse as normal */
-				AddPropValue(load->sgfc, p, row, col, s, (size_t)(load->current - s - 1), NULL, 0);
+				AddValue(load, p, pos, s, (size_t)(load->current - s - 1), NULL, 0);
 			else						/* not weak -> error */
 			{
-				char *val = SaveDupString(s, (size_t)(load->current - s - 1), "compose error value");
-				PrintError(E_COMPOSE_EXPECTED, load->sgfc, row, col, val, p->idstr);
+				size_t len = (size_t)(load->current - s - 1);
+				/* len 0 would mean strlen(), but buffer isn't 0-terminated */
+				char *val = SaveDupString(load->sgfc, len ? s : "", len, "compose error value");
+				PrintError(E_COMPOSE_EXPECTED, load->sgfc, pos, val, p->idstr);
 				free(val);
 			}
 		}
 		else	/* composed value */
-			AddPropValue(load->sgfc, p, row, col, s, (size_t)(t - s), t + 1, (size_t)(load->current - t - 2));
+			AddValue(load, p, pos, s, (size_t)(t - s), t + 1, (size_t)(load->current - t - 2));
 	}
 	else
-		AddPropValue(load->sgfc, p, row, col, s, (size_t)(load->current - s - 1), NULL, 0);
+		AddValue(load, p, pos, s, (size_t)(load->current - s - 1), NULL, 0);
 
 	return true;
 }
@@ -331,20 +818,20 @@ static bool NewValue(struct LoadInfo *load, struct Property *p, U_SHORT flags)
 *** Parameters: load 	... pointer to LoadInfo structure
 ***				n		... node to which property belongs to
 ***				id		... tokenized ID of property
-***				id_buf	... pointer to property ID
+***				pos		... buffer position of property ID
 ***				idstr	... ID string
 *** Returns:	true or false
 **************************************************************************/
 
-static bool NewProperty(struct LoadInfo *load, struct Node *n, token id, U_LONG row, U_LONG col, char *idstr)
+static bool NewProperty(struct LoadInfo *load, struct Node *n, token id, U_LONG pos, char *idstr)
 {
 	struct Property *newp;
 	bool ret = true;
-	U_LONG tooMany_row = 0, tooMany_col = 0;
+	U_LONG tooMany_pos = 0;
 
 	if(!n)	return true;
 
-	newp = AddProperty(n, id, row, col, idstr);
+	newp = AddProperty(load->sgfc, n, id, pos, idstr);
 
 	while(true)
 	{
@@ -363,11 +850,8 @@ static bool NewProperty(struct LoadInfo *load, struct Node *n, token id, U_LONG
 			if(newp->flags & PVT_LIST)
 				continue;
 			/* error, as only one value allowed */
-			if (!tooMany_row)
-			{
-				tooMany_row = load->cur_row;
-				tooMany_col = load->cur_col;
-			}
+			if (!tooMany_pos)
+				tooMany_pos = SGF_POS(load->current);
 			if (!newp->value || !newp->value->value_len)	/* if previous value is empty, */
 			{												/* then use the later value */
 				DelPropValue(newp, newp->value);
@@ -379,8 +863,8 @@ static bool NewProperty(struct LoadInfo *load, struct Node *n, token id, U_LONG
 		break;						/* reached end of value list */
 	}
 
-	if(tooMany_row)
-		PrintError(E_TOO_MANY_VALUES, load->sgfc, tooMany_row, tooMany_col, idstr);
+	if(tooMany_pos)
+		PrintError(E_TOO_MANY_VALUES, load->sgfc, tooMany_pos, idstr);
 
 	if(!newp->value)				/* property has values? */
 		DelProperty(n, newp);		/* no -> delete it */
@@ -400,7 +884,7 @@ static bool NewProperty(struct LoadInfo *load, struct Node *n, token id, U_LONG
 static bool MakeProperties(struct LoadInfo *load, struct Node *n)
 {
 	char propid[100], full_propid[300];
-	U_LONG id_row, id_col, pi, pi_lc;
+	U_LONG id_pos, pi, pi_lc;
 
 	while(true)
 	{
@@ -412,17 +896,16 @@ static bool MakeProperties(struct LoadInfo *load, struct Node *n)
 			case '(':	/* ( ) ; indicate node end */
 			case ')':
 			case ';':	return true;
-			case ']':	PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, load->cur_row, load->cur_col, true, load->current);
+			case ']':	PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, SGF_POS(load->current), true, load->current);
 						NextChar(load);
 						break;
-			case '[':	PrintError(E_VALUES_WITHOUT_ID, load->sgfc, load->cur_row, load->cur_col);
+			case '[':	PrintError(E_VALUES_WITHOUT_ID, load->sgfc, SGF_POS(load->current));
 						if(!SkipValues(load, true))
 							return false;
 						break;
 
 			default:	/* isalpha */
-				id_row = load->cur_row;
-				id_col = load->cur_col;
+				id_pos = SGF_POS(load->current);
 				pi = 0;		/* counter for propid */
 				pi_lc = 0;	/* counter for lowercase propid */
 
@@ -431,7 +914,7 @@ static bool MakeProperties(struct LoadInfo *load, struct Node *n)
 					U_LONG lc = load->lowercase >= 200 ? 199 : load->lowercase;
 					strncpy(full_propid, load->current - load->lowercase, lc);
 					pi_lc = lc;
-					id_col -= load->lowercase;
+					id_pos -= load->lowercase;
 				}
 
 				while(!SGF_EOF)
@@ -465,40 +948,36 @@ static bool MakeProperties(struct LoadInfo *load, struct Node *n)
 
 						if(*load->current != '[')
 						{
-							PrintError(E_NO_PROP_VALUES, load->sgfc, id_row, id_col, full_propid);
+							PrintError(E_NO_PROP_VALUES, load->sgfc, id_pos, full_propid);
 							break;
 						}
 
 						if(pi > 2)
-							PrintError(WS_LONG_PROPID, load->sgfc, load->cur_row, load->cur_col, full_propid);
+							PrintError(WS_LONG_PROPID, load->sgfc, SGF_POS(load->current), full_propid);
 
-						int i = 1;
-						for(; sgf_token[i].id; i++)
-							if(!strcmp(propid, sgf_token[i].id))
-								break;
+						token i = LookupToken(propid);
 
-						if(!sgf_token[i].id)	/* EOF sgf_token */
+						if(i == TKN_UNKNOWN)
 						{
 							if(!load->sgfc->options->keep_unknown_props)
 							{
-								PrintError(WS_UNKNOWN_PROPERTY, load->sgfc, id_row, id_col, full_propid, "deleted");
+								PrintError(WS_UNKNOWN_PROPERTY, load->sgfc, id_pos, full_propid, "deleted");
 								if(!SkipValues(load, true))
 									return false;
 								break;
 							}
-							PrintError(WS_UNKNOWN_PROPERTY, load->sgfc, id_row, id_col, full_propid, "found");
-							i = TKN_UNKNOWN;
+							PrintError(WS_UNKNOWN_PROPERTY, load->sgfc, id_pos, full_propid, "found");
 						}
 
 						if(load->sgfc->options->delete_property[i])
 						{
-							PrintError(W_PROPERTY_DELETED, load->sgfc, id_row, id_col, "", full_propid);
+							PrintError(W_PROPERTY_DELETED, load->sgfc, id_pos, "", full_propid);
 							if(!SkipValues(load, true))
 								return false;
 							break;
 						}
 
-						if(!NewProperty(load, n, (token)i, id_row, id_col, full_propid))
+						if(!NewProperty(load, n, i, id_pos, full_propid))
 							return false;
 						break;
 					}
@@ -507,13 +986,13 @@ static bool MakeProperties(struct LoadInfo *load, struct Node *n)
 
 				if(SGF_EOF)
 				{
-					PrintError(E_UNEXPECTED_EOF, load->sgfc, load->cur_row, load->cur_col);
+					PrintError(E_UNEXPECTED_EOF, load->sgfc, SGF_POS(load->current));
 					return false;
 				}
 
 				if(pi >= 100)
 				{
-					PrintError(E_PROPID_TOO_LONG, load->sgfc, id_row, id_col, full_propid);
+					PrintError(E_PROPID_TOO_LONG, load->sgfc, id_pos, full_propid);
 					if(!SkipValues(load, true))
 						return false;
 				}
@@ -533,7 +1012,7 @@ static bool MakeProperties(struct LoadInfo *load, struct Node *n)
 
 static struct Node *NewNodeWithProperties(struct LoadInfo *load, struct Node *parent)
 {
-	struct Node *n = NewNode(load->sgfc, parent, load->cur_row, load->cur_col, false);
+	struct Node *n = NewNode(load->sgfc, parent, SGF_POS(load->current), false);
 
 	if(!MakeProperties(load, n))
 		return NULL;
@@ -544,78 +1023,147 @@ static struct Node *NewNodeWithProperties(struct LoadInfo *load, struct Node *pa
 
 /**************************************************************************
 *** Function:	BuildSGFTree
-***				Recursive function to build up the sgf tree structure
+***				Builds up the sgf tree structure. Nested variations are
+***				kept on an explicit stack instead of recursion, so
+***				nesting depth is limited by memory only.
 *** Parameters: load ... pointer to LoadInfo structure
 ***				r	 ... tree root
 ***				missing_semicolon ... whether missing semicolon is known/reported already
 *** Returns:	true or false on success/error
 **************************************************************************/
 
+struct BuildFrame
+{
+	struct Node *r;		/* last node of variation */
+	bool end_tree;		/* variation has sub-variations */
+	bool empty;			/* no node yet */
+	bool missing_semicolon;
+};
+
 static bool BuildSGFTree(struct LoadInfo *load, struct Node *r, bool missing_semicolon)
 {
-	int end_tree = 0, empty = 1;
+	struct BuildFrame cur = { r, false, true, missing_semicolon };
+	struct BuildFrame *stack = NULL;
+	size_t depth = 0, max_depth = 0;
+	bool result = false, sub_tree;
 
 	while(GetNextSGFChar(load, true, E_VARIATION_NESTING))
 	{
+		sub_tree = false;
 		switch(*load->current)
 		{
-			case ';':	if(end_tree)
+			case ';':	if(cur.end_tree)
 						{
-							PrintError(E_NODE_OUTSIDE_VAR, load->sgfc, load->cur_row, load->cur_col);
-							if(!BuildSGFTree(load, r, false))
-								return false;
-							end_tree = 1;
+							PrintError(E_NODE_OUTSIDE_VAR, load->sgfc, SGF_POS(load->current));
+							sub_tree = true;
 						}
 						else
 						{
-							empty = 0;
+							cur.empty = false;
 							NextChar(load);
-							r = NewNodeWithProperties(load, r);
-							if(!r)
-								return false;
+							cur.r = NewNodeWithProperties(load, cur.r);
+							if(!cur.r)
+								goto done;
 						}
 						break;
-			case '(':	if(empty)
+			case '(':	if(cur.empty)
 						{
-							if(!missing_semicolon)
-								PrintError(E_VARIATION_START, load->sgfc, load->cur_row, load->cur_col);
+							if(!cur.missing_semicolon)
+								PrintError(E_VARIATION_START, load->sgfc, SGF_POS(load->current));
 							NextChar(load);
 						}
 						else
 						{
 							NextChar(load);
-							if(!BuildSGFTree(load, r, false))
-								return false;
-							end_tree = 1;
+							sub_tree = true;
 						}
 						break;
-			case ')':	if(empty)
-							PrintError(E_EMPTY_VARIATION, load->sgfc, load->cur_row, load->cur_col);
+			case ')':	if(cur.empty)
+							PrintError(E_EMPTY_VARIATION, load->sgfc, SGF_POS(load->current));
 						NextChar(load);
-						return true;
+						if(!depth)
+						{
+							result = true;
+							goto done;
+						}
+						cur = stack[--depth];
+						break;
 
-			default:	if(empty)		/* assume there's a missing ';' */
+			default:	if(cur.empty)		/* assume there's a missing ';' */
 						{
-							if(!missing_semicolon)
+							if(!cur.missing_semicolon)
 								PrintError(E_MISSING_NODE_START, load->sgfc,
-				   						   load->cur_row, load->cur_col - load->lowercase);
-							empty = 0;
-							r = NewNodeWithProperties(load, r);
-							if(!r)
-								return false;
+				   						   SGF_POS(load->current) - load->lowercase);
+							cur.empty = false;
+							cur.r = NewNodeWithProperties(load, cur.r);
+							if(!cur.r)
+								goto done;
 						}
 						else
 						{
 							PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc,
-				  					   load->cur_row, load->cur_col - load->lowercase,
+				  					   SGF_POS(load->current) - load->lowercase,
 									   true, load->current - load->lowercase, load->lowercase);
 							NextChar(load);
 						}
 						break;
 		}
+
+		if(sub_tree)		/* start of sub tree; r is parent of the sub tree */
+		{
+			if(depth == max_depth)
+				stack = GrowStack(load->sgfc, stack, &max_depth, sizeof(struct BuildFrame));
+			cur.end_tree = true;	/* valid when sub tree is done */
+			stack[depth++] = cur;
+			cur.end_tree = false;
+			cur.empty = true;
+			cur.missing_semicolon = false;
+		}
 	}
 
-	return false;
+done:
+	free(stack);
+	return result;
+}
+
+
+/**************************************************************************
+*** Function:	BuildGameTree
+***				Loads a game tree at the start mark found by FindStart().
+***				With option verbatim, game trees that were loaded without
+***				any message are recorded along with their text.
+*** Parameters: load ... pointer to LoadInfo structure
+***				miss ... result of FindStart()
+*** Returns:	true or false (see BuildSGFTree)
+**************************************************************************/
+
+static bool BuildGameTree(struct LoadInfo *load, int miss)
+{
+	struct SGFInfo *sgfc = load->sgfc;
+	struct Node *last = sgfc->last_root;
+	const char *start = load->current;
+	U_LONG messages = sgfc->_messages;
+	struct SourceTree *src;
+
+	if(!miss)
+		NextChar(load);				/* skip '(' */
+	if(!BuildSGFTree(load, NULL, miss==2))
+		return false;
+
+	/* exactly one new root node? */
+	if(!sgfc->options->verbatim || miss || sgfc->_messages != messages ||
+	   !sgfc->last_root || sgfc->last_root == last ||
+	   (last ? last->sibling : sgfc->root) != sgfc->last_root)
+		return true;
+
+	if(sgfc->_num_source == sgfc->_max_source)
+		sgfc->_source = GrowStack(sgfc, sgfc->_source, &sgfc->_max_source, sizeof(struct SourceTree));
+	src = &sgfc->_source[sgfc->_num_source++];
+	src->root = sgfc->last_root;
+	src->start = start;
+	src->len = (size_t)(load->current - start);
+	src->hash = 0;						/* see LoadSGFFromFileBuffer */
+	return true;
 }
 
 
@@ -643,13 +1191,14 @@ static int FindStart(struct LoadInfo *load, bool first_time)
 			{
 				if(!warn)		/* print warning only once */
 				{
-					PrintError(W_SGF_IN_HEADER, load->sgfc, load->cur_row, load->cur_col);
+					PrintError(W_SGF_IN_HEADER, load->sgfc, SGF_POS(load->current));
 					warn = 1;
 				}
 
 				if(!first_time)
-					PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc, load->cur_row, load->cur_col, true, load->current, 4UL);
+					PrintError(E_ILLEGAL_OUTSIDE_CHARS, load->sgfc, SGF_POS(load->current), true, load->current, 4UL);
 
+				AddPositionSkip(load);
 				load->current += 4;	/* skip '[aa]' */
 				continue;
 			}
@@ -682,13 +1231,13 @@ static int FindStart(struct LoadInfo *load, bool first_time)
 			if((load->sgfc->options->find_start == OPTION_FINDSTART_BRACKET) ||
 			   ((o >= 2) && (o >= c) && (o-c <= 1)))
 			{
-				PrintError(E_MISSING_SEMICOLON, load->sgfc, load->cur_row, load->cur_col);
+				PrintError(E_MISSING_SEMICOLON, load->sgfc, SGF_POS(load->current));
 				return 2;
 			}
 		}
 		else
 			if(!first_time && !isspace((unsigned char)*load->current))
-				PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, load->cur_row, load->cur_col, true, load->current);
+				PrintError(E_ILLEGAL_OUTSIDE_CHAR, load->sgfc, SGF_POS(load->current), true, load->current);
 
 		NextChar(load);
 	}
@@ -704,26 +1253,315 @@ static int FindStart(struct LoadInfo *load, bool first_time)
 
 
 /**************************************************************************
-*** Function:	LoadSGF
-***				Loads a SGF file into the memory and inits all
-***				necessary information in SGFInfo structure
-***
-***             Note that some property values might actually be parsed
-***             the wrong way (e.g. compose type stone values in GM[] != 1)
-***             as this function doesn't keep track of such context across
-***             properties, nodes, or trees. Only after ParseSGF() the
-***             SGF game tree and its properties will be in proper shape.
-***
+*** Function:	SplitIntoChunks
+***				Fast pre-scan: guesses where game trees end, without
+***				checking anything. Cuts are made at the end of the first
+***				game tree after every 'size' bytes. Wrong guesses are
+***				detected later on (see LoadChunks).
+*** Parameters: load   ... pointer to LoadInfo (current: start of first tree)
+***				chunks ... array of chunks to be filled
+***				num	   ... maximum number of chunks
+*** Returns:	number of chunks
+**************************************************************************/
+
+static size_t SplitIntoChunks(struct LoadInfo *load, struct LoadChunk *chunks, size_t num)
+{
+	const char *s = load->current, *e = load->b_end, *t;
+	size_t size = (size_t)(e - s) / num, n = 1;
+	const char *cut = s + size;
+	U_LONG depth = 0;
+
+	chunks[0].start = (U_LONG)(s - load->buffer);
+
+	for(; s < e && n < num; s++)
+	{
+		switch(*s)
+		{
+			case '[':	if(!depth)		/* no value outside of game tree */
+							break;
+						for(s++; (s = ScanValueRun(s, e, ']')) < e && *s != ']'; s++)
+							if(*s == '\\' && s + 1 < e)
+								s++;	/* skip escaped char */
+						break;
+			case '(':	if(depth)
+						{
+							depth++;
+							break;
+						}
+						for(t = s + 1; t < e && isspace((unsigned char)*t); t++)
+							;
+						if(t < e && *t == ';')	/* start mark '(;' */
+							depth = 1;
+						break;
+			case ')':	if(depth && !--depth && s + 1 >= cut && s + 1 < e)
+						{
+							chunks[n++].start = (U_LONG)(s + 1 - load->buffer);
+							cut = s + 1 + size;
+						}
+						break;
+		}
+	}
+
+	return n;
+}
+
+
+/**************************************************************************
+*** Function:	AddChunkCheckpoint
+***				Records state of lexer at offset (relative to chunk start)
+*** Parameters: chunk  ... pointer to chunk
+***				offset ... buffer offset the lexer stepped on
+*** Returns:	-
+**************************************************************************/
+
+static void AddChunkCheckpoint(struct LoadChunk *chunk, U_LONG offset)
+{
+	if(chunk->num_cp == chunk->max_cp)
+		chunk->cp = GrowStack(chunk->sgfc, chunk->cp, &chunk->max_cp, sizeof(struct PosCheckpoint));
+	chunk->cp[chunk->num_cp++] = LocatePosition(chunk->sgfc, chunk->sgfc->_pos_index, offset);
+}
+
+
+/**************************************************************************
+*** Function:	LoadChunkJob
+***				Loads game trees of one chunk (job of RunWorkers()).
+***				Runs the same loop as LoadSGFFromFileBuffer(), but stops
+***				at the first end of a game tree at or behind the start of
+***				the next chunk. Positions are relative to chunk start.
+*** Parameters: data ... pointer to ParallelLoad
+***				i	 ... number of chunk
+*** Returns:	-
+**************************************************************************/
+
+static void LoadChunkJob(void *data, size_t i)
+{
+	struct ParallelLoad *pl = data;
+	struct LoadChunk *chunk = &pl->chunks[i];
+	struct LoadInfo load = *pl->load;
+	struct SGFInfo *sgfc = SetupWorkerSGFInfo(pl->load->sgfc);
+	const char *end = load.b_end;
+	struct Node *root;
+	int miss = pl->miss;
+
+	if(i + 1 < pl->num_chunks)
+		end = load.buffer + pl->chunks[i+1].start;
+
+	load.sgfc = sgfc;
+	load.current = load.buffer + chunk->start;
+	load.lowercase = 0;
+	load.chunk = chunk;
+	chunk->sgfc = sgfc;
+	sgfc->_pos_index = NewPosIndex(sgfc, load.buffer, load.b_end, load.is_utf8, chunk->start, 1, 1);
+
+	if(i)
+		miss = FindStart(&load, false);		/* skip junk in front of '(;' */
+
+	while(load.current < load.b_end)
+	{
+		if(!BuildGameTree(&load, miss))
+		{
+			chunk->last = true;
+			break;
+		}
+		if(load.current >= end)				/* next chunk (if any) starts here? */
+			break;
+		miss = FindStart(&load, false);
+	}
+
+	if(load.current >= load.b_end)
+		chunk->last = true;
+	chunk->end = (U_LONG)(load.current - load.buffer);
+	PrintError(E_NO_ERROR, sgfc);			/* flush accumulated messages */
+
+	for(root = sgfc->root; root; root = root->sibling)
+		AddChunkCheckpoint(chunk, root->pos - 1);
+	AddChunkCheckpoint(chunk, chunk->end);
+}
+
+
+/**************************************************************************
+*** Function:	MergeChunk
+***				Takes over a loaded chunk: terminates value slices, adds
+***				the chunk's position skips and checkpoints to the position
+***				index of the file, and merges messages and game trees.
+*** Parameters: load  ... pointer to LoadInfo of file
+***				chunk ... pointer to valid chunk
+*** Returns:	-
+**************************************************************************/
+
+static void MergeChunk(struct LoadInfo *load, struct LoadChunk *chunk)
+{
+	struct SGFInfo *sgfc = load->sgfc;
+	struct PosIndex *idx = sgfc->_pos_index, *local = chunk->sgfc->_pos_index;
+	struct PosCheckpoint base, *cp;
+	size_t i, skips = idx->num_skips;
+
+	base = LocatePosition(sgfc, idx, chunk->start);
+
+	for(i = 0; i < chunk->num_terminators; i++)
+		*chunk->terminators[i] = 0;
+
+	for(i = 0; i < local->num_skips; i++)
+	{
+		load->current = load->buffer + local->skips[i];
+		AddPositionSkip(load);
+	}
+
+	for(i = 0; i < chunk->num_cp; i++)
+	{
+		if(idx->num_cp == idx->max_cp)
+		{
+			idx->max_cp *= 2;
+			idx->cp = SaveRealloc(sgfc, idx->cp, idx->max_cp * sizeof(struct PosCheckpoint), "position index");
+		}
+		cp = &idx->cp[idx->num_cp++];
+		*cp = chunk->cp[i];				/* relative -> absolute */
+		if(cp->row == 1)
+			cp->col += base.col - 1;
+		cp->row += base.row - 1;
+		cp->skip += skips;
+	}
+	idx->walk = idx->cp[idx->num_cp-1];		/* = end of chunk */
+
+	MergeWorkerSGFInfo(sgfc, chunk->sgfc, base.row, base.col);
+	chunk->sgfc = NULL;
+}
+
+
+/**************************************************************************
+*** Function:	LoadChunks
+***				Parallel mode: splits the buffer into chunks, loads them
+***				on worker threads, and merges them in order. Chunks behind
+***				a wrong guess are discarded: the caller continues loading
+***				from where the last valid chunk ended.
+***				Messages and game trees are the same as if the file
+***				was loaded by LoadSGFFromFileBuffer() alone.
+*** Parameters: load ... pointer to LoadInfo (current: start of first tree)
+***				miss ... result of FindStart() (updated)
+*** Returns:	true if file has been loaded completely
+**************************************************************************/
+
+static bool LoadChunks(struct LoadInfo *load, int *miss)
+{
+	struct SGFInfo *sgfc = load->sgfc;
+	struct ParallelLoad pl;
+	struct LoadChunk *chunk;
+	size_t i, num = NumWorkerThreads(sgfc) * CHUNKS_PER_THREAD;
+	size_t max = (size_t)(load->b_end - load->current) / PARALLEL_CHUNK_SIZE;
+	bool valid = true, done = false;
+
+	if(max < num)
+		num = max;
+	if(num < 2 || NumWorkerThreads(sgfc) < 2)
+		return false;
+
+	pl.load = load;
+	pl.miss = *miss;
+	pl.chunks = SaveCalloc(sgfc, num * sizeof(struct LoadChunk), "chunk list");
+	pl.num_chunks = SplitIntoChunks(load, pl.chunks, num);
+
+	if(pl.num_chunks > 1)
+	{
+		RunWorkers(sgfc, pl.num_chunks, LoadChunkJob, &pl);
+
+		for(i = 0; i < pl.num_chunks; i++)
+		{
+			chunk = &pl.chunks[i];
+			if(valid)
+			{
+				MergeChunk(load, chunk);
+				if(chunk->last)
+					done = true;
+				if(chunk->last || i + 1 == pl.num_chunks || chunk->end != pl.chunks[i+1].start)
+				{
+					valid = false;
+					if(!done)				/* wrong guess: continue sequentially */
+					{
+						load->current = load->buffer + chunk->end;
+						*miss = FindStart(load, false);
+					}
+				}
+			}
+			else
+				FreeWorkerSGFInfo(chunk->sgfc);
+			free(chunk->terminators);
+			free(chunk->cp);
+		}
+	}
+	else
+		free(pl.chunks[0].cp);
+
+	free(pl.chunks);
+	return done;
+}
+
+
+#ifdef HAVE_MMAP
+/**************************************************************************
+*** Function:	MapSGF
+***				Maps a regular file read-only into memory
+***				Pipes, devices, empty files etc. are left to the
+***				stdio based reading in ReadSGFFile()
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				name ... filename/path
+*** Returns:	true if file is mapped, false if caller should fall back
+**************************************************************************/
+
+static bool MapSGF(struct SGFInfo *sgfc, const char *name)
+{
+	struct stat st;
+	void *addr;
+	int fd;
+
+	fd = open(name, O_RDONLY);
+	if(fd == -1)
+		return false;		/* let fopen() report the error */
+
+	if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+	   st.st_size <= 0 || (unsigned long long)st.st_size > SIZE_MAX)
+	{
+		close(fd);
+		return false;
+	}
+
+	addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);				/* mapping stays valid */
+	if(addr == MAP_FAILED)
+		return false;
+
+	posix_madvise(addr, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+	sgfc->buffer = addr;
+	sgfc->b_end = sgfc->buffer + st.st_size;
+	sgfc->buffer_mapped = true;
+	/* value slices get terminated in decoded_buffer: a private writable
+	 * mapping would end up as a full copy, page fault by page fault */
+	sgfc->buffer_writable = false;
+	return true;
+}
+#endif
+
+
+/**************************************************************************
+*** Function:	ReadSGFFile
+***				Reads a file into sgfc->buffer (for LoadSGF(), LoadSnapshot())
+***				Regular files are mapped into memory (if supported),
+***				everything else is read into a buffer.
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				name ... filename/path
 *** Returns:	true on success, false on fatal error
 **************************************************************************/
 
-bool LoadSGF(struct SGFInfo *sgfc, const char *name)
+bool ReadSGFFile(struct SGFInfo *sgfc, const char *name)
 {
 	long size;
 	FILE *file;
 
+#ifdef HAVE_MMAP
+	if(MapSGF(sgfc, name))
+		return true;
+#endif
+
 	file = fopen(name, "rb");
 	if(!file)
 	{
@@ -737,7 +1575,7 @@ bool LoadSGF(struct SGFInfo *sgfc, const char *name)
 	if(size == -1L || size == LONG_MAX) /* Linux may return LONG_MAX in some cases :o( */
 		goto load_error;
 
-	sgfc->buffer = (char *) malloc((size_t) size);
+	sgfc->buffer = (char *) malloc((size_t) size + 1);	/* +1 for \0 termination */
 	if(!sgfc->buffer)
 	{
 		fclose(file);
@@ -750,10 +1588,12 @@ bool LoadSGF(struct SGFInfo *sgfc, const char *name)
 	if(size != (long)fread(sgfc->buffer, 1, (size_t)size, file))
 		goto load_error;
 
+	sgfc->buffer[size] = 0;
 	sgfc->b_end   = sgfc->buffer + size;
+	sgfc->buffer_mapped = false;
+	sgfc->buffer_writable = true;
 	fclose(file);
-
-	return LoadSGFFromFileBuffer(sgfc);
+	return true;
 
 load_error:
 	fclose(file);
@@ -762,6 +1602,28 @@ load_error:
 }
 
 
+/**************************************************************************
+*** Function:	LoadSGF
+***				Loads a SGF file into the memory and inits all
+***				necessary information in SGFInfo structure
+***
+***             Note that some property values might actually be parsed
+***             the wrong way (e.g. compose type stone values in GM[] != 1)
+***             as this function doesn't keep track of such context across
+***             properties, nodes, or trees. Only after ParseSGF() the
+***             SGF game tree and its properties will be in proper shape.
+***
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				name ... filename/path
+*** Returns:	true on success, false on fatal error
+**************************************************************************/
+
+bool LoadSGF(struct SGFInfo *sgfc, const char *name)
+{
+	return ReadSGFFile(sgfc, name) && LoadSGFFromFileBuffer(sgfc);
+}
+
+
 /**************************************************************************
 *** Function:	LoadSGFFromFileBuffer
 ***				Seeks start of SGF data and builds basic tree structure
@@ -773,45 +1635,90 @@ load_error:
 bool LoadSGFFromFileBuffer(struct SGFInfo *sgfc)
 {
 	struct LoadInfo load;
-	char *decode_buffer = NULL;
 
 	load.sgfc = sgfc;
 	load.buffer = sgfc->buffer;
 	load.b_end = sgfc->b_end;
 	load.current = sgfc->buffer;
-	load.cur_row = 1;
-	load.cur_col = 1;
 	load.lowercase = 0;
 	load.is_utf8 = false;
+	load.chunk = NULL;
+
+	FreePosIndex(sgfc);
+	if(sgfc->decoded_buffer)
+	{
+		if(sgfc->decoded_buffer != sgfc->buffer)
+			free(sgfc->decoded_buffer);
+		sgfc->decoded_buffer = NULL;
+		sgfc->decoded_end = NULL;
+	}
 
 	if(sgfc->options->encoding == OPTION_ENCODING_EVERYTHING)
 	{
-		if(!(decode_buffer = DecodeSGFBuffer(sgfc, &load.b_end, &sgfc->global_encoding_name)))
+		/* decoded buffer is kept, as positions & sgfc->start refer to it */
+		if(!(sgfc->decoded_buffer = DecodeSGFBuffer(sgfc, &load.b_end, &sgfc->global_encoding_name)))
 			return false;
-		load.buffer = decode_buffer;
-		load.current = decode_buffer;
+		sgfc->decoded_end = load.b_end;
+		load.buffer = sgfc->decoded_buffer;
+		load.current = sgfc->decoded_buffer;
 		load.is_utf8 = true;
 	}
 
+	SetupPosIndex(&load);
+
 	int miss = FindStart(&load, true);	/* skip junk in front of '(;' */
 	if(miss == -1)
-	{
-		free(decode_buffer);
 		return false;
-	}
 
 	sgfc->start = load.current;
 
+	if(sgfc->options->parallel && LoadChunks(&load, &miss))
+		load.current = load.b_end;		/* file loaded completely */
+
 	while(load.current < load.b_end)
 	{
-		if(!miss)
-			NextChar(&load);				/* skip '(' */
-		if(!BuildSGFTree(&load, NULL, miss==2))
+		if(!BuildGameTree(&load, miss))
 			break;
 		miss = FindStart(&load, false);		/* skip junk in front of '(;' */
 	}
 
 	PrintError(E_NO_ERROR, sgfc);		/* flush accumulated messages */
-	free(decode_buffer);
+
+	for(size_t i = 0; i < sgfc->_num_source; i++)
+		sgfc->_source[i].hash = HashGameTree(sgfc->_source[i].root);
 	return true;
 }
+
+
+/**************************************************************************
+*** Function:	FreeSGFBuffer
+***				Releases the file buffer (and decoded buffer) of SGFInfo
+***				Uses munmap() or free() depending on how LoadSGF()
+***				obtained the buffer.
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+void FreeSGFBuffer(struct SGFInfo *sgfc)
+{
+	if(sgfc->buffer)
+	{
+#ifdef HAVE_MMAP
+		if(sgfc->buffer_mapped)
+			munmap(sgfc->buffer, (size_t)(sgfc->b_end - sgfc->buffer));
+		else
+#endif
+			free(sgfc->buffer);
+	}
+	if(sgfc->decoded_buffer && sgfc->decoded_buffer != sgfc->buffer)
+		free(sgfc->decoded_buffer);
+	FreePosIndex(sgfc);
+
+	sgfc->buffer = NULL;
+	sgfc->b_end = NULL;
+	sgfc->start = NULL;
+	sgfc->decoded_buffer = NULL;
+	sgfc->decoded_end = NULL;
+	sgfc->buffer_mapped = false;
+	sgfc->buffer_writable = false;
+}
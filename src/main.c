@@ -28,6 +28,7 @@
 ***				 5 if there were warnings
 ***				10 if there were errors
 ***				20 if a fatal error occurred
+***				(batch mode: highest status of all files)
 **************************************************************************/
 
 #ifndef VERSION_NO_MAIN
@@ -55,20 +56,35 @@ int main(const int argc, const char *argv[])
 		return 0;
 	}
 
+	if(sgfc->options->batch)
+	{
+		ret = RunBatch(sgfc, stdout);
+		FreeSGFInfo(sgfc);
+		return ret;
+	}
+
 	if(!sgfc->options->infile)
 	{
 		PrintError(FE_MISSING_SOURCE_FILE, sgfc);
 		goto fatal_error;
 	}
 
-	if(!LoadSGF(sgfc, sgfc->options->infile))
+	if(sgfc->options->read_snapshot)
+	{
+		if(!LoadSnapshot(sgfc, sgfc->options->infile))
+			goto fatal_error;
+	}
+	else if(!LoadSGF(sgfc, sgfc->options->infile) || !ParseSGF(sgfc))
 		goto fatal_error;
 
-	if(!ParseSGF(sgfc))
-		goto fatal_error;
+	if(sgfc->options->snapshot)
+		SaveSnapshot(sgfc, sgfc->options->snapshot);
 
 	if(sgfc->options->game_signature)
-		PrintGameSignatures(sgfc);
+		PrintGameSignatures(sgfc, stdout);
+
+	if(sgfc->options->position_hashes)
+		PrintPositionHashes(sgfc, stdout);
 
 	if(sgfc->options->outfile)
 	{
@@ -82,7 +98,7 @@ int main(const int argc, const char *argv[])
 	else if (sgfc->warning_count)	ret = 5;
 	else							ret = 0;
 
-	PrintStatusLine(sgfc);
+	PrintStatusLine(sgfc, stdout);
 
 fatal_error:
 	FreeSGFInfo(sgfc);
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <inttypes.h>
 #include <iconv.h>
 
 #include "all.h"
@@ -34,7 +35,8 @@ void PrintHelp(const enum option_help format)
 	if(format == OPTION_HELP_SHORT)
 		puts(" 'sgfc -h' for help on options");
 	else if (format == OPTION_HELP_LONG)
-		puts(" sgfc [options] infile [outfile]\n\n"
+		puts(" sgfc [options] infile [outfile]\n"
+			 " sgfc --batch [options] file|@listfile|directory ...\n\n"
 			 " Options:\n"
 			 "    -bx ... x = 1,2,3: beginning of SGF data is detected by\n"
 			 "              1 - smart search algorithm (default)\n"
@@ -70,6 +72,15 @@ void PrintHelp(const enum option_help format)
 			 "    -w  ... disable warning messages\n"
 			 "    -yP ... delete property P (P = property id)\n"
 			 "    -z  ... reverse ordering of variations\n\n"
+			 "    --batch   ... check all given files (no output files are written)\n"
+			 "                  @listfile: one filename per line\n"
+			 "                  directory: all *.sgf files (including subdirectories)\n"
+			 "    --parallel ... load, check & save game trees of a collection in parallel\n"
+			 "    --verbatim ... copy game trees without any corrections as they are\n"
+			 "    --write-snapshot=file ... write checked game trees to binary 'file'\n"
+			 "    --read-snapshot ... infile is a snapshot file (no parsing & checking)\n"
+			 "    --position-hashes ... print Zobrist hash of position after each node (Go only)\n"
+			 "    --threads=n ... number of worker threads for --batch/--parallel (default: #CPUs)\n"
 			 "    --help    ... print long help text (same as -h)\n"
 			 "    --version ... print version only\n"
 			 "    --default-encoding=name ... set default encoding to 'name' (CA[] has priority)\n"
@@ -81,42 +92,44 @@ void PrintHelp(const enum option_help format)
 /**************************************************************************
 *** Function:	PrintStatusLine
 ***				Prints final status line with error/warning count
-*** Parameters: sgfc ... pointer to SGFInfo
+*** Parameters: sgfc   ... pointer to SGFInfo
+***				stream ... output stream (stdout)
 *** Returns:	-
 **************************************************************************/
 
-void PrintStatusLine(const struct SGFInfo *sgfc) {
-	printf("%s: ", sgfc->options->infile);
+void PrintStatusLine(const struct SGFInfo *sgfc, FILE *stream) {
+	fprintf(stream, "%s: ", sgfc->options->infile);
 
 	if(sgfc->error_count || sgfc->warning_count)	/* errors & warnings */
 	{
 		if(sgfc->error_count)
-			printf("%d error(s)  ", sgfc->error_count);
+			fprintf(stream, "%d error(s)  ", sgfc->error_count);
 
 		if(sgfc->warning_count)
-			printf("%d warning(s)  ", sgfc->warning_count);
+			fprintf(stream, "%d warning(s)  ", sgfc->warning_count);
 
 		if(sgfc->critical_count)
-			printf("(critical:%d)  ", sgfc->critical_count);
+			fprintf(stream, "(critical:%d)  ", sgfc->critical_count);
 	}
 	else								/* file ok */
-		printf("OK  ");
+		fprintf(stream, "OK  ");
 
 	if(sgfc->ignored_count)
-		printf("(%d message(s) ignored)", sgfc->ignored_count);
+		fprintf(stream, "(%d message(s) ignored)", sgfc->ignored_count);
 
-	printf("\n");
+	fprintf(stream, "\n");
 }
 
 
 /**************************************************************************
 *** Function:	PrintGameSignatures
-***				Prints game signatures of all game trees to stdout.
-*** Parameters: sgfc ... pointer to SGFInfo structure
-*** Returns:	true for success / false in case of argument error
+***				Prints game signatures of all game trees.
+*** Parameters: sgfc   ... pointer to SGFInfo structure
+***				stream ... output stream (stdout)
+*** Returns:	-
 **************************************************************************/
 
-void PrintGameSignatures(const struct SGFInfo *sgfc)
+void PrintGameSignatures(const struct SGFInfo *sgfc, FILE *stream)
 {
 	struct TreeInfo *ti;
 	char signature[14];
@@ -125,15 +138,58 @@ void PrintGameSignatures(const struct SGFInfo *sgfc)
 	while(ti)
 	{
 		if(CalcGameSig(ti, signature))
-			printf("Game signature - tree %d: '%s'\n", ti->num, signature);
+			fprintf(stream, "Game signature - tree %d: '%s'\n", ti->num, signature);
 		else
-			printf("Game signature - tree %d: contains GM[%d] "
-				   "- can't calculate signature\n", ti->num, ti->GM);
+			fprintf(stream, "Game signature - tree %d: contains GM[%d] "
+					"- can't calculate signature\n", ti->num, ti->GM);
 		ti = ti->next;
 	}
 }
 
 
+/**************************************************************************
+*** Function:	PrintPositionHashes
+***				Prints the Zobrist hashes (Node.hash) of all nodes of all
+***				game trees. Nodes are numbered in file order (root is 1).
+*** Parameters: sgfc   ... pointer to SGFInfo structure
+***				stream ... output stream (stdout)
+*** Returns:	-
+**************************************************************************/
+
+void PrintPositionHashes(const struct SGFInfo *sgfc, FILE *stream)
+{
+	struct TreeInfo *ti;
+	struct Node *n;
+	unsigned long num;
+
+	for(ti = sgfc->tree; ti; ti = ti->next)
+	{
+		if(ti->GM != 1)
+		{
+			fprintf(stream, "Position hash - tree %d: contains GM[%d] "
+					"- can't calculate hashes\n", ti->num, ti->GM);
+			continue;
+		}
+
+		num = 0;
+		n = ti->root;
+		while(n)						/* pre-order of tree */
+		{
+			fprintf(stream, "Position hash - tree %d node %lu: %016" PRIx64 "\n",
+					ti->num, ++num, n->hash);
+			if(n->child)
+				n = n->child;
+			else
+			{
+				while(n != ti->root && !n->sibling)
+					n = n->parent;
+				n = n == ti->root ? NULL : n->sibling;
+			}
+		}
+	}
+}
+
+
 /**************************************************************************
 *** Function:	ParsePropertyArg
 ***				Helper function for ParseArgs(): reads in property name
@@ -212,13 +268,13 @@ static int ParseIntArg(struct SGFInfo *sgfc, const char **str, int max)
 
 static const char *ValidateEncoding(struct SGFInfo *sgfc, const char *encoding, const char *argname)
 {
-	iconv_t test = iconv_open("UTF-8", encoding);
+	iconv_t test = AcquireIConV(sgfc, encoding);	/* stays cached for loading */
 	if(test == (iconv_t)-1)
 	{
 		PrintError(FE_UNKNOWN_ENCODING, sgfc, argname, encoding);
 		return NULL;
 	}
-	iconv_close(test);
+	ReleaseIConV(sgfc, test);
 	return encoding;
 }
 
@@ -227,6 +283,8 @@ static const char *ValidateEncoding(struct SGFInfo *sgfc, const char *encoding,
 ***				Parses commandline options
 ***				Options are represented by one char and are preceded with
 ***				a minus. It's valid to list more than one option per argv[]
+***				Filenames are collected first: in batch mode all of them
+***				are inputs, otherwise they are infile [outfile]
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				argc ... argument count (like main())
 ***				argv ... arguments (like main())
@@ -235,11 +293,13 @@ static const char *ValidateEncoding(struct SGFInfo *sgfc, const char *encoding,
 
 bool ParseArgs(struct SGFInfo *sgfc, int argc, const char *argv[])
 {
-	int i, n;
-	const char *c;
+	int i, n, num_files = 0;
+	const char *c, **files;
 	bool options_finished = false;
 	struct SGFCOptions *options = sgfc->options;
 
+	files = SaveMalloc(sgfc, sizeof(const char *) * (size_t)argc, "list of files");
+
 	for(i = 1; i < argc; i++)
 	{
 		if(!options_finished && argv[i][0] == '-')
@@ -269,27 +329,27 @@ bool ParseArgs(struct SGFInfo *sgfc, int argc, const char *argv[])
 					case 'U':	options->default_encoding = "UTF-8";	break;
 					case 'd':
 						if(!(n = ParseIntArg(sgfc, &c, MAX_ERROR_NUM)))
-							return false;
+							goto parse_error;
 						options->error_enabled[n-1] = false;
 						break;
 					case 'l':
 						if(!(n = ParseIntArg(sgfc, &c, 4)))
-							return false;
+							goto parse_error;
 						options->linebreaks = (enum option_linebreaks)n;
 						break;
 					case 'b':
 						if(!(n = ParseIntArg(sgfc, &c, 3)))
-							return false;
+							goto parse_error;
 						options->find_start = (enum option_findstart)n;
 						break;
 					case 'E':
 						if(!(n = ParseIntArg(sgfc, &c, 3)))
-							return false;
+							goto parse_error;
 						options->encoding = (enum option_encoding)n;
 						break;
 					case 'y':
 						if((n = ParsePropertyArg(sgfc, &c)) == -1)
-							return false;
+							goto parse_error;
 						options->delete_property[n] = true;
 						break;
 					case '-':	/* long options */
@@ -302,13 +362,31 @@ bool ParseArgs(struct SGFInfo *sgfc, int argc, const char *argv[])
 						{
 							options->forced_encoding = ValidateEncoding(sgfc, &argv[i][9+2], "encoding");
 							if(!options->forced_encoding)
-								return false;
+								goto parse_error;
 						}
 						else if(!strncmp(c, "default-encoding=", 17))
 						{
 							options->default_encoding = ValidateEncoding(sgfc, &argv[i][17+2], "default-encoding");
 							if(!options->default_encoding)
-								return false;
+								goto parse_error;
+						}
+						else if(!strcmp(c, "batch"))
+							options->batch = true;
+						else if(!strcmp(c, "parallel"))
+							options->parallel = true;
+						else if(!strcmp(c, "verbatim"))
+							options->verbatim = true;
+						else if(!strncmp(c, "write-snapshot=", 15) && c[15])
+							options->snapshot = &argv[i][15+2];
+						else if(!strcmp(c, "read-snapshot"))
+							options->read_snapshot = true;
+						else if(!strcmp(c, "position-hashes"))
+							options->position_hashes = true;
+						else if(!strncmp(c, "threads=", 8))
+						{
+							c += 7;
+							if(!(options->threads = ParseIntArg(sgfc, &c, MAX_THREADS)))
+								goto parse_error;
 						}
 						else if(!*c)	/* just '--'; in order to specify filenames starting with '-' */
 						{
@@ -317,37 +395,48 @@ bool ParseArgs(struct SGFInfo *sgfc, int argc, const char *argv[])
 						else
 						{
 							PrintError(FE_UNKNOWN_LONG_OPTION, sgfc, c);
-							return false;
+							goto parse_error;
 						}
 						goto argument_parsed;
 					default:
 					{
 						PrintError(FE_UNKNOWN_OPTION, sgfc, *c);
-						return false;
+						goto parse_error;
 					}
 				}
 			}
 		}
 		else	/* argument isn't preceded by '-' or we are past '--' */
+			files[num_files++] = argv[i];
+argument_parsed:;
+	}
+
+	if(options->batch)
+	{
+		if(options->read_snapshot || options->snapshot)
 		{
-			if(!options->infile)
-			{
-				options->infile = argv[i];
-			}
-			else if(!options->outfile)
-			{
-				options->outfile = argv[i];
-			}
-			else
-			{
-				PrintError(FE_TOO_MANY_FILES, sgfc, argv[i]);
-				return false;
-			}
+			PrintError(FE_BATCH_OPTION, sgfc, options->read_snapshot ? "--read-snapshot" : "--write-snapshot");
+			goto parse_error;
 		}
-argument_parsed:;
+		free(options->batch_files);
+		options->batch_files = files;
+		options->batch_count = num_files;
+		return true;
 	}
 
+	if(num_files > 2)
+	{
+		PrintError(FE_TOO_MANY_FILES, sgfc, files[2]);
+		goto parse_error;
+	}
+	if(num_files > 0)	options->infile = files[0];
+	if(num_files > 1)	options->outfile = files[1];
+	free(files);
 	return true;
+
+parse_error:
+	free(files);
+	return false;
 }
 
 
@@ -363,7 +452,7 @@ struct SGFCOptions *SGFCDefaultOptions(void)
 {
 	struct SGFCOptions *options;
 
-	options = SaveMalloc(sizeof(struct SGFCOptions), "SGFC options");
+	options = SaveMalloc(NULL, sizeof(struct SGFCOptions), "SGFC options");
 	memset(options->error_enabled, true, sizeof(options->error_enabled));
 	memset(options->delete_property, false, sizeof(options->delete_property));
 	options->help = OPTION_HELP_NONE;
@@ -387,6 +476,15 @@ struct SGFCOptions *SGFCDefaultOptions(void)
 	options->strict_checking = false;
 	options->reorder_variations = false;
 	options->add_sgfc_ap_property = true;
+	options->batch = false;
+	options->parallel = false;
+	options->verbatim = false;
+	options->read_snapshot = false;
+	options->position_hashes = false;
+	options->snapshot = NULL;
+	options->threads = 0;
+	options->batch_files = NULL;
+	options->batch_count = 0;
 	options->encoding = OPTION_ENCODING_EVERYTHING;
 	options->infile = NULL;
 	options->outfile = NULL;
@@ -399,7 +497,8 @@ struct SGFCOptions *SGFCDefaultOptions(void)
 /**************************************************************************
 *** Function:	SetupSGFInfo
 ***				Allocates SGFInfo structure and initializes it with
-***             default values for ->options, ->sfh, and internal structures.
+***             default values for ->options, ->sfh, error & OOM hooks,
+***				and internal structures.
 *** Parameters: options ... pointer to SGFCOptions;
 ***							if NULL filled with SGFCDefaultOptions()
 *** Returns:	pointer to SGFInfo structure ready for use in LoadSGF etc.
@@ -407,60 +506,112 @@ struct SGFCOptions *SGFCDefaultOptions(void)
 
 struct SGFInfo *SetupSGFInfo(struct SGFCOptions *options)
 {
-	struct SGFInfo *sgfc = SaveCalloc(sizeof(struct SGFInfo), "SGFInfo structure");
+	struct SGFInfo *sgfc = SaveCalloc(NULL, sizeof(struct SGFInfo), "SGFInfo structure");
+
+	SetupTokenIndex();
 
 	if(options)		sgfc->options = options;
 	else			sgfc->options = SGFCDefaultOptions();
 
-	sgfc->_error_c = SetupErrorC_internal();
+	sgfc->print_error_handler = PrintErrorHandler;
+	sgfc->print_error_output_hook = PrintErrorOutputHook;
+	sgfc->oom_panic_hook = ExitWithOOMError;
+	sgfc->user_data = NULL;
+	sgfc->_error_c = SetupErrorC_internal(sgfc);
+	sgfc->_arena = SetupMemArena(sgfc);
 	return sgfc;
 }
 
 
 /**************************************************************************
-*** Function:	FreeSGFInfo
-***				Frees all memory and other resources of an SGFInfo structure
-***				including(!) referenced sub structures and SGFInfo itself
+*** Function:	FreeTreeInfo
+***				Frees list of TreeInfo structures
 *** Parameters: sgfc ... pointer to SGFInfo structure
 *** Returns:	-
 **************************************************************************/
 
-void FreeSGFInfo(struct SGFInfo *sgfc)
+static void FreeTreeInfo(struct SGFInfo *sgfc)
 {
-	struct Node *n, *m;
-	struct Property *p;
 	struct TreeInfo *t, *hlp;
 
-	if(!sgfc)							/* check just to be sure */
-		return;
-
-	t = sgfc->tree;						/* free TreeInfo's */
+	t = sgfc->tree;
 	while(t)
 	{
 		if(t->encoding)
-			iconv_close(t->encoding);
+			ReleaseIConV(sgfc, t->encoding);
 		hlp = t->next;
 		free(t);
 		t = hlp;
 	}
+}
 
-	n = sgfc->first;						/* free Nodes */
-	while(n)
-	{
-		m = n->next;
-		p = n->prop;
-		while(p)
-			p = DelProperty(n, p);		/* and properties */
-		free(n);
-		n = m;
-	}
 
+/**************************************************************************
+*** Function:	ResetSGFInfo
+***				Prepares an SGFInfo structure for loading the next file.
+***				Frees the file buffer and the game trees, resets counters
+***				and error state. Options and hooks stay untouched; the arena keeps
+***				its memory blocks and the iconv cache its descriptors, so that
+***				loading many files in a row doesn't need to go back to the
+***				system for every node or encoding.
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+void ResetSGFInfo(struct SGFInfo *sgfc)
+{
+	FreeTreeTexts(sgfc);
+	FreeTreeInfo(sgfc);
+	FreeSGFBuffer(sgfc);
 	if(sgfc->global_encoding_name)
 		free(sgfc->global_encoding_name);
-	if(sgfc->buffer)
-		free(sgfc->buffer);
+	free(sgfc->_error_c);
+
+	sgfc->first = sgfc->tail = NULL;
+	sgfc->tree = sgfc->last = sgfc->info = NULL;
+	sgfc->root = NULL;
+	sgfc->last_root = NULL;
+	sgfc->global_encoding_name = NULL;
+	sgfc->error_count = 0;
+	sgfc->critical_count = 0;
+	sgfc->warning_count = 0;
+	sgfc->ignored_count = 0;
+	sgfc->_messages = 0;
+	sgfc->_num_source = 0;
+	sgfc->_error_c = SetupErrorC_internal(sgfc);
+	FreeIDTable(sgfc);
+	ResetMemArena(sgfc->_arena);
+}
+
+
+/**************************************************************************
+*** Function:	FreeSGFInfo
+***				Frees all memory and other resources of an SGFInfo structure
+***				including(!) referenced sub structures and SGFInfo itself
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+void FreeSGFInfo(struct SGFInfo *sgfc)
+{
+	if(!sgfc)							/* check just to be sure */
+		return;
+
+	FreeTreeTexts(sgfc);
+	FreeTreeInfo(sgfc);
+	FreeIDTable(sgfc);
+	FreeMemArena(sgfc->_arena);			/* nodes, properties, values */
+
+	if(sgfc->global_encoding_name)
+		free(sgfc->global_encoding_name);
+	FreeSGFBuffer(sgfc);
+	FreeIConvCache(sgfc->_iconv_cache);
+	free(sgfc->_source);
 	if(sgfc->options)
+	{
+		free(sgfc->options->batch_files);
 		free(sgfc->options);
+	}
 	if(sgfc->_error_c)
 		free(sgfc->_error_c);
 	free(sgfc);
@@ -59,6 +59,200 @@ static void ParseText_Unescape(char *s, size_t *len)
 }
 
 
+/* text values of a tree, decoded in one go (see DecodeTreeTexts) */
+struct TextBatch
+{
+	const char **value;			/* original value strings (lookup keys) */
+	struct DecodeSegment *seg;	/* seg[].in: unescaped copy of value */
+	size_t num, max;
+	size_t next;				/* expected next value (see FindTreeText) */
+	char *input;				/* unescaped copies of all values */
+	size_t input_size, input_max;
+	char *output;				/* decoded values (arena memory) */
+};
+
+/* how many gathered values FindTreeText() may skip (values deleted
+** or changed before being checked) */
+#define TEXT_BATCH_LOOKAHEAD	8
+
+
+/**************************************************************************
+*** Function:	IsTextProperty
+***				Checks if values of a property get passed to Parse_Text
+***				(value2 only for some of them, but that doesn't hurt)
+*** Parameters: p	... pointer to property
+*** Returns:	true/false
+**************************************************************************/
+
+static bool IsTextProperty(const struct Property *p)
+{
+	bool (*check)(struct SGFInfo *, struct Property *, struct PropValue *) = sgf_token[p->id].CheckValue;
+	return check == Check_Text || check == Check_Label || check == Check_Figure;
+}
+
+
+/**************************************************************************
+*** Function:	AddTreeText
+***				Adds an unescaped copy of a value to the text batch
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				batch	... text batch
+***				value	... value string
+***				len		... length of value
+*** Returns:	-
+**************************************************************************/
+
+static void AddTreeText(struct SGFInfo *sgfc, struct TextBatch *batch, const char *value, size_t len)
+{
+	struct DecodeSegment *seg;
+	char *in;
+
+	if(batch->num == batch->max)
+	{
+		batch->max = batch->max ? batch->max * 2 : 256;
+		batch->value = SaveRealloc(sgfc, batch->value, batch->max * sizeof(char *), "text batch buffer");
+		batch->seg = SaveRealloc(sgfc, batch->seg, batch->max * sizeof(struct DecodeSegment), "text batch buffer");
+	}
+	if(batch->input_size + len + 1 > batch->input_max)
+	{
+		batch->input_max = (batch->input_max + len + 1) * 2;
+		batch->input = SaveRealloc(sgfc, batch->input, batch->input_max, "text batch buffer");
+	}
+
+	/* seg->in is set once input doesn't move anymore (see DecodeTreeTexts) */
+	seg = &batch->seg[batch->num];
+	in = batch->input + batch->input_size;
+	memcpy(in, value, len);
+	in[len] = 0;
+	seg->in_len = len;
+	ParseText_Unescape(in, &seg->in_len);
+	batch->input_size += seg->in_len + 1;
+	batch->value[batch->num++] = value;
+}
+
+
+/**************************************************************************
+*** Function:	DecodeTreeTexts
+***				OPTION_ENCODING_TEXT_ONLY: gathers all text values of
+***				a tree (in the order they get checked) and decodes them
+***				with a single DecodeSegments() call into one output
+***				buffer, instead of one DecodeBuffer() call, allocation
+***				and copy per value. ParseText_Decode() picks up the
+***				results; values that changed in the meantime (or were
+***				not gathered) are decoded individually as before.
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				ti	 ... tree (sgfc->info)
+*** Returns:	-
+**************************************************************************/
+
+void DecodeTreeTexts(struct SGFInfo *sgfc, struct TreeInfo *ti)
+{
+	struct TextBatch *batch;
+	struct Node *n = ti->root;
+	struct Property *p;
+	struct PropValue *v;
+	char *output, *in;
+	size_t i, out_size;
+
+	FreeTreeTexts(sgfc);
+	if(sgfc->options->encoding != OPTION_ENCODING_TEXT_ONLY || !ti->encoding)
+		return;
+
+	batch = SaveCalloc(sgfc, sizeof(struct TextBatch), "text batch");
+	while(n)
+	{
+		for(p = n->prop; p; p = p->next)
+			if(IsTextProperty(p))
+				for(v = p->value; v; v = v->next)
+				{
+					if(v->value_len)
+						AddTreeText(sgfc, batch, v->value, v->value_len);
+					if(v->value2 && v->value2_len)
+						AddTreeText(sgfc, batch, v->value2, v->value2_len);
+				}
+
+		if(n->child)			/* next node in pre-order, within tree */
+			n = n->child;
+		else
+		{
+			while(n != ti->root && !n->sibling)
+				n = n->parent;
+			n = n == ti->root ? NULL : n->sibling;
+		}
+	}
+
+	sgfc->_text_batch = batch;
+	if(!batch->num)
+		return;
+
+	for(i = 0, in = batch->input; i < batch->num; i++)
+	{
+		batch->seg[i].in = in;
+		in += batch->seg[i].in_len + 1;
+	}
+	output = DecodeSegments(sgfc, ti->encoding, batch->seg, batch->num, &out_size);
+	batch->output = ArenaAllocString(sgfc, out_size);
+	memcpy(batch->output, output, out_size);
+	free(output);
+}
+
+
+/**************************************************************************
+*** Function:	FreeTreeTexts
+***				Frees data of DecodeTreeTexts()
+***				(decoded values themselves are arena memory)
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+void FreeTreeTexts(struct SGFInfo *sgfc)
+{
+	struct TextBatch *batch = sgfc->_text_batch;
+
+	if(!batch)
+		return;
+	free(batch->value);
+	free(batch->seg);
+	free(batch->input);
+	free(batch);
+	sgfc->_text_batch = NULL;
+}
+
+
+/**************************************************************************
+*** Function:	FindTreeText
+***				Looks up decoded value in results of DecodeTreeTexts().
+***				Values are checked in the order they were gathered,
+***				so only the next few entries are searched.
+*** Parameters: sgfc  ... pointer to SGFInfo structure
+***				value ... unescaped value
+***				len	  ... length of value
+*** Returns:	pointer to segment or NULL if not found or value changed
+**************************************************************************/
+
+static struct DecodeSegment *FindTreeText(struct SGFInfo *sgfc, const char *value, size_t len)
+{
+	struct TextBatch *batch = sgfc->_text_batch;
+	struct DecodeSegment *seg;
+	size_t i, end;
+
+	if(!batch)
+		return NULL;
+	end = batch->next + TEXT_BATCH_LOOKAHEAD;
+	if(end > batch->num)
+		end = batch->num;
+	for(i = batch->next; i < end; i++)
+		if(batch->value[i] == value)
+		{
+			batch->next = i + 1;
+			seg = &batch->seg[i];
+			if(seg->in_len != len || memcmp(seg->in, value, len))
+				return NULL;
+			return seg;
+		}
+	return NULL;
+}
+
+
 /**************************************************************************
 *** Function:	ParseText_Decode - helper function for Parse_Text
 ***				Decoding in case of OPTION_ENCODING_TEXT_ONLY
@@ -70,7 +264,25 @@ static void ParseText_Unescape(char *s, size_t *len)
 static bool ParseText_Decode(struct SGFInfo *sgfc, char **value_ptr, size_t *len)
 {
 	const char *end;
-	char *decoded = DecodeBuffer(sgfc, sgfc->info->encoding, *value_ptr, *len, 0, &end);
+	char *decoded;
+	struct DecodeSegment *seg = FindTreeText(sgfc, *value_ptr, *len);
+
+	if(seg)		/* already decoded by DecodeTreeTexts() */
+	{
+		if(seg->illegal != (size_t)-1)
+			PrintError(WS_ENCODING_ERRORS, sgfc, seg->illegal);
+		if(seg->ok)
+		{
+			*value_ptr = sgfc->_text_batch->output + seg->out_offset;
+			*len = seg->out_len;
+			return true;
+		}
+		PrintError(FE_ENCODING_ERROR, sgfc, seg->fatal);
+		decoded = NULL;
+	}
+	else
+		decoded = DecodeBuffer(sgfc, sgfc->info->encoding, *value_ptr, *len, 0, &end);
+
 	if(!decoded)
 	{
 		**value_ptr = 0;		/* in case of error: delete property value */
@@ -78,9 +290,9 @@ static bool ParseText_Decode(struct SGFInfo *sgfc, char **value_ptr, size_t *len
 		return false;
 	}
 
-	free(*value_ptr); 			/* swap buffer for decoded buffer */
-	*value_ptr = decoded;
-	*len = (size_t)(end - decoded);
+	*len = (size_t)(end - decoded);	/* swap buffer for decoded buffer */
+	*value_ptr = ArenaDupString(sgfc, decoded, *len);
+	free(decoded);
 	return true;
 }
 
@@ -90,12 +302,11 @@ static bool ParseText_Decode(struct SGFInfo *sgfc, char **value_ptr, size_t *len
 ***				Normalize whitespace and linebreaks; replace $00 bytes with space
 *** Parameters: s	... pointer to property value
 ***				len		... length of string
-***				row		... row number of property value
-***				col		... column of property value
+***				pos		... buffer position of property value
 *** Returns:	-
 **************************************************************************/
 
-static void ParseText_NormalizeWhitespace(struct SGFInfo *sgfc, char *s, size_t *len, U_LONG row, U_LONG col)
+static void ParseText_NormalizeWhitespace(struct SGFInfo *sgfc, char *s, size_t *len, U_LONG pos)
 {
 	char old = 0;
 	char *d = s;
@@ -123,7 +334,7 @@ static void ParseText_NormalizeWhitespace(struct SGFInfo *sgfc, char *s, size_t
 				*d++ = ' ';
 			else if(!*s)				/* replace \0 bytes with space, so that we can use NULL terminated strings */
 			{
-				PrintError(W_CTRL_BYTE_DELETED, sgfc, row, col+1);
+				PrintError(W_CTRL_BYTE_DELETED, sgfc, pos ? pos+1 : 0);
 				*d++ = ' ';
 			}
 			else
@@ -227,6 +438,30 @@ static void ParseText_StripTrailingSpace(char *value, size_t *len)
 }
 
 
+/**************************************************************************
+*** Function:	ParseText_NeedsRewrite - helper function for Parse_Text
+***				Checks if any of the ParseText_* helpers would change
+***				the value (escapes, linebreaks, control chars or
+***				trailing whitespace)
+*** Parameters: value	... pointer to property value
+***				len		... length of string
+*** Returns:	true if value has to be rewritten
+**************************************************************************/
+
+static bool ParseText_NeedsRewrite(const char *value, size_t len)
+{
+	const unsigned char *s = (const unsigned char *)value;
+	const unsigned char *end = s + len;
+
+	if(len && isspace(*(end-1)))
+		return true;
+	for(; s < end; s++)
+		if(*s < 32 || *s == '\\')
+			return true;
+	return false;
+}
+
+
 /**************************************************************************
 *** Function:	Parse_Text
 ***				Transforms any kind of linebreaks to '\n' (or ' ')
@@ -249,11 +484,18 @@ int Parse_Text(struct SGFInfo *sgfc, struct PropValue *v, int prop_num, U_SHORT
 		value_len = &v->value2_len;
 	}
 
+	if(IsBufferSlice(sgfc, *value_ptr))
+	{
+		if(!ParseText_NeedsRewrite(*value_ptr, *value_len))
+			return (int)(*value_len);
+		*value_ptr = DupValueString(sgfc, *value_ptr, *value_len);
+	}
+
 	ParseText_Unescape(*value_ptr, value_len);
 	if(sgfc->options->encoding == OPTION_ENCODING_TEXT_ONLY)
 		if(!ParseText_Decode(sgfc, value_ptr, value_len))
 			return 0;
-	ParseText_NormalizeWhitespace(sgfc, *value_ptr, value_len, v->row, v->col);
+	ParseText_NormalizeWhitespace(sgfc, *value_ptr, value_len, v->pos);
 	ParseText_ApplyLinebreakStyle(sgfc, *value_ptr, value_len, flags);
 	ParseText_StripTrailingSpace(*value_ptr, value_len);
 
@@ -633,46 +875,78 @@ int Parse_Charset(char *value, size_t *len, ...)
 /**************************************************************************
 *** Function:	Check_Value // Check_Single_Value (helper)
 ***				Checks value type & prints error messages
+***				The value is parsed in a scratch copy; it is replaced
+***				by a private copy only if the parser changed it
+***				(also if it has to be deleted).
 *** Parameters: sgfc	... pointer to SGFInfo structure
 ***				p		... pointer to property containing the value
 ***				v		... pointer to property value
+***				prop_num ... prop value 1 or prop value 2
 ***				flags	... flags to be passed on to parse function
 ***				Parse_Value ... function used for parsing
 *** Returns:	true for success / false if value has to be deleted
 **************************************************************************/
 
 static bool Check_Single_Value(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v,
-							   char *value, size_t *value_len, U_SHORT flags,
+							   int prop_num, U_SHORT flags,
 							   int (*Parse_Value)(char *, size_t *, ...))
 {
-	char *before = SaveDupString(value, 0, "prop value before checking");
+	char **value_ptr = &v->value;
+	size_t *value_len = &v->value_len;
+	char scratch[32], *value;
+	size_t len;
+	bool result = true;
+
+	if(prop_num == 2)
+	{
+		value_ptr = &v->value2;
+		value_len = &v->value2_len;
+	}
 
-	switch((*Parse_Value)(value, value_len, flags, sgfc))
+	len = *value_len;
+	/* +2 because Parse_Float may add 1 char and for trailing '\0' byte */
+	if(len + 2 <= sizeof(scratch))
+		value = scratch;
+	else
+		value = SaveMalloc(sgfc, len + 2, "prop value while checking");
+	memcpy(value, *value_ptr, len + 1);
+
+	switch((*Parse_Value)(value, &len, flags, sgfc))
 	{
 		case -101:	/* special case for Parse_Move */
-					PrintError(E_FF4_PASS_IN_OLD_FF, sgfc, v->row, v->col);
+					PrintError(E_FF4_PASS_IN_OLD_FF, sgfc, v->pos);
+					break;
+		case -1:	PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->pos, *value_ptr, p->idstr, value);
 					break;
-		case -1:	PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->row, v->col, before, p->idstr, value);
+		case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, *value_ptr, p->idstr);
+					result = false;
 					break;
-		case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, before, p->idstr);
-					free(before);
-					return false;
 		case 1:
 		case 2:		break;
 	}
-	free(before);
-	return true;
+
+	/* deleted values keep the parser's result as well (as if parsed in place):
+	 * callers which don't delete them see e.g. an empty value */
+	if(len != *value_len || memcmp(value, *value_ptr, len))
+	{
+		*value_ptr = DupValueString(sgfc, value, len);
+		*value_len = len;
+	}
+
+	if(value != scratch)
+		free(value);
+	return result;
 }
 
 bool Check_Value(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v,
 				 U_SHORT flags, int (*Parse_Value)(char *, size_t *, ...))
 {
-	if (!Check_Single_Value(sgfc, p, v, v->value, &v->value_len, flags, Parse_Value))
+	if (!Check_Single_Value(sgfc, p, v, 1, flags, Parse_Value))
 		return false;
 
 	/* If there's a compose value, then parse the second value like the first one */
 	if (flags & (PVT_COMPOSE|PVT_WEAKCOMPOSE) && v->value2)
-		return Check_Single_Value(sgfc, p, v, v->value2, &v->value2_len, flags, Parse_Value);
+		return Check_Single_Value(sgfc, p, v, 2, flags, Parse_Value);
 
 	return true;
 }
@@ -699,7 +973,7 @@ bool Check_Text(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 
 	if(!value_len && !value2_len && (p->flags & PVT_DEL_EMPTY))
 	{
-		PrintError(W_EMPTY_VALUE_DELETED, sgfc, v->row, v->col, p->idstr, "found");
+		PrintError(W_EMPTY_VALUE_DELETED, sgfc, v->pos, p->idstr, "found");
 		return false;
 	}
 	return true;
@@ -723,13 +997,14 @@ bool Check_Pos(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 	if(v->value2)	/* compressed point list */
 	{
 		if(sgfc->info->FF < 4)
-			PrintError(E_VERSION_CONFLICT, sgfc, v->row, v->col, sgfc->info->FF);
+			PrintError(E_VERSION_CONFLICT, sgfc, v->pos, sgfc->info->FF);
 
+		OwnPropValue(sgfc, v);
 		switch(Parse_Move(v->value2, &v->value2_len, PARSE_POS, sgfc))
 		{
-			case -1:	PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->row, v->col, v->value, p->idstr, v->value2);
+			case -1:	PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->pos, v->value, p->idstr, v->value2);
 						break;
-			case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, v->value, p->idstr);
+			case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, v->value, p->idstr);
 						return false;
 			case 1:		break;
 		}
@@ -759,13 +1034,11 @@ bool Check_Stone(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 	if(v->value2)
 	{
 		/* stone type was erroneously split by load.c into composed value -> merge again */
-		char *stone_value = SaveMalloc(v->value_len + v->value2_len + 2, "property value buffer");
+		char *stone_value = ArenaAllocString(sgfc, v->value_len + v->value2_len + 2);
 		memcpy(stone_value, v->value, v->value_len);
 		memcpy(stone_value + v->value_len + 1, v->value2, v->value2_len);
 		stone_value[v->value_len] = ':';					/* restore colon */
 		stone_value[v->value_len + v->value2_len + 1] = 0;	/* 0-terminate */
-		free(v->value);
-		free(v->value2);
 		v->value = stone_value;
 		v->value_len += v->value2_len + 1;
 		v->value2 = NULL;
@@ -791,17 +1064,18 @@ bool Check_Label(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 	int error = 0;
 	bool result = false;
 
-	char *before = SaveMalloc(v->value_len+v->value2_len+2, "AR_LN value");
+	char *before = SaveMalloc(sgfc, v->value_len+v->value2_len+2, "AR_LN value");
 	sprintf(before, "%s:%s", v->value, v->value2);
+	OwnPropValue(sgfc, v);
 
 	switch(Parse_Move(v->value, &v->value_len, PARSE_POS, sgfc))
 	{
-		case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, before, p->idstr);
+		case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, before, p->idstr);
 					goto done;
 		case -1:	error = 1;
 		case 1:		switch(Parse_Text(sgfc, v, 2, p->flags))
 					{
-						case 0:	PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, before, p->idstr);
+						case 0:	PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, before, p->idstr);
 								goto done;
 						case 1:	if(v->value2_len > 4 && sgfc->info->FF < 4)
 								{
@@ -811,7 +1085,7 @@ bool Check_Label(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 								break;
 					}
 					if(error)
-						PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->row, v->col, before,
+						PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->pos, before,
 				 				   p->idstr, v->value, v->value2);
 					break;
 	}
@@ -837,30 +1111,31 @@ bool Check_AR_LN(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 	int error = 0;
 	bool result = false;
 
-	char *before = SaveMalloc(v->value_len+v->value2_len+2, "AR_LN value");
+	char *before = SaveMalloc(sgfc, v->value_len+v->value2_len+2, "AR_LN value");
 	sprintf(before, "%s:%s", v->value, v->value2);
+	OwnPropValue(sgfc, v);
 
 	switch(Parse_Move(v->value, &v->value_len, PARSE_POS, sgfc))
 	{
-		case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, before, p->idstr);
+		case 0:		PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, before, p->idstr);
 					goto done;
 		case -1:	error = 1;
 		case 1:		switch(Parse_Move(v->value2, &v->value2_len, PARSE_POS, sgfc))
 					{
-						case 0:	PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, before, p->idstr);
+						case 0:	PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, before, p->idstr);
 								goto done;
 						case -1:
 								error = 1;
 						case 1:	if(!strcmp(v->value, v->value2))
 								{
-									PrintError(E_BAD_VALUE_DELETED, sgfc, v->row, v->col, before, p->idstr);
+									PrintError(E_BAD_VALUE_DELETED, sgfc, v->pos, before, p->idstr);
 									goto done;
 								}
 								break;
 					}
 					if(error)
 						PrintError(E_BAD_COMPOSE_CORRECTED, sgfc,
-				 				   v->row, v->col, before, p->idstr, v->value, v->value2);
+				 				   v->pos, before, p->idstr, v->value, v->value2);
 					break;
 	}
 	result = true;
@@ -887,24 +1162,27 @@ bool Check_Figure(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 		if(v->value_len)
 		{
 			if(!Parse_Text(sgfc, v, 1, PVT_SIMPLE|PVT_COMPOSE))
-				PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->row, v->col, v->value, "FG", "");
+				PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->pos, v->value, "FG", "");
 			else
 			{
 				v->value2 = v->value;
-				v->value = SaveMalloc(4, "new FG number value");
-				strcpy(v->value, "0");
-				PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->row, v->col, v->value, "FG", v->value, v->value2);
+				v->value2_len = v->value_len;
+				v->value = ArenaDupString(sgfc, "0", 0);
+				v->value_len = 1;
+				PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->pos, v->value, "FG", v->value, v->value2);
 			}
 		}
 	}
 	else
 	{
 		Parse_Text(sgfc, v, 2, PVT_SIMPLE|PVT_COMPOSE);
+		OwnPropValue(sgfc, v);
 		switch(Parse_Number(v->value, &v->value_len))
 		{
 			case 0:	strcpy(v->value, "0");
+					v->value_len = 1;
 			case -1:
-					PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->row, v->col, v->value,
+					PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->pos, v->value,
 							   "FG", v->value, v->value2);
 			case 1:	break;
 		}
@@ -933,12 +1211,12 @@ static void Check_PropValues(struct SGFInfo *sgfc, struct Property *p)
 		{
 			if(sgf_token[p->id].flags & PVT_DEL_EMPTY)
 			{
-				PrintError(W_EMPTY_VALUE_DELETED, sgfc, v->row, v->col, p->idstr, "found");
+				PrintError(W_EMPTY_VALUE_DELETED, sgfc, v->pos, p->idstr, "found");
 				v = DelPropValue(p, v);
 			}
 			else if(!(p->flags & PVT_EMPTY))
 			{
-				PrintError(E_EMPTY_VALUE_DELETED, sgfc, v->row, v->col, p->idstr, "not allowed");
+				PrintError(E_EMPTY_VALUE_DELETED, sgfc, v->pos, p->idstr, "not allowed");
 				v = DelPropValue(p, v);
 			}
 			else
@@ -968,13 +1246,13 @@ static void Check_PropValues(struct SGFInfo *sgfc, struct Property *p)
 
 static void CheckID_Lowercase(struct SGFInfo *sgfc, struct Property *p)
 {
-	char *id = p->idstr;
+	const char *id = p->idstr;
 
 	while(isalpha(*id))
 	{
 		if(islower((unsigned char)*id))
 		{
-			PrintError(E_LC_IN_PROPID, sgfc, p->row, p->col, p->idstr);
+			PrintError(E_LC_IN_PROPID, sgfc, p->pos, p->idstr);
 			break;		/* print error only once */
 		}
 		id++;
@@ -985,7 +1263,10 @@ static void CheckID_Lowercase(struct SGFInfo *sgfc, struct Property *p)
 /**************************************************************************
 *** Function:	Check_Properties
 ***				Performs various checks on properties ID's
-***				and calls Check_PropValues
+***				and calls Check_PropValues.
+***				st->setup_hash gets the hash of the position after the
+***				setup properties of the node only (see Do_AddStones()),
+***				for nodes that SplitMoveSetup() splits afterwards.
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				p	 ... pointer to node containing the properties
 ***				st	 ... pointer to board status
@@ -997,6 +1278,7 @@ void Check_Properties(struct SGFInfo *sgfc, struct Node *n, struct BoardStatus *
 	struct Property *p, *hlp;
 	int capped_ff = sgfc->info->FF <= 4 ? sgfc->info->FF : 4;
 
+	st->setup_hash = st->hash;
 	p = n->prop;
 	while(p)						/* property loop */
 	{
@@ -1004,17 +1286,17 @@ void Check_Properties(struct SGFInfo *sgfc, struct Node *n, struct BoardStatus *
 			 (p->id != TKN_KI))
 		{
 			if(sgf_token[p->id].data & ST_OBSOLETE)
-				PrintError(WS_PROPERTY_NOT_IN_FF, sgfc, p->row, p->col,
+				PrintError(WS_PROPERTY_NOT_IN_FF, sgfc, p->pos,
 			   			   p->idstr, sgfc->info->FF, "converted");
 			else
-				PrintError(WS_PROPERTY_NOT_IN_FF, sgfc, p->row, p->col,
+				PrintError(WS_PROPERTY_NOT_IN_FF, sgfc, p->pos,
 			   			   p->idstr, sgfc->info->FF, "parsing done anyway");
 		}
 
 		if(!sgfc->options->keep_obsolete_props && !(sgf_token[p->id].ff & FF4) &&
 		   !(sgf_token[p->id].data & ST_OBSOLETE))
 		{
-			PrintError(W_PROPERTY_DELETED, sgfc, p->row, p->col, "obsolete ", p->idstr);
+			PrintError(W_PROPERTY_DELETED, sgfc, p->pos, "obsolete ", p->idstr);
 			p = DelProperty(n, p);
 			continue;
 		}
@@ -36,13 +36,16 @@ bool ExpandPointList(struct SGFInfo *sgfc, struct Property *p, struct PropValue
 
 	if(x1 == x2 && y1 == y2)	/* illegal definition */
 	{
-		free(v->value2);
 		v->value2 = NULL;
+		v->value2_len = 0;
 		if(print_error)
-			PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->row, v->col, v->value, p->idstr, v->value);
+			PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->pos, v->value, p->idstr, v->value);
 		return false;
 	}
 
+	if(x1 > x2 || y1 > y2)
+		OwnPropValue(sgfc, v);
+
 	if(x1 > x2)					/* encoded as [ul:lr] ? */
 	{
 		h = x1; x1 = x2; x2 = h;
@@ -58,14 +61,14 @@ bool ExpandPointList(struct SGFInfo *sgfc, struct Property *p, struct PropValue
 	}
 
 	if(h && print_error)
-		PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->row, v->col, v->value, p->idstr, v->value, v->value2);
+		PrintError(E_BAD_COMPOSE_CORRECTED, sgfc, v->pos, v->value, p->idstr, v->value, v->value2);
 
 	for(; x1 <= x2; x1++)		/* expand point list */
 		for(h = y1; h <= y2; h++)
 		{
 			val[0] = EncodePosChar(x1);
 			val[1] = EncodePosChar(h);
-			AddPropValue(sgfc, p, v->row, v->col, val, 2, NULL, 0);
+			AddPropValue(sgfc, p, v->pos, val, 2, NULL, 0);
 		}
 
 	return true;
@@ -75,6 +78,9 @@ bool ExpandPointList(struct SGFInfo *sgfc, struct Property *p, struct PropValue
 /**************************************************************************
 *** Function:	CompressPointList
 ***				A simple greedy algorithm to compress pointlists
+***				Already compressed values [ul:lr] are taken into account,
+***				so compressing a list again yields the same list
+***				(SaveSGF() may write a tree more than once).
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				p	 ... property which list should get compressed
 *** Returns:	- (exits on low memory)
@@ -83,7 +89,7 @@ bool ExpandPointList(struct SGFInfo *sgfc, struct Property *p, struct PropValue
 void CompressPointList(struct SGFInfo *sgfc, struct Property *p)
 {
 	char board[MAX_BOARDSIZE+2][MAX_BOARDSIZE+2];
-	int x, y, yy, i, j, m, mx, my;
+	int x, y, yy, i, j, i2, j2, m, mx, my;
 	bool expx, expy;
 	struct PropValue *v;
 	char val1[12], val2[2];
@@ -98,13 +104,21 @@ void CompressPointList(struct SGFInfo *sgfc, struct Property *p)
 	{
 		if(v->value_len)
 		{
-			i = DecodePosChar(v->value[0]);
-			j = DecodePosChar(v->value[1]);
-			board[i][j] = 1;
+			i = i2 = DecodePosChar(v->value[0]);
+			j = j2 = DecodePosChar(v->value[1]);
+			if(v->value2 && v->value2_len >= 2)		/* compressed [ul:lr] */
+			{
+				i2 = DecodePosChar(v->value2[0]);
+				j2 = DecodePosChar(v->value2[1]);
+				if(i > i2)	{ m = i; i = i2; i2 = m; }
+				if(j > j2)	{ m = j; j = j2; j2 = m; }
+			}
+			for(m = i; m <= i2; m++)
+				memset(&board[m][j], 1, (size_t)(j2 - j + 1));
 			if(x > i)	x = i;						/* get minimum */
 			if(yy > j)	yy = j;
-			if(mx < i)	mx = i;						/* get maximum */
-			if(my < j)	my = j;
+			if(mx < i2)	mx = i2;					/* get maximum */
+			if(my < j2)	my = j2;
 
 			v = DelPropValue(p, v);
 		}
@@ -153,9 +167,9 @@ void CompressPointList(struct SGFInfo *sgfc, struct Property *p)
 				val2[1] = EncodePosChar(j);
 
 				if(x != i || y != j)			/* Add new values to property */
-					AddPropValue(sgfc, p, 0, 0, val1, 2, val2, 2);
+					AddPropValue(sgfc, p, 0, val1, 2, val2, 2);
 				else
-					AddPropValue(sgfc, p, 0, 0, val1, 2, NULL, 0);
+					AddPropValue(sgfc, p, 0, val1, 2, NULL, 0);
 
 				for(; i >= x; i--)				/* remove points from board */
 					for(m = j; m >= y; m--)
@@ -255,13 +269,13 @@ static void CorrectVariation(struct SGFInfo *sgfc, struct Node *n)
 
 	if(fault && success)		/* critical case */
 	{
-		PrintError(W_VARLEVEL_UNCERTAIN, sgfc, n->row, n->col);
+		PrintError(W_VARLEVEL_UNCERTAIN, sgfc, n->pos);
 		return;
 	}
 
 	if(success)					/* found variations which can be corrected */
 	{
-		PrintError(W_VARLEVEL_CORRECTED, sgfc, n->row, n->col);
+		PrintError(W_VARLEVEL_CORRECTED, sgfc, n->pos);
 
 		i = n->sibling;
 		while(i)
@@ -287,9 +301,16 @@ static void CorrectVariation(struct SGFInfo *sgfc, struct Node *n)
 			DelNode(sgfc, j->parent, E_NO_ERROR);	/* delete SETUP node */
 
 			j->parent = p->parent;					/* move tree to new level */
-			k = p;
-			while(k->sibling)
-				k = k->sibling;
+			if(p->parent)
+			{
+				k = p->parent->last_child;
+				p->parent->last_child = j;
+			}
+			else
+			{
+				k = sgfc->last_root;
+				sgfc->last_root = j;
+			}
 			k->sibling = j;
 		}
 	}
@@ -299,127 +320,229 @@ static void CorrectVariation(struct SGFInfo *sgfc, struct Node *n)
 /**************************************************************************
 *** Function:	CorrectVariations
 ***				Checks for wrong variation levels and corrects them
+***				(depth first; explicit stack instead of recursion)
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				r	 ... start node
 ***				ti	 ... pointer to TreeInfo (for check of GM)
 *** Returns:	-
 **************************************************************************/
 
+struct CorrectFrame
+{
+	struct Node *r;			/* first node with siblings */
+	struct Node *n;			/* sibling of r whose child is being checked */
+	struct TreeInfo *ti;
+	bool child_done;
+};
+
 static void CorrectVariations(struct SGFInfo *sgfc, struct Node *r, struct TreeInfo *ti)
 {
+	struct CorrectFrame *stack = NULL, *f;
+	size_t depth = 0, max_depth = 0;
 	struct Node *n;
 
-	if(!r)
-		return;
-
-	if(!r->parent)		/* root node? */
+	while(true)
 	{
-		n = r;
-		while(n)
+		if(r)						/* start with subtree r */
 		{
-			if(FindProperty(n, TKN_B) || FindProperty(n, TKN_W))
+			if(!r->parent)		/* root node? */
 			{
-				SplitNode(sgfc, n, TYPE_ROOT | TYPE_GINFO, TKN_NONE, false);
-				PrintError(WS_MOVE_IN_ROOT, sgfc, n->row, n->col);
+				n = r;
+				while(n)
+				{
+					if(FindProperty(n, TKN_B) || FindProperty(n, TKN_W))
+					{
+						SplitNode(sgfc, n, TYPE_ROOT | TYPE_GINFO, TKN_NONE, false);
+						PrintError(WS_MOVE_IN_ROOT, sgfc, n->pos);
+					}
+					n = n->sibling;
+				}
 			}
-			n = n->sibling;
-		}
-	}
-
-	if(ti->GM != 1)		/* variation level correction only for Go games */
-		return;
 
-	while(r)
-	{
-		if(r->sibling)
-		{
-			n = r;
-			while(n)
+			if(ti->GM == 1)		/* variation level correction only for Go games */
 			{
-				if(!r->parent) CorrectVariations(sgfc, n->child, ti->next);
-				else CorrectVariations(sgfc, n->child, ti);
+				while(r && !r->sibling)
+					r = r->child;
 
-				n = n->sibling;
+				if(r)
+				{
+					if(depth == max_depth)
+						stack = GrowStack(sgfc, stack, &max_depth, sizeof(struct CorrectFrame));
+					stack[depth].r = r;
+					stack[depth].n = r;
+					stack[depth].ti = ti;
+					stack[depth].child_done = false;
+					depth++;
+				}
 			}
+		}
 
-			CorrectVariation(sgfc, r);
+		if(!depth)
 			break;
+
+		f = &stack[depth-1];
+		r = NULL;
+		if(f->n && f->child_done)
+		{
+			f->n = f->n->sibling;
+			f->child_done = false;
 		}
 
-		r = r->child;
+		if(f->n)
+		{
+			f->child_done = true;
+			r = f->n->child;
+			ti = f->r->parent ? f->ti : f->ti->next;
+		}
+		else
+		{
+			CorrectVariation(sgfc, f->r);
+			depth--;
+		}
 	}
+
+	free(stack);
 }
 
 
 /**************************************************************************
 *** Function:	ReorderVariations
 ***				Reorders variations (including main branch) from A,B,C to C,B,A
+***				(depth first; explicit stack instead of recursion)
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				r	 ... start node
 *** Returns:	-
 **************************************************************************/
 
-static void ReorderVariations(struct SGFInfo *sgfc, struct Node *r)
+struct ReorderFrame
 {
-	struct Node *n, *s[MAX_REORDER_VARIATIONS];
-	int i;
+	struct Node *r;			/* node with variations */
+	struct Node *n;			/* next variation to be reordered */
+	int i;					/* number of variations */
+};
 
-	if(!r)
-		return;
+static void ReorderVariations(struct SGFInfo *sgfc, struct Node *r)
+{
+	struct ReorderFrame *stack = NULL, *f;
+	struct Node **roots = NULL, *n, *next;
+	size_t depth = 0, max_depth = 0, num_roots = 0, max_roots = 0;
 
-	if (!r->parent && r->sibling)
-		ReorderVariations(sgfc, r->sibling);
+	for(; r; r = r->parent ? NULL : r->sibling)	/* last game tree first */
+	{
+		if(num_roots == max_roots)
+			roots = GrowStack(sgfc, roots, &max_roots, sizeof(struct Node *));
+		roots[num_roots++] = r;
+	}
 
-	while(r)
+	while(num_roots)
 	{
-		if(r->child && r->child->sibling)
+		r = roots[--num_roots];
+		do
 		{
-			i = 0;
-			n = r->child;
-			while(n)
+			while(r && !(r->child && r->child->sibling))
+				r = r->child;
+			if(r)
 			{
-				if(i >= MAX_REORDER_VARIATIONS)
-				{
-					PrintError(E_TOO_MANY_VARIATIONS, sgfc, n->row, n->col);
-					break;
-				}
-				s[i++] = n;
-				ReorderVariations(sgfc, n);
-				n = n->sibling;
+				if(depth == max_depth)
+					stack = GrowStack(sgfc, stack, &max_depth, sizeof(struct ReorderFrame));
+				stack[depth].r = r;
+				stack[depth].n = r->child;
+				stack[depth].i = 0;
+				depth++;
 			}
-			if(i < MAX_REORDER_VARIATIONS)
+
+			r = NULL;
+			while(depth && !r)
 			{
-				i--;
-				s[0]->sibling = NULL;
-				s[0]->parent->child = s[i];
-				for(; i > 0; i--)
-					s[i]->sibling = s[i-1];
+				f = &stack[depth-1];
+				if(f->n && f->i >= MAX_REORDER_VARIATIONS)
+				{
+					PrintError(E_TOO_MANY_VARIATIONS, sgfc, f->n->pos);
+					f->n = NULL;
+				}
+
+				if(f->n)
+				{
+					r = f->n;
+					f->n = r->sibling;
+					f->i++;
+				}
+				else
+				{
+					if(f->i < MAX_REORDER_VARIATIONS)
+					{						/* reverse list of children */
+						n = f->r->child;
+						f->r->last_child = n;
+						f->r->child = NULL;
+						for(; n; n = next)
+						{
+							next = n->sibling;
+							n->sibling = f->r->child;
+							f->r->child = n;
+						}
+					}
+					depth--;
+				}
 			}
-			break;
-		}
-		r = r->child;
+		} while(r);
 	}
+
+	free(stack);
+	free(roots);
 }
 
 
 /**************************************************************************
-*** Function:	DelEmptyNodes (recursive)
-***				Deletes empty nodes
+*** Function:	DelEmptyNodes
+***				Deletes empty nodes (children and following siblings
+***				first; explicit stack instead of recursion)
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				n	 ... start node
 *** Returns:	-
 **************************************************************************/
 
+struct DelEmptyFrame
+{
+	struct Node *n;
+	int state;				/* 0: start / 1: child done / 2: sibling done */
+};
+
 static void DelEmptyNodes(struct SGFInfo *sgfc, struct Node *n)
 {
-	if(n->child)
-		DelEmptyNodes(sgfc, n->child);
+	struct DelEmptyFrame *stack = NULL, *f;
+	size_t depth = 0, max_depth = 0;
 
-	if(n->sibling)
-		DelEmptyNodes(sgfc, n->sibling);
+	while(true)
+	{
+		if(n)
+		{
+			if(depth == max_depth)
+				stack = GrowStack(sgfc, stack, &max_depth, sizeof(struct DelEmptyFrame));
+			stack[depth].n = n;
+			stack[depth].state = 0;
+			depth++;
+		}
+
+		if(!depth)
+			break;
+
+		f = &stack[depth-1];
+		switch(f->state++)
+		{
+			case 0:	n = f->n->child;
+					break;
+			case 1:	n = f->n->sibling;
+					break;
+			default:
+					if(!f->n->prop)
+						DelNode(sgfc, f->n, W_EMPTY_NODE_DELETED);
+					n = NULL;
+					depth--;
+					break;
+		}
+	}
 
-	if(!n->prop)
-		DelNode(sgfc, n, W_EMPTY_NODE_DELETED);
+	free(stack);
 }
 
 
@@ -441,7 +564,7 @@ void SplitNode(struct SGFInfo *sgfc, struct Node *n, U_SHORT flags, token id, bo
 	struct Property *p, *hlp;
 	struct Node *newnode;
 
-	newnode = NewNode(sgfc, n, n->row, n->col, true);		/* create new child node */
+	newnode = NewNode(sgfc, n, n->pos, true);		/* create new child node */
 
 	p = n->prop;
 	while(p)
@@ -493,12 +616,12 @@ static int SplitMoveSetup(struct SGFInfo *sgfc, struct Node *n)
 	{
 		if(sc == 1 && s->id == TKN_PL)			/* single PL[]? */
 		{
-			PrintError(E4_MOVE_SETUP_MIXED, sgfc, s->row, s->col, "deleted PL property");
+			PrintError(E4_MOVE_SETUP_MIXED, sgfc, s->pos, "deleted PL property");
 			DelProperty(n, s);
 		}
 		else
 		{
-			PrintError(E4_MOVE_SETUP_MIXED, sgfc, s->row, s->col, "split into two nodes");
+			PrintError(E4_MOVE_SETUP_MIXED, sgfc, s->pos, "split into two nodes");
 			SplitNode(sgfc, n, TYPE_SETUP | TYPE_GINFO | TYPE_ROOT, TKN_N, false);
 			return true;
 		}
@@ -507,6 +630,25 @@ static int SplitMoveSetup(struct SGFInfo *sgfc, struct Node *n)
 }
 
 
+/**************************************************************************
+*** Function:	SamePropID
+***				Checks if two properties have the same ID (disregarding
+***				lowercase characters). ID strings are interned, so
+***				stridcmp() is needed only for differing TKN_UNKNOWN IDs.
+*** Parameters: p, q ... properties to compare
+*** Returns:	true if IDs are identical
+**************************************************************************/
+
+static bool SamePropID(const struct Property *p, const struct Property *q)
+{
+	if(p->id != q->id)
+		return false;
+	if(p->id != TKN_UNKNOWN || p->idstr == q->idstr)
+		return true;
+	return !stridcmp(p->idstr, q->idstr);
+}
+
+
 /**************************************************************************
 *** Function:	CheckDoubleProp
 ***				Checks uniqueness of properties within a node
@@ -528,8 +670,7 @@ static void CheckDoubleProp(struct SGFInfo *sgfc, struct Node *n)
 		q = p->next;
 		while(q)
 		{
-			/* ID's identical? stridcmp() for TKN_UNKNOWN */
-			if(p->id == q->id && !stridcmp(p->idstr, q->idstr))
+			if(SamePropID(p, q))
 			{
 				if(p->flags & DOUBLE_MERGE)
 				{
@@ -538,7 +679,7 @@ static void CheckDoubleProp(struct SGFInfo *sgfc, struct Node *n)
 						q = q->next;
 						continue;
 					}
-					PrintError(E_DOUBLE_PROP, sgfc, q->row, q->col, q->idstr, "values merged");
+					PrintError(E_DOUBLE_PROP, sgfc, q->pos, q->idstr, "values merged");
 					v = p->value;
 					while(v->next)	v = v->next;
 					v->next = q->value;
@@ -548,7 +689,7 @@ static void CheckDoubleProp(struct SGFInfo *sgfc, struct Node *n)
 					q->valend = NULL;
 				}
 				else
-					PrintError(E_DOUBLE_PROP, sgfc, q->row, q->col, q->idstr, "deleted");
+					PrintError(E_DOUBLE_PROP, sgfc, q->pos, q->idstr, "deleted");
 
 				q = DelProperty(n, q);	/* delete double property */
 			}
@@ -587,23 +728,22 @@ static void MergeDoubleText(struct SGFInfo *sgfc, struct Node *n)
 		while(q)
 		{
 			if(!(q->flags & PVT_TEXT) || !(q->flags & DOUBLE_MERGE) ||
-				!(p->id == q->id) || stridcmp(p->idstr, q->idstr))
+				!SamePropID(p, q))
 			{
 				q = q->next;
 				continue;
 			}
-			PrintError(E_DOUBLE_PROP, sgfc, q->row, q->col, q->idstr, "values merged");
+			PrintError(E_DOUBLE_PROP, sgfc, q->pos, q->idstr, "values merged");
 			/* single values are merged to one value */
 			v = p->value;
 			w = q->value;
 
-			c = SaveMalloc(v->value_len + w->value_len + 3, "new property value");
+			c = ArenaAllocString(sgfc, v->value_len + w->value_len + 3);
 			memcpy(c, v->value, v->value_len);
 			c[v->value_len]   = '\n';
 			c[v->value_len+1] = '\n';
 			memcpy(c+v->value_len+2, w->value, w->value_len+1);
 			*(c + v->value_len + w->value_len + 2) = 0;
-			free(v->value);		/* free old buffer */
 			v->value = c;
 			v->value_len = v->value_len + w->value_len + 2;
 			q = DelProperty(n, q);	/* delete double property */
@@ -638,6 +778,7 @@ static bool GetNumber(struct SGFInfo *sgfc, struct Node *n, struct Property *p,
 		return true;
 	}
 
+	OwnPropValue(sgfc, p->value);
 	if(value == 2)
 	{
 		v = p->value->value2;
@@ -651,17 +792,17 @@ static bool GetNumber(struct SGFInfo *sgfc, struct Node *n, struct Property *p,
 
 	switch(Parse_Number(v, v_len))
 	{
-		case 0: PrintError(E_BAD_ROOT_PROP, sgfc, p->value->row, p->value->col, p->idstr, err_action);
+		case 0: PrintError(E_BAD_ROOT_PROP, sgfc, p->value->pos, p->idstr, err_action);
 				*d = def;
 				DelProperty(n, p);
 				return false;
 
-		case -1: PrintError(E_BAD_VALUE_CORRECTED, sgfc, p->value->row, p->value->col,
+		case -1: PrintError(E_BAD_VALUE_CORRECTED, sgfc, p->value->pos,
 					  		p->value->value, p->idstr, v);
 		case 1:	*d = atoi(v);
 				if(*d < 1)
 				{
-					PrintError(E_BAD_ROOT_PROP, sgfc, p->value->row, p->value->col, p->idstr, err_action);
+					PrintError(E_BAD_ROOT_PROP, sgfc, p->value->pos, p->idstr, err_action);
 					*d = def;
 					DelProperty(n, p);
 					return false;
@@ -690,6 +831,10 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 	ti->GM = 0;
 	ti->bwidth = ti->bheight = 0;
 	ti->root = r;
+	ti->source = NULL;
+	ti->source_len = 0;
+	ti->source_hash = 0;
+	ti->modified = true;
 	if(sgfc->last)
 		ti->num = sgfc->last->num + 1;
 	else
@@ -700,7 +845,7 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 		ff = NULL;
 
 	if(ti->FF > 4)
-		PrintError(E_UNKNOWN_FILE_FORMAT, sgfc, ff->value->row, ff->value->col, ti->FF);
+		PrintError(E_UNKNOWN_FILE_FORMAT, sgfc, ff->value->pos, ti->FF);
 
 	ca = FindProperty(r, TKN_CA);
 	if(ca && !Check_Value(sgfc, ca, ca->value, ca->flags, Parse_Charset))
@@ -716,7 +861,7 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 
 	if(ti->GM != 1)
 	{
-		PrintError(WCS_GAME_NOT_GO, sgfc, gm->row, gm->col, ti->num);
+		PrintError(WCS_GAME_NOT_GO, sgfc, gm->pos, ti->num);
 		return true;		/* board size only of interest if Game == Go */
 	}
 
@@ -735,7 +880,7 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 	}
 
 	if(ti->FF < 4 && (ti->bwidth > 19 || sz->value->value2))
-		PrintError(E_VERSION_CONFLICT, sgfc, sz->row, sz->col, ti->FF);
+		PrintError(E_VERSION_CONFLICT, sgfc, sz->pos, ti->FF);
 
 	if(sz->value->value2)	/* rectangular board? */
 	{
@@ -745,9 +890,9 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 		{
 			if(ti->bwidth == ti->bheight)
 			{
-				PrintError(E_SQUARE_AS_RECTANGULAR, sgfc, sz->row, sz->col);
-				free(sz->value->value2);
+				PrintError(E_SQUARE_AS_RECTANGULAR, sgfc, sz->pos);
 				sz->value->value2 = NULL;
+				sz->value->value2_len = 0;
 			}
 		}
 	}
@@ -756,6 +901,7 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 
 	if(ti->bheight > 52 || ti->bwidth > 52)	/* board too big? */
 	{
+		OwnPropValue(sgfc, sz->value);
 		if(ti->bwidth > 52)
 		{
 			ti->bwidth = 52;
@@ -775,11 +921,11 @@ static bool InitTreeInfo(struct SGFInfo *sgfc, struct TreeInfo *ti, struct Node
 
 		if(ti->bwidth == ti->bheight && sz->value->value2)
 		{
-			free(sz->value->value2);
 			sz->value->value2 = NULL;
+			sz->value->value2_len = 0;
 		}
 
-		PrintError(E_BOARD_TOO_BIG, sgfc, sz->row, sz->col, ti->bwidth, ti->bheight);
+		PrintError(E_BOARD_TOO_BIG, sgfc, sz->pos, ti->bwidth, ti->bheight);
 	}
 
 	return true;
@@ -797,6 +943,7 @@ bool InitAllTreeInfo(struct SGFInfo *sgfc)
 {
 	struct Node *root = sgfc->first;
 	struct TreeInfo *ti;
+	struct SourceTree *src = sgfc->_source, *src_end = src + sgfc->_num_source;
 
 	if(!root)							/* safe guard */
 	{
@@ -806,9 +953,16 @@ bool InitAllTreeInfo(struct SGFInfo *sgfc)
 
 	for(; root; root = root->sibling)
 	{
-		ti = SaveMalloc(sizeof(struct TreeInfo), "tree info structure");
+		ti = SaveMalloc(sgfc, sizeof(struct TreeInfo), "tree info structure");
 		if(!InitTreeInfo(sgfc, ti, root))
 			return false;
+		if(src < src_end && src->root == root)	/* same order as root nodes */
+		{
+			ti->source = src->start;
+			ti->source_len = src->len;
+			ti->source_hash = src->hash;
+			src++;
+		}
 		AddTail(&sgfc->tree, ti);		/* add to SGFInfo */
 	}
 
@@ -828,14 +982,14 @@ static bool CheckDifferingRootProperties(struct SGFInfo *sgfc)
 {
 	struct TreeInfo *ti = sgfc->tree->next;
 	struct Property *gm, *ff, *ca;
-	U_LONG row, col;
+	U_LONG pos;
 	const char *first_encoding = sgfc->tree->encoding_name;
 
 	if(sgfc->options->encoding == OPTION_ENCODING_EVERYTHING &&
 	   strnccmp(first_encoding, sgfc->global_encoding_name, 0))
 	{
 		/* Detection picked up wrong encoding; oh dear! */
-		PrintError(FE_WRONG_ENCODING, sgfc, sgfc->tree->root->row, sgfc->tree->root->col);
+		PrintError(FE_WRONG_ENCODING, sgfc, sgfc->tree->root->pos);
 		return false;
 	}
 
@@ -847,109 +1001,141 @@ static bool CheckDifferingRootProperties(struct SGFInfo *sgfc)
 
 		if(ti->prev->FF != ti->FF)
 		{
-			if(ff)	{ row = ff->row;		col = ff->col; }
-			else	{ row = ti->root->row;	col = ti->root->col; }
-
-			PrintError(WS_FF_DIFFERS, sgfc, row, col);
+			pos = ff ? ff->pos : ti->root->pos;
+			PrintError(WS_FF_DIFFERS, sgfc, pos);
 		}
 
 		if(ti->prev->GM != ti->GM)
 		{
-			if(gm)	{ row = gm->row;		col = gm->col; }
-			else	{ row = ti->root->row;	col = ti->root->col; }
-
-			PrintError(WS_GM_DIFFERS, sgfc, row, col);
+			pos = gm ? gm->pos : ti->root->pos;
+			PrintError(WS_GM_DIFFERS, sgfc, pos);
 		}
 
-		if(ca)	{ row = ca->row;		col = ca->col; }
-		else	{ row = ti->root->row;	col = ti->root->col; }
+		pos = ca ? ca->pos : ti->root->pos;
 
 		if(sgfc->options->encoding == OPTION_ENCODING_EVERYTHING)
 		{
 			if(strnccmp(ti->encoding_name, first_encoding, 0))
 			{
-				PrintError(E_MULTIPLE_ENCODINGS, sgfc, row, col);
+				PrintError(E_MULTIPLE_ENCODINGS, sgfc, pos);
 				return false;
 			}
 		}
 		else if(strnccmp(ti->prev->encoding_name, ti->encoding_name, 0))
-			PrintError(WS_CA_DIFFERS, sgfc, row, col);
+			PrintError(WS_CA_DIFFERS, sgfc, pos);
 	}
 	return true;
 }
 
 /**************************************************************************
 *** Function:	CheckSGFSubTree
-***				Steps recursive through the SGF tree and
-***				calls Check_Properties for each node
+***				Steps through the SGF tree and calls Check_Properties
+***				for each node. Variations are kept on an explicit stack
+***				instead of recursion. Board and chains are shared:
+***				changes of a variation are undone when it is done.
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				r    ... pointer to root node of current tree
 ***				old  ... board status before parsing root node
 *** Returns:	-
 **************************************************************************/
 
+struct CheckFrame
+{
+	struct Node *r;				/* first node of current variation */
+	struct BoardStatus st;		/* board status within variation */
+	size_t mark;				/* journal entries at start of variation */
+	bool chains_valid;			/* chains->valid at start of variation */
+};
+
 static void CheckSGFSubTree(struct SGFInfo *sgfc, struct Node *r, struct BoardStatus *old)
 {
+	struct CheckFrame *stack = NULL;
+	struct BoardStatus *st, *prev;
+	struct BoardJournal journal = {sgfc, NULL, 0, 0};
 	struct Node *n;
-	unsigned int area;
+	size_t depth = 0, max_depth = 0;
 
-	struct BoardStatus *st = SaveMalloc(sizeof(struct BoardStatus), "board status buffer");
+	stack = GrowStack(sgfc, stack, &max_depth, sizeof(struct CheckFrame));
+	stack[depth++].r = r;
+	n = r;
 
-	while(r)
+	while(depth)
 	{
-		memcpy(st, old, sizeof(struct BoardStatus));
-		area = (unsigned int)(old->bwidth * old->bheight);
-		if(st->board)
-		{
-			st->board = SaveMalloc(sizeof(char) * area, "goban buffer");
-			memcpy(st->board, old->board, area * sizeof(char));
-		}
-		/* path_board is reused (paths marked with different path_num) */
-		/* markup is reused (set to 0 for each new node) */
-		st->markup_changed = true;
+		st = &stack[depth-1].st;
+		r = stack[depth-1].r;
 
-		n = r;
-		while(n)
+		if(n)				/* n == r: start of variation */
 		{
-			st->annotate = 0;
-			if(st->markup_changed && st->markup)
-				memset(st->markup, 0, area * sizeof(U_SHORT));
-			st->markup_changed = false;
+			prev = depth > 1 ? &stack[depth-2].st : old;
+			memcpy(st, prev, sizeof(struct BoardStatus));
+			if(st->board)		/* main line of tree needs no undo */
+			{
+				st->journal = depth > 1 ? &journal : NULL;
+				stack[depth-1].mark = journal.num;
+				stack[depth-1].chains_valid = st->chains && st->chains->valid;
+			}
 
-			if(n->sibling && n != r)		/* for n=r loop is done outside */
+			while(n)
 			{
-				CheckSGFSubTree(sgfc, n, st);
-				break;						/* did complete subtree -> break */
+				st->annotate = 0;
+				if(st->markup)			/* markup is reused (cleared for each node) */
+					ClearMarkup(st);
+
+				if(n->sibling && n != r)		/* for n=r loop is done below */
+				{
+					if(depth == max_depth)
+						stack = GrowStack(sgfc, stack, &max_depth, sizeof(struct CheckFrame));
+					stack[depth++].r = n;		/* do complete subtree first */
+					break;
+				}
+
+				CheckDoubleProp(sgfc, n);		/* remove/merge double properties */
+				Check_Properties(sgfc, n, st);	/* perform checks, update board status */
+				/* MergeDoubleText() needs to be after Check_Properties(), because
+				 * depending on OPTION_ENCODING, the decoding step only occurs in
+				 * Check_Properties() and merging unknown character encodings is
+				 * deemed to dangerous -> after decoding we have UTF-8, which is safe */
+				MergeDoubleText(sgfc, n);
+				n->hash = st->hash;
+				if(SplitMoveSetup(sgfc, n))
+				{
+					n->hash = st->setup_hash;	/* setup part only */
+					n = n->child;				/* new child node already parsed */
+					n->hash = st->hash;
+				}
+
+				n = n->child;
 			}
 
-			CheckDoubleProp(sgfc, n);		/* remove/merge double properties */
-			Check_Properties(sgfc, n, st);	/* perform checks, update board status */
-			/* MergeDoubleText() needs to be after Check_Properties(), because
-			 * depending on OPTION_ENCODING, the decoding step only occurs in
-			 * Check_Properties() and merging unknown character encodings is
-			 * deemed to dangerous -> after decoding we have UTF-8, which is safe */
-			MergeDoubleText(sgfc, n);
-			if(SplitMoveSetup(sgfc, n))
-				n = n->child;				/* new child node already parsed */
-
-			n = n->child;
+			if(n)							/* subtree pushed */
+				continue;
 		}
 
-		if(st->board)
-			free(st->board);
-		if(!r->parent)
-			break;
-		r = r->sibling;
+		/* variation (including subtrees) done -> next sibling */
+		if(st->journal)
+		{
+			UndoBoard(st, stack[depth-1].mark);
+			if(st->chains)
+				st->chains->valid = stack[depth-1].chains_valid;
+		}
+		if(r->parent && r->sibling)
+		{
+			stack[depth-1].r = r->sibling;
+			n = r->sibling;
+		}
+		else
+			depth--;
 	}
 
-	free(st);
+	free(journal.undo);
+	free(stack);
 }
 
 
 /**************************************************************************
 *** Function:	CheckSGFTree
-***				Steps recursive through the SGF tree and
-***				calls CheckSGFSubTree for each root node
+***				Checks a single game tree (calls CheckSGFSubTree
+***				with an empty board status)
 *** Parameters: sgfc ... pointer to SGFInfo structure
 ***				ti   ... pointer to TreeInfo structure
 *** Returns:	-
@@ -959,33 +1145,168 @@ static void CheckSGFTree(struct SGFInfo *sgfc, struct TreeInfo *ti)
 {
 	unsigned int area;
 
-	struct BoardStatus *st = SaveMalloc(sizeof(struct BoardStatus), "board status buffer");
+	struct BoardStatus *st = SaveCalloc(sgfc, sizeof(struct BoardStatus), "board status buffer");
+
+	sgfc->info = ti;
+	st->bwidth = ti->bwidth;
+	st->bheight = ti->bheight;
+	area = (unsigned int)(st->bwidth * st->bheight);
+	if(area)
+	{
+		st->board = SaveCalloc(sgfc, area * sizeof(char), "goban buffer");
+		st->markup = SaveCalloc(sgfc, area * sizeof(U_SHORT), "markup buffer");
+		st->markup_list = SaveCalloc(sgfc, sizeof(struct MarkupList) + area * sizeof(U_SHORT),
+									 "markup list buffer");
+		if(st->bwidth <= MAX_BITBOARD_SIZE && st->bheight <= MAX_BITBOARD_SIZE)
+			st->bits = SetupBitBoard(sgfc, st->bwidth, st->bheight);
+		else
+			st->chains = SetupChainBoard(sgfc, area);
+	}
+
+	DecodeTreeTexts(sgfc, ti);
+	CheckSGFSubTree(sgfc, ti->root, st);
+	FreeTreeTexts(sgfc);
+
+	if(st->board)	free(st->board);
+	if(st->markup)	free(st->markup);
+	if(st->markup_list)	free(st->markup_list);
+	if(st->chains)	free(st->chains);
+	if(st->bits)	free(st->bits);
+	free(st);
+}
+
+
+/* Parallel mode: game trees are checked by jobs, each of which takes
+** a consecutive range of trees and uses its own worker SGFInfo.
+** Messages are merged in order of the trees. */
+
+#define CHECK_JOBS_PER_THREAD	8
+
+struct CheckTree
+{
+	struct TreeInfo *ti;
+	U_LONG pos;				/* first buffer position of tree */
+	U_LONG row, col;		/* row & column of pos */
+};
+
+struct ParallelCheck
+{
+	struct SGFInfo *sgfc;
+	struct CheckTree *trees;
+	size_t num_trees;
+	size_t num_jobs;
+	struct SGFInfo **workers;
+};
+
 
-	while(ti)
+/**************************************************************************
+*** Function:	CheckTreesJob
+***				Checks a range of game trees (job of RunWorkers())
+*** Parameters: data ... pointer to ParallelCheck
+***				i	 ... number of job
+*** Returns:	-
+**************************************************************************/
+
+static void CheckTreesJob(void *data, size_t i)
+{
+	struct ParallelCheck *pc = data;
+	struct SGFInfo *worker = SetupWorkerSGFInfo(pc->sgfc);
+	size_t t = i * pc->num_trees / pc->num_jobs;
+	size_t end = (i + 1) * pc->num_trees / pc->num_jobs;
+
+	pc->workers[i] = worker;
+	for(; t < end; t++)
 	{
-		sgfc->info = ti;
-		memset(st, 0, sizeof(struct BoardStatus));
-		st->bwidth = sgfc->info->bwidth;
-		st->bheight = sgfc->info->bheight;
-		area = (unsigned int)(st->bwidth * st->bheight);
-		if(area)
+		struct TreeInfo *ti = pc->trees[t].ti;
+		iconv_t shared = ti->encoding, own = (iconv_t)-1;
+
+		/* iconv descriptors are shared by trees: use one of the worker */
+		if(worker->options->encoding == OPTION_ENCODING_TEXT_ONLY && shared)
+			own = AcquireIConV(worker, ti->encoding_name);
+		if(own != (iconv_t)-1)
+			ti->encoding = own;
+
+		SetupPosIndexAt(worker, pc->sgfc, pc->trees[t].pos, pc->trees[t].row, pc->trees[t].col);
+		CheckSGFTree(worker, ti);
+
+		if(own != (iconv_t)-1)
 		{
-			st->board = SaveCalloc(area * sizeof(char), "goban buffer");
-			st->markup = SaveMalloc(area * sizeof(U_SHORT), "markup buffer");
-			st->paths = SaveCalloc(sizeof(struct PathBoard), "path_board buffer");
+			ReleaseIConV(worker, own);
+			ti->encoding = shared;
 		}
-		st->markup_changed = true;
+	}
+	PrintError(E_NO_ERROR, worker);		/* flush accumulated messages */
+}
+
 
-		CheckSGFSubTree(sgfc, ti->root, st);
+/**************************************************************************
+*** Function:	CheckTreesParallel
+***				Parallel mode: checks all game trees using worker threads
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	true if trees have been checked, false if there's
+***				nothing to be gained (caller checks them sequentially)
+**************************************************************************/
 
-		ti = ti->next;
+static bool CheckTreesParallel(struct SGFInfo *sgfc)
+{
+	struct ParallelCheck pc;
+	struct TreeInfo *ti;
+	struct Property *p;
+	size_t i, threads = NumWorkerThreads(sgfc);
 
-		if(st->board)	free(st->board);
-		if(st->markup)	free(st->markup);
-		if(st->paths)	free(st->paths);
+	/* interactive mode asks questions: not from within worker threads */
+	if(threads < 2 || sgfc->options->interactive)
+		return false;
+
+	pc.num_trees = 0;
+	for(ti = sgfc->tree; ti; ti = ti->next)
+		pc.num_trees++;
+	if(pc.num_trees < 2)
+		return false;
+
+	pc.sgfc = sgfc;
+	pc.trees = SaveMalloc(sgfc, pc.num_trees * sizeof(struct CheckTree), "tree list");
+	pc.num_jobs = threads * CHECK_JOBS_PER_THREAD;
+	if(pc.num_jobs > pc.num_trees)
+		pc.num_jobs = pc.num_trees;
+	pc.workers = SaveCalloc(sgfc, pc.num_jobs * sizeof(struct SGFInfo *), "worker list");
+
+	for(i = 0, ti = sgfc->tree; ti; ti = ti->next, i++)
+	{
+		/* IDs with lowercase letters may start in front of root node */
+		pc.trees[i].ti = ti;
+		pc.trees[i].pos = ti->root->pos;
+		for(p = ti->root->prop; p; p = p->next)
+			if(p->pos && (!pc.trees[i].pos || p->pos < pc.trees[i].pos))
+				pc.trees[i].pos = p->pos;
+		ResolvePosition(sgfc, pc.trees[i].pos, &pc.trees[i].row, &pc.trees[i].col);
 	}
 
-	free(st);
+	RunWorkers(sgfc, pc.num_jobs, CheckTreesJob, &pc);
+
+	for(i = 0; i < pc.num_jobs; i++)
+		MergeWorkerSGFInfo(sgfc, pc.workers[i], 1, 1);
+	sgfc->info = sgfc->last;
+
+	free(pc.workers);
+	free(pc.trees);
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	MarkModifiedTrees
+***				Determines for each game tree whether ParseSGF changed
+***				any node, property or value since loading
+***				(option verbatim only)
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+static void MarkModifiedTrees(struct SGFInfo *sgfc)
+{
+	for(struct TreeInfo *ti = sgfc->tree; ti; ti = ti->next)
+		ti->modified = !ti->source || HashGameTree(ti->root) != ti->source_hash;
 }
 
 
@@ -1001,7 +1322,9 @@ bool ParseSGF(struct SGFInfo *sgfc)
 	if(!InitAllTreeInfo(sgfc))
 		return false;
 
-	CheckSGFTree(sgfc, sgfc->tree);
+	if(!sgfc->options->parallel || !CheckTreesParallel(sgfc))
+		for(struct TreeInfo *ti = sgfc->tree; ti; ti = ti->next)
+			CheckSGFTree(sgfc, ti);
 
 	if(!CheckDifferingRootProperties(sgfc))
 		return false;
@@ -1018,5 +1341,8 @@ bool ParseSGF(struct SGFInfo *sgfc)
 	if(sgfc->options->strict_checking)
 		StrictChecking(sgfc);
 
+	if(sgfc->options->verbatim)
+		MarkModifiedTrees(sgfc);
+
 	return true;
 }
@@ -7,6 +7,11 @@
 ***
 **************************************************************************/
 
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "all.h"
 #include "protos.h"
 
@@ -43,7 +48,8 @@ static bool Check_Charset(struct SGFInfo *sgfc, struct Property *p, struct PropV
 
 static bool Check_Empty(struct SGFInfo *sgfc, struct Property *p, struct PropValue *v)
 {
-	PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->row, v->col, v->value, p->idstr, "");
+	PrintError(E_BAD_VALUE_CORRECTED, sgfc, v->pos, v->value, p->idstr, "");
+	OwnPropValue(sgfc, v);
 	v->value[0] = 0;
 	v->value_len = 0;
 	return true;
@@ -165,3 +171,76 @@ const struct SGFToken sgf_token[NUM_SGF_TOKENS] =
 
 	{ NULL,	0,	0,		NULL,			NULL,	0, 0 }
 };
+
+
+/* Direct-index table for property IDs of one or two uppercase letters.
+** Index is calculated by TI(); entries of unknown IDs are 0 == TKN_UNKNOWN.
+** Built from sgf_token[] once by SetupTokenIndex(). */
+
+#define TI(a,b)	(((a)-'A')*27 + ((b) ? (b)-'A'+1 : 0))
+
+static U_CHAR sgf_token_index[26*27];
+#ifdef HAVE_PTHREAD
+static pthread_once_t sgf_token_index_once = PTHREAD_ONCE_INIT;
+#else
+static bool sgf_token_index_built = false;
+#endif
+
+
+static void BuildTokenIndex(void)
+{
+	const char *id;
+	int i;
+
+	for(i = 1; sgf_token[i].id; i++)
+	{
+		id = sgf_token[i].id;
+		if(id[0] < 'A' || id[0] > 'Z' || (id[1] && (id[1] < 'A' || id[1] > 'Z' || id[2])))
+			continue;			/* not reachable by LookupToken() */
+		if(!sgf_token_index[TI(id[0], id[1])])	/* first entry wins (as linear search) */
+			sgf_token_index[TI(id[0], id[1])] = (U_CHAR)i;
+	}
+}
+
+
+/**************************************************************************
+*** Function:	SetupTokenIndex
+***				Builds the lookup table of LookupToken() from sgf_token[]
+***				(only the first call does; safe to call from any thread).
+***				Without pthreads the first call must be made before
+***				starting threads. Called by SetupSGFInfo().
+*** Parameters: -
+*** Returns:	-
+**************************************************************************/
+
+void SetupTokenIndex(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_once(&sgf_token_index_once, BuildTokenIndex);
+#else
+	if(!sgf_token_index_built)
+	{
+		BuildTokenIndex();
+		sgf_token_index_built = true;
+	}
+#endif
+}
+
+
+/**************************************************************************
+*** Function:	LookupToken
+***				Finds the token for a property ID
+*** Parameters: id ... property ID (uppercase letters only, \0 terminated)
+*** Returns:	token or TKN_UNKNOWN if ID isn't known
+**************************************************************************/
+
+token LookupToken(const char *id)
+{
+	if(id[0] < 'A' || id[0] > 'Z')
+		return TKN_UNKNOWN;
+	if(!id[1])
+		return (token)sgf_token_index[TI(id[0], 0)];
+	if(id[1] < 'A' || id[1] > 'Z' || id[2])
+		return TKN_UNKNOWN;
+	return (token)sgf_token_index[TI(id[0], id[1])];
+}
@@ -13,27 +13,55 @@
 /**** options.c ****/
 
 void PrintHelp(enum option_help);
-void PrintStatusLine(const struct SGFInfo *);
-void PrintGameSignatures(const struct SGFInfo *);
+void PrintStatusLine(const struct SGFInfo *, FILE *);
+void PrintGameSignatures(const struct SGFInfo *, FILE *);
+void PrintPositionHashes(const struct SGFInfo *, FILE *);
 bool ParseArgs(struct SGFInfo *, int, const char *[]);
 struct SGFCOptions *SGFCDefaultOptions(void);
 
 struct SGFInfo *SetupSGFInfo(struct SGFCOptions *);
+void ResetSGFInfo(struct SGFInfo *);
 void FreeSGFInfo(struct SGFInfo *);
 
 
+/**** workers.c ****/
+
+int RunBatch(struct SGFInfo *, FILE *);
+size_t NumWorkerThreads(const struct SGFInfo *);
+void RunWorkers(struct SGFInfo *, size_t, void (*)(void *, size_t), void *);
+struct SGFInfo *SetupWorkerSGFInfo(struct SGFInfo *);
+void MergeWorkerSGFInfo(struct SGFInfo *, struct SGFInfo *, U_LONG, U_LONG);
+void FreeWorkerSGFInfo(struct SGFInfo *);
+
+
 /**** load.c ****/
 
+bool ReadSGFFile(struct SGFInfo *, const char *);
 bool LoadSGF(struct SGFInfo *, const char *);
 bool LoadSGFFromFileBuffer(struct SGFInfo *);
+void FreeSGFBuffer(struct SGFInfo *);
+void ResolvePosition(struct SGFInfo *, U_LONG, U_LONG *, U_LONG *);
+void SetupPosIndexAt(struct SGFInfo *, const struct SGFInfo *, U_LONG, U_LONG, U_LONG);
+
+
+/**** snapshot.c ****/
+
+bool SaveSnapshot(struct SGFInfo *, const char *);
+bool LoadSnapshot(struct SGFInfo *, const char *);
 
 
 /**** encoding.c ****/
 
-char *DetectEncoding(const char *, const char *);
+char *DetectEncoding(struct SGFInfo *, const char *, const char *);
 char *DecodeSGFBuffer(struct SGFInfo *, const char **, char **);
 char *DecodeBuffer(struct SGFInfo *, iconv_t, char *, size_t, U_LONG, const char **);
+char *DecodeSegments(struct SGFInfo *, iconv_t, struct DecodeSegment *, size_t, size_t *);
 iconv_t OpenIconV(struct SGFInfo *, const char *, const char **);
+struct IConvCache *SetupIConvCache(struct SGFInfo *);
+void ShareIConvCache(struct SGFInfo *, struct IConvCache *);
+void FreeIConvCache(struct IConvCache *);
+iconv_t AcquireIConV(struct SGFInfo *, const char *);
+void ReleaseIConV(struct SGFInfo *, iconv_t);
 
 /**** save.c ****/
 
@@ -46,12 +74,16 @@ struct SaveFileHandler *SetupSaveBufferIO(
 		int (*)(struct SaveFileHandler *, U_LONG));
 
 bool SaveSGF(struct SGFInfo *, struct SaveFileHandler *(*)(void), const char *);
+bool SaveSGFToBuffer(struct SGFInfo *, char *, size_t, size_t *);
 
 
 /**** properties.c ****/
 
 extern const struct SGFToken sgf_token[];
 
+void SetupTokenIndex(void);
+token LookupToken(const char *);
+
 
 /**** parse.c ****/
 
@@ -64,6 +96,8 @@ int Parse_Charset(char *, size_t *, ...);
 
 int Parse_Float_Offset(char *, size_t *, size_t);
 int Parse_Text(struct SGFInfo *, struct PropValue *, int prop_num, U_SHORT flags);
+void DecodeTreeTexts(struct SGFInfo *, struct TreeInfo *);
+void FreeTreeTexts(struct SGFInfo *);
 
 bool Check_Value(struct SGFInfo *, struct Property *, struct PropValue *,
 				U_SHORT, int (*)(char *, size_t *, ...));
@@ -87,8 +121,20 @@ bool InitAllTreeInfo(struct SGFInfo *);
 bool ParseSGF(struct SGFInfo *);
 
 
+/**** bitboard.c ****/
+
+struct BitBoard *SetupBitBoard(struct SGFInfo *, int, int);
+void SetBitBoard(struct BitBoard *, int, unsigned char);
+int CaptureBits(struct BitBoard *, int, unsigned char, int *);
+
+
 /**** execute.c ****/
 
+uint64_t ZobristKey(int, unsigned char);
+struct ChainBoard *SetupChainBoard(struct SGFInfo *, size_t);
+void UndoBoard(struct BoardStatus *, size_t);
+void ClearMarkup(struct BoardStatus *);
+
 bool Do_Move(struct SGFInfo *, struct Node *, struct Property *, struct BoardStatus *);
 bool Do_AddStones(struct SGFInfo *, struct Node *, struct Property *, struct BoardStatus *);
 bool Do_Letter(struct SGFInfo *, struct Node *, struct Property *, struct BoardStatus *);
@@ -107,16 +153,13 @@ bool Check_GameInfo(struct SGFInfo *, struct Property *, struct PropValue *);
 
 /**** error.c ****/
 
-struct ErrorC_internal *SetupErrorC_internal(void);
+struct ErrorC_internal *SetupErrorC_internal(struct SGFInfo *);
 
-extern bool (*print_error_handler)(U_LONG, struct SGFInfo *, va_list);
-extern void (*print_error_output_hook)(struct SGFCError *);
-extern void (*oom_panic_hook)(const char *);
 
 int PrintError(U_LONG, struct SGFInfo *, ...);
-void ExitWithOOMError(const char *);
+void ExitWithOOMError(struct SGFInfo *, const char *);
 bool PrintErrorHandler(U_LONG, struct SGFInfo *, va_list);
-void PrintErrorOutputHook(struct SGFCError *);
+void PrintErrorOutputHook(struct SGFInfo *, struct SGFCError *);
 void CommonPrintErrorOutputHook(struct SGFCError *, FILE *);
 
 
@@ -129,9 +172,20 @@ void f_AddTail(struct ListHead *, struct ListNode *);
 void f_Enqueue(struct ListHead *, struct ListNode *);
 void f_Delete(struct ListHead *, struct ListNode *);
 
-char *SaveDupString(const char *, size_t, const char *);
-void *SaveMalloc(size_t , const char *);
-void *SaveCalloc(size_t , const char *);
+void OutOfMemory(struct SGFInfo *, const char *);
+char *SaveDupString(struct SGFInfo *, const char *, size_t, const char *);
+void *SaveMalloc(struct SGFInfo *, size_t , const char *);
+void *SaveCalloc(struct SGFInfo *, size_t , const char *);
+void *SaveRealloc(struct SGFInfo *, void *, size_t , const char *);
+void *GrowStack(struct SGFInfo *, void *, size_t *, size_t);
+
+struct MemArena *SetupMemArena(struct SGFInfo *);
+void ResetMemArena(struct MemArena *);
+void FreeMemArena(struct MemArena *);
+void MergeMemArena(struct MemArena *, struct MemArena *);
+void *ArenaAlloc(struct SGFInfo *, size_t);
+char *ArenaAllocString(struct SGFInfo *, size_t);
+char *ArenaDupString(struct SGFInfo *, const char *, size_t);
 
 bool strnccmp(const char *, const char *, size_t);
 bool stridcmp(const char *, const char *);
@@ -140,16 +194,22 @@ U_LONG KillChars(char *, size_t *, U_SHORT, const char *);
 U_LONG TestChars(const char *, U_SHORT, const char *);
 
 struct Property *FindProperty(struct Node *, token);
-struct Property *AddProperty(struct Node *, token, U_LONG, U_LONG, const char *);
+void FreeIDTable(struct SGFInfo *);
+const char *InternPropID(struct SGFInfo *, token, const char *);
+struct Property *AddProperty(struct SGFInfo *, struct Node *, token, U_LONG, const char *);
 struct Property *DelProperty(struct Node *, struct Property *);
-struct PropValue *AddPropValue(struct SGFInfo *, struct Property *, U_LONG, U_LONG,
+char *DupValueString(struct SGFInfo *, const char *, size_t);
+bool IsBufferSlice(struct SGFInfo *, const char *);
+void OwnPropValue(struct SGFInfo *, struct PropValue *);
+struct PropValue *AddPropValue(struct SGFInfo *, struct Property *, U_LONG,
 							   const char *, size_t, const char *, size_t);
 struct Property *NewPropValue(struct SGFInfo *, struct Node *, token, const char *, const char *, bool);
 struct PropValue *DelPropValue(struct Property *, struct PropValue *);
-struct Node *NewNode(struct SGFInfo *, struct Node *, U_LONG, U_LONG, bool);
+struct Node *NewNode(struct SGFInfo *, struct Node *, U_LONG, bool);
 void DelNode(struct SGFInfo *, struct Node *, U_LONG);
 
 bool CalcGameSig(struct TreeInfo *, char *);
+unsigned long long HashGameTree(struct Node *);
 
 
 /**** strict.c ****/
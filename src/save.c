@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <errno.h>
 
 #include "all.h"
 #include "protos.h"
@@ -26,6 +27,9 @@
  * them per line, just like we would get without this option set. */
 #define	MAX_PREDICTED_LINELEN	60
 
+/* output is collected in SaveInfo and handed to SaveFileHandler->write() in blocks */
+#define SAVE_BUFFER_SIZE	4096
+
 #define saveputc(s,c) { if(!WriteChar((s), (c), false))	return false;	}
 
 #define CheckLineLen(s) { if((s)->linelen > MAX_LINELEN) \
@@ -42,6 +46,12 @@ struct SaveInfo
 	int chars_in_node;
 	int eol_in_node;
 	bool gi_written;	/* used by WriteProperty for newlines after gameinfo properties */
+	bool split;			/* one file per game tree (see WriteSGFFile) */
+	bool prepared;		/* root props & point lists are final (see MeasureSGFFile) */
+	bool copy_unlabeled;	/* trees without CA[UTF-8] may be copied (see IsVerbatimTree) */
+
+	size_t out_len;		/* bytes in out[] not yet written (see FlushSaveBuffer) */
+	char out[SAVE_BUFFER_SIZE];
 };
 
 
@@ -67,17 +77,20 @@ static int SaveFileIO_close(struct SaveFileHandler *sfh, U_LONG error)
 	return fclose(file);
 }
 
-static int SaveFileIO_putc(struct SaveFileHandler *sfh, int c)
+static int SaveFileIO_write(struct SaveFileHandler *sfh, const char *buffer, size_t len)
 {
-	return fputc(c, sfh->fh.file);
+	return fwrite(buffer, 1, len, sfh->fh.file) == len;
 }
 
 struct SaveFileHandler *SetupSaveFileIO(void)
 {
-	struct SaveFileHandler *sfh = SaveMalloc(sizeof(struct SaveFileHandler), "file handler");
+	struct SaveFileHandler *sfh = SaveMalloc(NULL, sizeof(struct SaveFileHandler), "file handler");
 	sfh->open = SaveFileIO_open;
 	sfh->close = SaveFileIO_close;
-	sfh->putc = SaveFileIO_putc;
+	sfh->putc = NULL;				/* block handler */
+	sfh->write = SaveFileIO_write;
+	sfh->exact_size = false;
+	sfh->size_hint = 0;
 	sfh->fh.file = NULL;
 	return sfh;
 }
@@ -86,7 +99,8 @@ struct SaveFileHandler *SetupSaveFileIO(void)
 /**************************************************************************
 *** Function:	SaveBufferIO_open
 ***				Initializes SaveBuffer structure for saving to memory
-***             Allocates 5000 bytes as initial value
+***				Allocates size_hint bytes (+1 for \0 termination)
+***				or 5000 bytes as initial value if size is not known
 *** Parameters: sfh ... pointer to SaveFileHandler
 ***				path, mode ... dummy
 *** Returns:	true on success, false on error (out of memory)
@@ -95,10 +109,12 @@ struct SaveFileHandler *SetupSaveFileIO(void)
 int SaveBufferIO_open(struct SaveFileHandler *sfh, const char *path, const char *mode)
 {
 	/* Start with ~5kb buffer which suffices in many cases */
-	sfh->fh.memh.buffer = (char *)malloc((size_t)5000);
+	size_t size = !sfh->putc && sfh->size_hint ? sfh->size_hint + 1 : 5000;
+
+	sfh->fh.memh.buffer = (char *)malloc(size);
 	if(!sfh->fh.memh.buffer)
 		return false;
-	sfh->fh.memh.buffer_size = 5000;
+	sfh->fh.memh.buffer_size = size;
 	sfh->fh.memh.pos = sfh->fh.memh.buffer;
 	return true;
 }
@@ -124,32 +140,55 @@ int SaveBufferIO_close(struct SaveFileHandler *sfh, U_LONG error)
 
 
 /**************************************************************************
-*** Function:	SaveBufferIO_putc
-***				Writes char to buffer, allocates more memory if current
-***				buffer is too small to hold next char.
+*** Function:	SaveBufferIO_reserve
+***				Makes sure that buffer has room for 'len' more bytes
+***				(and \0 termination). Doubles buffer size as needed.
 *** Parameters: sfh ... pointer to SaveFileHandler
-***				c   ... char to write
-*** Returns:	char written or EOF in case of error
+***				len ... number of bytes to be written
+*** Returns:	true on success, false on error (out of memory)
 **************************************************************************/
 
-static int SaveBufferIO_putc(struct SaveFileHandler *sfh, int c)
+static int SaveBufferIO_reserve(struct SaveFileHandler *sfh, size_t len)
 {
-	/* -1 so that we can always null-terminate buffer in close() function */
-	if (sfh->fh.memh.pos == sfh->fh.memh.buffer + sfh->fh.memh.buffer_size - 1)
-	{
-		/* size*2 ... typical strategy used by ArrayList structures */
-		char *new_buffer = (char *)malloc(sfh->fh.memh.buffer_size*2);
-		if (!new_buffer)
-			return EOF;
-		memcpy(new_buffer, sfh->fh.memh.buffer, sfh->fh.memh.buffer_size);
-		free(sfh->fh.memh.buffer);
-		sfh->fh.memh.buffer = new_buffer;
-		sfh->fh.memh.pos = new_buffer + sfh->fh.memh.buffer_size;
-		sfh->fh.memh.buffer_size *= 2;
-	}
+	size_t used = (size_t)(sfh->fh.memh.pos - sfh->fh.memh.buffer);
+	size_t new_size = sfh->fh.memh.buffer_size;
+
+	/* +1 so that we can always null-terminate buffer in close() function */
+	if(used + len + 1 <= new_size)
+		return true;
+
+	/* size*2 ... typical strategy used by ArrayList structures */
+	while(used + len + 1 > new_size)
+		new_size *= 2;
+	char *new_buffer = (char *)malloc(new_size);
+	if (!new_buffer)
+		return false;
+	memcpy(new_buffer, sfh->fh.memh.buffer, used);
+	free(sfh->fh.memh.buffer);
+	sfh->fh.memh.buffer = new_buffer;
+	sfh->fh.memh.pos = new_buffer + used;
+	sfh->fh.memh.buffer_size = new_size;
+	return true;
+}
 
-	*sfh->fh.memh.pos++ = (char)c;
-	return c;
+
+/**************************************************************************
+*** Function:	SaveBufferIO_write
+***				Writes a block of bytes to buffer, allocates more
+***				memory if current buffer is too small.
+*** Parameters: sfh	   ... pointer to SaveFileHandler
+***				buffer ... bytes to write
+***				len	   ... number of bytes
+*** Returns:	true on success, false on error
+**************************************************************************/
+
+static int SaveBufferIO_write(struct SaveFileHandler *sfh, const char *buffer, size_t len)
+{
+	if(!SaveBufferIO_reserve(sfh, len))
+		return false;
+	memcpy(sfh->fh.memh.pos, buffer, len);
+	sfh->fh.memh.pos += len;
+	return true;
 }
 
 
@@ -164,9 +203,12 @@ struct SaveFileHandler *SetupSaveBufferIO(
 	int (*open)(struct SaveFileHandler *, const char *, const char *),
 	int (*close)(struct SaveFileHandler *, U_LONG))
 {
-	struct SaveFileHandler *sfh = SaveMalloc(sizeof(struct SaveFileHandler), "memory file handler");
+	struct SaveFileHandler *sfh = SaveMalloc(NULL, sizeof(struct SaveFileHandler), "memory file handler");
 	sfh->open = SaveBufferIO_open;
-	sfh->putc = SaveBufferIO_putc;
+	sfh->putc = NULL;				/* block handler */
+	sfh->write = SaveBufferIO_write;
+	sfh->exact_size = false;		/* set to true to allocate buffer only once */
+	sfh->size_hint = 0;
 	if(open)	sfh->open = open;
 	else		sfh->open = SaveBufferIO_open;
 	if(close)	sfh->close = close;
@@ -178,6 +220,68 @@ struct SaveFileHandler *SetupSaveBufferIO(
 }
 
 
+/**************************************************************************
+*** Function:	SaveOutput
+***				Hands bytes to the SaveFileHandler; uses putc() if
+***				set, write() otherwise (block handler, see all.h)
+*** Parameters: sfh	   ... pointer to SaveFileHandler
+***				buffer ... bytes to write
+***				len	   ... number of bytes
+*** Returns:	true or false
+**************************************************************************/
+
+static int SaveOutput(struct SaveFileHandler *sfh, const char *buffer, size_t len)
+{
+	if(!sfh->putc)
+		return !len || (*sfh->write)(sfh, buffer, len);
+
+	for(; len; len--, buffer++)
+		if((*sfh->putc)(sfh, *buffer) == EOF)
+			return false;
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	FlushSaveBuffer
+***				Writes collected output to file
+*** Parameters: save ... pointer to SaveInfo
+*** Returns:	true or false
+**************************************************************************/
+
+static int FlushSaveBuffer(struct SaveInfo *save)
+{
+	size_t len = save->out_len;
+
+	save->out_len = 0;
+	return SaveOutput(save->sfh, save->out, len);
+}
+
+
+/**************************************************************************
+*** Function:	WriteBytes
+***				Adds bytes to the output buffer (no line length accounting)
+*** Parameters: save   ... pointer to SaveInfo
+***				buffer ... bytes to write
+***				len	   ... number of bytes
+*** Returns:	true or false
+**************************************************************************/
+
+static int WriteBytes(struct SaveInfo *save, const char *buffer, size_t len)
+{
+	if(save->out_len + len > SAVE_BUFFER_SIZE)
+	{
+		if(!FlushSaveBuffer(save))
+			return false;
+		if(len > SAVE_BUFFER_SIZE)
+			return SaveOutput(save->sfh, buffer, len);
+	}
+	memcpy(save->out + save->out_len, buffer, len);
+	save->out_len += len;
+	return true;
+}
+
+
 /**************************************************************************
 *** Function:	WriteChar
 ***				Writes char to file, modifies save_linelen
@@ -196,12 +300,14 @@ static int WriteChar(struct SaveInfo *save, char c, U_SHORT spc)
 	if(spc && isspace((unsigned char)c) && (save->linelen >= MAXTEXT_LINELEN))
 		c = '\n';
 
+	if(save->out_len + 2 > SAVE_BUFFER_SIZE)	/* room for EndOfLine */
+		if(!FlushSaveBuffer(save))
+			return false;
+
 	if(c != '\n')
 	{
 		save->linelen++;
-
-		if((*save->sfh->putc)(save->sfh, c) == EOF)
-			return false;
+		save->out[save->out_len++] = c;
 	}
 	else
 	{
@@ -209,13 +315,10 @@ static int WriteChar(struct SaveInfo *save, char c, U_SHORT spc)
 		save->linelen = 0;
 
 #if EOLCHAR
-		if((*save->sfh->putc)(save->sfh, EOLCHAR) == EOF)
-			return false;
+		save->out[save->out_len++] = EOLCHAR;
 #else
-		if((*save->sfh->putc)(save->sfh, '\r') == EOF)		/* MSDOS EndOfLine */
-			return false;
-		if((*save->sfh->putc)(save->sfh, '\n') == EOF)
-			return false;
+		save->out[save->out_len++] = '\r';		/* MSDOS EndOfLine */
+		save->out[save->out_len++] = '\n';
 #endif
 	}
 
@@ -223,6 +326,56 @@ static int WriteChar(struct SaveInfo *save, char c, U_SHORT spc)
 }
 
 
+/**************************************************************************
+*** Function:	WriteRun
+***				Writes a run of chars without linebreaks, modifies
+***				save_linelen (like calling WriteChar for each char)
+*** Parameters: save ... pointer to SaveInfo
+***				s	 ... chars to be written
+***				len	 ... number of chars
+*** Returns:	true or false
+**************************************************************************/
+
+static int WriteRun(struct SaveInfo *save, const char *s, size_t len)
+{
+	save->chars_in_node += (int)len;
+	save->linelen += (int)len;
+	return WriteBytes(save, s, len);
+}
+
+
+/**************************************************************************
+*** Function:	PlainRun
+***				Determines how many chars of a property value can be
+***				written as they are, i.e. chars for which WritePropValue
+***				neither escapes, nor inserts or converts linebreaks.
+***				Line length is projected, so the result is the same as
+***				checking char by char.
+*** Parameters: save  ... pointer to SaveInfo
+***				v	  ... value (\0 terminated)
+***				fl	  ... soft linebreaks are inserted
+***				flags ... property flags
+*** Returns:	number of chars
+**************************************************************************/
+
+static size_t PlainRun(const struct SaveInfo *save, const char *v, bool fl, U_SHORT flags)
+{
+	const char *s = v;
+	int linelen = save->linelen;
+
+	for(; *s; s++, linelen++)
+	{
+		if(*s == '\\' || *s == ']' || *s == '\n' || (flags & PVT_COMPOSE && *s == ':'))
+			break;
+		if(fl && linelen > MAXTEXT_LINELEN && (*s & 0xc0) != 0x80)
+			break;
+		if(flags & PVT_SIMPLE && linelen >= MAXTEXT_LINELEN && isspace((unsigned char)*s))
+			break;
+	}
+	return (size_t)(s - v);
+}
+
+
 /**************************************************************************
 *** Function:	WritePropValue
 ***				Value into the given file
@@ -237,6 +390,7 @@ static int WriteChar(struct SaveInfo *save, char c, U_SHORT spc)
 static int WritePropValue(struct SaveInfo *save, const char *v, bool second, U_SHORT flags)
 {
 	bool fl;
+	size_t run;
 
 	if(!v)	return true;
 
@@ -247,6 +401,14 @@ static int WritePropValue(struct SaveInfo *save, const char *v, bool second, U_S
 
 	while(*v)
 	{
+		if((run = PlainRun(save, v, fl, flags)))
+		{
+			if(!WriteRun(save, v, run))
+				return false;
+			v += run;
+			continue;
+		}
+
 		if(*v == '\\' || *v == ']' || (flags & PVT_COMPOSE && *v == ':'))
 			saveputc(save, '\\')
 
@@ -279,7 +441,7 @@ static int WritePropValue(struct SaveInfo *save, const char *v, bool second, U_S
 static int WriteProperty(struct SaveInfo *save, struct TreeInfo *info, struct Property *prop)
 {
 	struct PropValue *v;
-	char *p;
+	const char *p, *id;
 	bool do_tt;
 
 	if(prop->flags & TYPE_GINFO)
@@ -299,9 +461,12 @@ static int WriteProperty(struct SaveInfo *save, struct TreeInfo *info, struct Pr
 	while(*p)
 	{
 		/* idstr is original from file -> may contain lowercase too */
-		if(isupper((unsigned char)*p))
-			saveputc(save, *p)
-		p++;
+		for(id = p; isupper((unsigned char)*p); p++)
+			;
+		if(p > id && !WriteRun(save, id, (size_t)(p - id)))
+			return false;
+		if(*p)
+			p++;
 	}
 
 	do_tt = (info->GM == 1 && save->sgfc->options->pass_tt &&
@@ -363,7 +528,7 @@ static int WriteNode(struct SaveInfo *save, struct TreeInfo *info, struct Node *
 	while(p)
 	{
 		if((sgf_token[p->id].flags & PVT_CPLIST) && !save->sgfc->options->expand_cpl &&
-		   (info->GM == 1))
+		   (info->GM == 1) && !save->prepared)
 			CompressPointList(save->sgfc, p);
 
 		if(!WriteProperty(save, info, p))
@@ -384,7 +549,8 @@ static int WriteNode(struct SaveInfo *save, struct TreeInfo *info, struct Node *
 
 /**************************************************************************
 *** Function:	SetRootProps
-***				Sets new root properties for the game tree
+***				Sets new root properties for the game tree. The tree
+***				doesn't match its source text any more (option verbatim).
 *** Parameters: sgfc ... pointer to SGFInfo
 ***				info ... TreeInfo
 ***				r	 ... root node of tree
@@ -396,6 +562,7 @@ static void SetRootProps(struct SaveInfo *save, struct TreeInfo *info, struct No
 	if(r->parent)	/* isn't REAL root node */
 		return;
 
+	info->modified = true;
 	NewPropValue(save->sgfc, r, TKN_FF, "4", NULL, true);
 
 	if(save->sgfc->options->encoding != OPTION_ENCODING_NONE)
@@ -415,7 +582,8 @@ static void SetRootProps(struct SaveInfo *save, struct TreeInfo *info, struct No
 
 /**************************************************************************
 *** Function:	WriteTree
-***				recursive function which writes a complete SGF tree
+***				writes a complete SGF tree; variations are kept on an
+***				explicit stack instead of recursion
 *** Parameters: sgfc ... pointer to SGFInfo
 ***				info 	 ... TreeInfo
 ***				n		 ... root node of tree
@@ -423,130 +591,651 @@ static void SetRootProps(struct SaveInfo *save, struct TreeInfo *info, struct No
 *** Returns:	true: success / false error
 **************************************************************************/
 
+struct WriteFrame
+{
+	struct Node *next;		/* next variation to be written */
+	int newlines;			/* newlines of enclosing tree */
+};
+
 static int WriteTree(struct SaveInfo *save, struct TreeInfo *info,
 					 struct Node *n, int newlines)
 {
-	if(newlines && save->linelen > 0)
-		saveputc(save, '\n')
+	struct WriteFrame *stack = NULL;
+	size_t depth = 0, max_depth = 0;
+	int result = false;
 
-	SetRootProps(save, info, n);
+	while(true)
+	{
+		if(n)						/* start of (sub)tree */
+		{
+			if(newlines && save->linelen > 0)
+				if(!WriteChar(save, '\n', false))
+					goto done;
 
-	saveputc(save, '(')
-	if(!WriteNode(save, info, n))
-		return false;
+			if(!save->prepared)
+				SetRootProps(save, info, n);
 
-	n = n->child;
+			if(!WriteChar(save, '(', false) || !WriteNode(save, info, n))
+				goto done;
 
-	while(n)
-	{
-		if(n->sibling)
-		{
-			while(n)					/* write child + variations */
+			n = n->child;
+			while(n && !n->sibling)
 			{
-				if(!WriteTree(save, info, n, 1))
-					return false;
-				n = n->sibling;
+				if(!WriteNode(save, info, n))	/* write child */
+					goto done;
+				n = n->child;
 			}
+
+			if(n)					/* write child + variations */
+			{
+				if(depth == max_depth)
+					stack = GrowStack(save->sgfc, stack, &max_depth, sizeof(struct WriteFrame));
+				stack[depth].next = n->sibling;
+				stack[depth].newlines = newlines;
+				depth++;
+				newlines = 1;
+				continue;
+			}
+		}
+
+		if(!WriteChar(save, ')', false))
+			goto done;
+		if(newlines != 1)
+			if(!WriteChar(save, '\n', false))
+				goto done;
+
+		if(!depth)
+			break;
+
+		n = stack[depth-1].next;
+		if(n)
+		{
+			stack[depth-1].next = n->sibling;
+			newlines = 1;
 		}
 		else
+			newlines = stack[--depth].newlines;
+	}
+	result = true;
+
+done:
+	free(stack);
+	return result;
+}
+
+
+/**************************************************************************
+*** Function:	IsVerbatimTree // CopyUnlabeledTrees
+***				Checks whether a game tree can be copied from the buffer
+***				as it is (option verbatim): it has been loaded without any
+***				message, ParseSGF didn't change it, and SetRootProps()
+***				wouldn't change anything either (except for AP[]).
+***				A plain ASCII tree without CA[UTF-8] is only copied if no
+***				other tree of the same file gets CA[UTF-8] added, as SGFC
+***				couldn't read the file back otherwise.
+*** Parameters: sgfc ... pointer to SGFInfo
+***				info ... TreeInfo of game tree
+***				copy_unlabeled ... trees without CA[UTF-8] may be copied
+***				split ... one file per game tree
+*** Returns:	true or false
+**************************************************************************/
+
+static bool IsVerbatimTree(const struct SGFInfo *sgfc, struct TreeInfo *info, bool copy_unlabeled)
+{
+	struct Property *ca;
+	size_t i;
+
+	if(!sgfc->options->verbatim || info->modified || !info->source || info->FF != 4)
+		return false;
+
+	if(info->GM == 1 && (!FindProperty(info->root, TKN_GM) ||
+	   (info->bwidth == 19 && info->bheight == 19 && !FindProperty(info->root, TKN_SZ))))
+		return false;
+
+	if(sgfc->options->encoding == OPTION_ENCODING_NONE)
+		return true;
+
+	/* text of tree is UTF-8: fine if labeled as such or if it's plain ASCII */
+	ca = FindProperty(info->root, TKN_CA);
+	if(ca && ca->value && !strnccmp(ca->value->value, "UTF-8", 0))
+		return true;
+	if(!copy_unlabeled)
+		return false;
+	for(i = 0; i < info->source_len; i++)
+		if(info->source[i] & 0x80)
+			return false;
+	return true;
+}
+
+static bool CopyUnlabeledTrees(const struct SGFInfo *sgfc, bool split)
+{
+	if(!sgfc->options->verbatim || split)
+		return true;
+
+	for(struct TreeInfo *ti = sgfc->tree; ti; ti = ti->next)
+		if(!IsVerbatimTree(sgfc, ti, true))
+			return false;
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	WriteVerbatim
+***				Writes the original text of a game tree (see IsVerbatimTree)
+*** Parameters: save ... pointer to SaveInfo
+***				info ... TreeInfo of game tree
+*** Returns:	true or false
+**************************************************************************/
+
+static int WriteVerbatim(struct SaveInfo *save, struct TreeInfo *info)
+{
+	return WriteBytes(save, info->source, info->source_len) &&
+		   WriteChar(save, '\n', false);	/* linelen = 0, like behind WriteTree() */
+}
+
+
+/**************************************************************************
+*** Function:	HeadSize // WriteHead
+***				Size of / writes the text in front of the SGF data
+***				(option keep_head)
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				sfh	 ... SaveFileHandler (open)
+*** Returns:	size in bytes // true or false
+**************************************************************************/
+
+static size_t HeadSize(const struct SGFInfo *sgfc)
+{
+	const char *c = sgfc->decoded_buffer ? sgfc->decoded_buffer : sgfc->buffer;
+	return (size_t)(sgfc->start - c) + 1;
+}
+
+static int WriteHead(const struct SGFInfo *sgfc, struct SaveFileHandler *sfh)
+{
+	const char *c = sgfc->decoded_buffer ? sgfc->decoded_buffer : sgfc->buffer;
+	return SaveOutput(sfh, c, (size_t)(sgfc->start - c)) && SaveOutput(sfh, "\n", 1);
+}
+
+
+/**************************************************************************
+*** Function:	WriteSGFFile
+***				Writes the trees that go into one file (all trees or,
+***				in case of split_file, a single tree)
+*** Parameters: save ... pointer to SaveInfo (sfh is open)
+***				n	 ... in/out: next root node to be written
+***				info ... in/out: TreeInfo of n
+***				nl	 ... in/out: number of newlines in front of tree
+***				head ... write header in front of SGF data (keep_head)
+*** Returns:	true or false (write error)
+**************************************************************************/
+
+static int WriteSGFFile(struct SaveInfo *save, struct Node **n, struct TreeInfo **info, int *nl, bool head)
+{
+	if(head && !WriteHead(save->sgfc, save->sfh))
+		return false;
+
+	while(*n)
+	{
+		if(IsVerbatimTree(save->sgfc, *info, save->copy_unlabeled))
 		{
-			if(!WriteNode(save, info, n))	/* write child */
+			if(!WriteVerbatim(save, *info))
 				return false;
-			n = n->child;
 		}
+		else if(!WriteTree(save, *info, *n, *nl))
+			return false;
+
+		*nl = 2;
+		*n = (*n)->sibling;
+		*info = (*info)->next;
+
+		if(save->split && *n)
+			break;
 	}
+	return FlushSaveBuffer(save);
+}
 
-	saveputc(save, ')')
 
-	if(newlines != 1)
-		saveputc(save, '\n')
+/**************************************************************************
+*** Function:	MeasureIO_write // MeasureSGFFile
+***				Determines the size of the next file by writing it to
+***				a SaveFileHandler that only counts bytes. Root properties
+***				and compressed point lists are set by this pass already,
+***				the real pass doesn't have to do it again.
+*** Parameters: save ... pointer to SaveInfo (state before the file)
+***				n, info, nl, head ... see WriteSGFFile
+*** Returns:	size of file in bytes
+**************************************************************************/
 
+static int MeasureIO_write(struct SaveFileHandler *sfh, const char *buffer, size_t len)
+{
+	sfh->size_hint += len;
 	return true;
 }
 
+static size_t MeasureSGFFile(const struct SaveInfo *save, struct Node *n, struct TreeInfo *info, int nl, bool head)
+{
+	struct SaveFileHandler counter = {NULL, NULL, NULL, {NULL}, MeasureIO_write, false, 0};
+	struct SaveInfo measure;
+
+	measure.sgfc = save->sgfc;
+	measure.sfh = &counter;
+	measure.linelen = save->linelen;
+	measure.chars_in_node = save->chars_in_node;
+	measure.eol_in_node = save->eol_in_node;
+	measure.gi_written = save->gi_written;
+	measure.split = save->split;
+	measure.prepared = false;
+	measure.copy_unlabeled = save->copy_unlabeled;
+	measure.out_len = 0;
+
+	WriteSGFFile(&measure, &n, &info, &nl, head);
+	return counter.size_hint;
+}
+
 
 /**************************************************************************
-*** Function:	SaveSGF
-***				writes the complete SGF tree to a file
-*** Parameters: sgfc      ... pointer to SGFInfo structure
-***				setup_sfh ... handler for writing to file or buffer
+*** Function:	WriteSGF
+***				Writes the complete SGF tree with an already set up
+***				SaveFileHandler (one or several files)
+*** Parameters: sgfc	  ... pointer to SGFInfo structure
+***				sfh		  ... SaveFileHandler
 ***				base_name ... filename/path of destination file
-*** Returns:	true on success, false on error while writing file(s)
+***				split	  ... write one file per game tree
+***				name	  ... output: name of file (for error messages)
+*** Returns:	E_NO_ERROR, FE_DEST_FILE_OPEN or FE_DEST_FILE_WRITE
 **************************************************************************/
 
-bool SaveSGF(struct SGFInfo *sgfc, struct SaveFileHandler *(*setup_sfh)(void), const char *base_name)
+static U_LONG WriteSGF(struct SGFInfo *sgfc, struct SaveFileHandler *sfh,
+					   const char *base_name, bool split, char *name, size_t name_size)
 {
-	struct SaveInfo save = {sgfc, NULL, 0,0,0, false};
-	struct Node *n;
-	struct TreeInfo *info;
-	const char *c;
+	struct SaveInfo save;
+	struct Node *n = sgfc->root;
+	struct TreeInfo *info = sgfc->tree;
 	int nl = 0, i = 1;
-	size_t name_buffer_size = strlen(base_name) + 14; /* +14 == "_99999999.sgf" + \0 */
+	bool head = sgfc->options->keep_head;
 
-	if(!(save.sfh = setup_sfh()))
-		return false;
+	save.sgfc = sgfc;
+	save.sfh = sfh;
+	save.linelen = 0;
+	save.chars_in_node = 0;
+	save.eol_in_node = 0;
+	save.gi_written = false;
+	save.split = split;
+	save.prepared = false;
+	save.copy_unlabeled = CopyUnlabeledTrees(sgfc, split);
+	save.out_len = 0;
+
+	do
+	{
+		if(split)
+			snprintf(name, name_size, "%s_%03d.sgf", base_name, i++);
+		else
+			snprintf(name, name_size, "%s", base_name);
+
+		if(!sfh->putc)		/* block handler */
+			sfh->size_hint = sfh->exact_size ? MeasureSGFFile(&save, n, info, nl, head) : 0;
+		save.prepared = !sfh->putc && sfh->exact_size;
+		if(!(*sfh->open)(sfh, name, "wb"))
+			return FE_DEST_FILE_OPEN;
+
+		if(!WriteSGFFile(&save, &n, &info, &nl, head))
+		{
+			(*sfh->close)(sfh, FE_DEST_FILE_WRITE);
+			return FE_DEST_FILE_WRITE;
+		}
+		(*sfh->close)(sfh, E_NO_ERROR);
+		head = false;
+	} while(n);
+
+	return E_NO_ERROR;
+}
+
+
+#define SAVE_JOBS_PER_THREAD	8
+
+struct SaveTree
+{
+	struct Node *root;
+	struct TreeInfo *info;
+	char *buffer;			/* serialized game tree */
+	size_t len;
+	struct SaveFileHandler *sfh;	/* split_file: handler of the file */
+	U_LONG error;			/* split_file: result of writing the file */
+	int lib_errno;			/* errno of worker thread in case of error */
+};
+
+struct ParallelSave
+{
+	struct SGFInfo *sgfc;
+	const char *base_name;
+	size_t name_size;
+	struct SaveTree *trees;
+	size_t num_trees;
+	size_t num_jobs;
+	struct SGFInfo **workers;
+	bool copy_unlabeled;	/* see IsVerbatimTree */
+};
 
-	char *name = SaveMalloc(name_buffer_size, "filename buffer");
-	if(sgfc->options->split_file)
-		snprintf(name, name_buffer_size, "%s_%03d.sgf", base_name, i);
+
+/**************************************************************************
+*** Function:	SerializeTree
+***				Writes a single game tree into a memory buffer.
+***				Every game tree starts at the beginning of a line and
+***				with FF[] as first property, so the output doesn't
+***				depend on the trees written before.
+*** Parameters: sgfc ... pointer to SGFInfo (of worker)
+***				tree ... SaveTree (buffer & len are set)
+***				copy_unlabeled ... see IsVerbatimTree
+*** Returns:	true or false (out of memory)
+**************************************************************************/
+
+static bool SerializeTree(struct SGFInfo *sgfc, struct SaveTree *tree, bool copy_unlabeled)
+{
+	struct SaveFileHandler mem = {SaveBufferIO_open, SaveBufferIO_close, NULL, {NULL},
+								  SaveBufferIO_write, false, 0};
+	struct SaveInfo save;
+	bool ok;
+
+	save.sgfc = sgfc;
+	save.sfh = &mem;
+	save.linelen = 0;
+	save.chars_in_node = 0;
+	save.eol_in_node = 0;
+	save.gi_written = false;
+	save.split = false;
+	save.prepared = false;
+	save.copy_unlabeled = copy_unlabeled;
+	save.out_len = 0;
+
+	if(!SaveBufferIO_open(&mem, NULL, NULL))
+		return false;
+	if(IsVerbatimTree(sgfc, tree->info, copy_unlabeled))
+		ok = WriteVerbatim(&save, tree->info);
 	else
-		strcpy(name, base_name);
+		ok = WriteTree(&save, tree->info, tree->root, 0);
+	if(!ok || !FlushSaveBuffer(&save))
+	{
+		SaveBufferIO_close(&mem, FE_DEST_FILE_WRITE);
+		return false;
+	}
+	tree->buffer = mem.fh.memh.buffer;
+	tree->len = (size_t)(mem.fh.memh.pos - mem.fh.memh.buffer);
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	WriteSplitFile
+***				Writes a serialized game tree to its own file (split_file)
+*** Parameters: ps	 ... pointer to ParallelSave
+***				t	 ... number of game tree
+***				name ... buffer for filename
+*** Returns:	E_NO_ERROR, FE_DEST_FILE_OPEN or FE_DEST_FILE_WRITE
+**************************************************************************/
 
-	if(!(*save.sfh->open)(save.sfh, name, "wb"))
+static U_LONG WriteSplitFile(struct ParallelSave *ps, size_t t, char *name)
+{
+	struct SaveTree *tree = &ps->trees[t];
+	struct SaveFileHandler *sfh = tree->sfh;
+	bool head = !t && ps->sgfc->options->keep_head;
+	U_LONG error = E_NO_ERROR;
+
+	if(!sfh)
+		return FE_DEST_FILE_OPEN;
+
+	snprintf(name, ps->name_size, "%s_%03d.sgf", ps->base_name, (int)t + 1);
+	if(!sfh->putc)
+		sfh->size_hint = sfh->exact_size ? tree->len + (head ? HeadSize(ps->sgfc) : 0) : 0;
+	if(!(*sfh->open)(sfh, name, "wb"))
+		error = FE_DEST_FILE_OPEN;
+	else if((head && !WriteHead(ps->sgfc, sfh)) || !SaveOutput(sfh, tree->buffer, tree->len))
 	{
-		PrintError(FE_DEST_FILE_OPEN, sgfc, name);
-		goto free_and_return_false;
+		(*sfh->close)(sfh, FE_DEST_FILE_WRITE);
+		error = FE_DEST_FILE_WRITE;
 	}
+	else
+		(*sfh->close)(sfh, E_NO_ERROR);
+
+	return error;
+}
 
-	if(sgfc->options->keep_head)
+
+/**************************************************************************
+*** Function:	SaveTreesJob
+***				Serializes a range of game trees (job of RunWorkers())
+***				and writes their files in case of split_file
+*** Parameters: data ... pointer to ParallelSave
+***				i	 ... number of job
+*** Returns:	-
+**************************************************************************/
+
+static void SaveTreesJob(void *data, size_t i)
+{
+	struct ParallelSave *ps = data;
+	struct SGFInfo *worker = SetupWorkerSGFInfo(ps->sgfc);
+	size_t t = i * ps->num_trees / ps->num_jobs;
+	size_t end = (i + 1) * ps->num_trees / ps->num_jobs;
+	char *name = NULL;
+
+	/* root properties & compressed point lists are allocated in worker arena */
+	ps->workers[i] = worker;
+	if(ps->sgfc->options->split_file)
+		name = SaveMalloc(worker, ps->name_size, "filename buffer");
+
+	for(; t < end; t++)
 	{
-		for(c = sgfc->buffer; c < sgfc->start; c++)
-			if((*save.sfh->putc)(save.sfh, *c) == EOF)
-				goto write_error;
-		if((*save.sfh->putc)(save.sfh, '\n') == EOF)
-			goto write_error;
+		struct SaveTree *tree = &ps->trees[t];
+
+		if(!SerializeTree(worker, tree, ps->copy_unlabeled))
+			tree->error = FE_DEST_FILE_WRITE;
+		else if(name)
+		{
+			tree->error = WriteSplitFile(ps, t, name);
+			free(tree->buffer);
+			tree->buffer = NULL;
+		}
+		tree->lib_errno = errno;
 	}
+	free(name);
+}
 
-	save.linelen = 0;
-	save.chars_in_node = 0;
-	save.eol_in_node = 0;
 
-	n = sgfc->root;
-	info = sgfc->tree;
+/**************************************************************************
+*** Function:	SaveTreesParallel
+***				Parallel mode: serializes the game trees on worker threads.
+***				With split_file the workers write the files as well
+***				(handlers are set up on this thread beforehand),
+***				otherwise the trees are written to a single file in order.
+***				The output is the same as the one of WriteSGF().
+*** Parameters: sgfc	  ... pointer to SGFInfo structure
+***				sfh		  ... SaveFileHandler (set up)
+***				setup_sfh ... handler for further split files
+***				base_name ... filename/path of destination file
+***				name	  ... output: name of file (for error messages)
+***				error	  ... output: see WriteSGF()
+*** Returns:	true if trees have been saved, false if there's
+***				nothing to be gained (caller saves them sequentially)
+**************************************************************************/
 
-	while(n)
+static bool SaveTreesParallel(struct SGFInfo *sgfc, struct SaveFileHandler *sfh,
+							  struct SaveFileHandler *(*setup_sfh)(void), const char *base_name,
+							  char *name, size_t name_size, U_LONG *error)
+{
+	struct ParallelSave ps;
+	struct Node *n;
+	struct TreeInfo *ti;
+	size_t i, size = 0, threads = NumWorkerThreads(sgfc);
+	bool head = sgfc->options->keep_head;
+
+	if(threads < 2)
+		return false;
+
+	ps.num_trees = 0;
+	for(n = sgfc->root; n; n = n->sibling)
+		ps.num_trees++;
+	if(ps.num_trees < 2)
+		return false;
+
+	ps.sgfc = sgfc;
+	ps.base_name = base_name;
+	ps.name_size = name_size;
+	ps.trees = SaveCalloc(sgfc, ps.num_trees * sizeof(struct SaveTree), "tree list");
+	ps.num_jobs = threads * SAVE_JOBS_PER_THREAD;
+	if(ps.num_jobs > ps.num_trees)
+		ps.num_jobs = ps.num_trees;
+	ps.workers = SaveCalloc(sgfc, ps.num_jobs * sizeof(struct SGFInfo *), "worker list");
+	ps.copy_unlabeled = CopyUnlabeledTrees(sgfc, sgfc->options->split_file);
+
+	for(i = 0, n = sgfc->root, ti = sgfc->tree; n; n = n->sibling, ti = ti->next, i++)
 	{
-		if(!WriteTree(&save, info, n, nl))
-			goto write_error;
+		ps.trees[i].root = n;
+		ps.trees[i].info = ti;
+		ps.trees[i].error = E_NO_ERROR;
+		if(sgfc->options->split_file)	/* setup_sfh() needn't be thread-safe */
+			ps.trees[i].sfh = i ? setup_sfh() : sfh;
+	}
+
+	RunWorkers(sgfc, ps.num_jobs, SaveTreesJob, &ps);
 
-		nl = 2;
-		n = n->sibling;
-		info = info->next;
+	for(i = 0; i < ps.num_jobs; i++)
+		MergeWorkerSGFInfo(sgfc, ps.workers[i], 1, 1);
+
+	*error = E_NO_ERROR;
+	for(i = 0; i < ps.num_trees; i++)
+	{
+		size += ps.trees[i].len;
+		if(ps.trees[i].error != E_NO_ERROR && *error == E_NO_ERROR)
+		{
+			*error = ps.trees[i].error;
+			if(sgfc->options->split_file)
+				snprintf(name, name_size, "%s_%03d.sgf", base_name, (int)i + 1);
+			else
+				snprintf(name, name_size, "%s", base_name);
+			errno = ps.trees[i].lib_errno;
+		}
+	}
 
-		if(sgfc->options->split_file && n)
+	if(!sgfc->options->split_file && *error == E_NO_ERROR)
+	{
+		snprintf(name, name_size, "%s", base_name);
+		if(!sfh->putc)
+			sfh->size_hint = sfh->exact_size ? size + (head ? HeadSize(sgfc) : 0) : 0;
+		if(!(*sfh->open)(sfh, name, "wb"))
+			*error = FE_DEST_FILE_OPEN;
+		else
 		{
-			(*save.sfh->close)(save.sfh, E_NO_ERROR);
-			i++;
-			snprintf(name, name_buffer_size, "%s_%03d.sgf", base_name, i);
+			bool ok = !head || WriteHead(sgfc, sfh);
 
-			if(!(*save.sfh->open)(save.sfh, name, "wb"))
-			{
-				PrintError(FE_DEST_FILE_OPEN, sgfc, name);
-				goto free_and_return_false;
-			}
+			for(i = 0; ok && i < ps.num_trees; i++)
+				ok = SaveOutput(sfh, ps.trees[i].buffer, ps.trees[i].len);
+			if(!ok)
+				*error = FE_DEST_FILE_WRITE;
+			(*sfh->close)(sfh, *error);
 		}
 	}
 
-	(*save.sfh->close)(save.sfh, E_NO_ERROR);
-	free(name);
-	free(save.sfh);
+	for(i = 0; i < ps.num_trees; i++)
+	{
+		free(ps.trees[i].buffer);
+		if(i)
+			free(ps.trees[i].sfh);
+	}
+	free(ps.workers);
+	free(ps.trees);
 	return true;
+}
+
+
+/**************************************************************************
+*** Function:	SaveSGF
+***				writes the complete SGF tree to a file
+*** Parameters: sgfc      ... pointer to SGFInfo structure
+***				setup_sfh ... handler for writing to file or buffer
+***				base_name ... filename/path of destination file
+*** Returns:	true on success, false on error while writing file(s)
+**************************************************************************/
+
+bool SaveSGF(struct SGFInfo *sgfc, struct SaveFileHandler *(*setup_sfh)(void), const char *base_name)
+{
+	struct SaveFileHandler *sfh;
+	size_t name_buffer_size = strlen(base_name) + 14; /* +14 == "_99999999.sgf" + \0 */
+	U_LONG error;
+
+	if(!(sfh = setup_sfh()))
+		return false;
+
+	char *name = SaveMalloc(sgfc, name_buffer_size, "filename buffer");
+	if(!sgfc->options->parallel ||
+	   !SaveTreesParallel(sgfc, sfh, setup_sfh, base_name, name, name_buffer_size, &error))
+		error = WriteSGF(sgfc, sfh, base_name, sgfc->options->split_file, name, name_buffer_size);
+	if(error != E_NO_ERROR)
+		PrintError(error, sgfc, name);
 
-write_error:
-	(*save.sfh->close)(save.sfh, FE_DEST_FILE_WRITE);
-	PrintError(FE_DEST_FILE_WRITE, sgfc, name);
-free_and_return_false:
 	free(name);
-	free(save.sfh);
-	return false;
+	free(sfh);
+	return error == E_NO_ERROR;
+}
+
+
+/**************************************************************************
+*** Function:	FixedBufferIO_open // _write // _close
+***				SaveFileHandler for a caller provided buffer of fixed
+***				size (see SaveSGFToBuffer)
+**************************************************************************/
+
+static int FixedBufferIO_open(struct SaveFileHandler *sfh, const char *path, const char *mode)
+{
+	/* +1 for \0 termination */
+	if(sfh->size_hint + 1 > sfh->fh.memh.buffer_size)
+		return false;
+	sfh->fh.memh.pos = sfh->fh.memh.buffer;
+	return true;
+}
+
+static int FixedBufferIO_write(struct SaveFileHandler *sfh, const char *buffer, size_t len)
+{
+	size_t used = (size_t)(sfh->fh.memh.pos - sfh->fh.memh.buffer);
+
+	if(used + len + 1 > sfh->fh.memh.buffer_size)
+		return false;
+	memcpy(sfh->fh.memh.pos, buffer, len);
+	sfh->fh.memh.pos += len;
+	return true;
+}
+
+static int FixedBufferIO_close(struct SaveFileHandler *sfh, U_LONG error)
+{
+	*sfh->fh.memh.pos = 0;
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	SaveSGFToBuffer
+***				Writes the complete SGF tree (all game trees, split_file
+***				is ignored) into a caller provided buffer. The size of the
+***				output is determined first, so nothing is written if the
+***				buffer is too small. No error messages are printed.
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				buffer	... destination buffer (may be NULL if size is 0)
+***				size	... size of buffer
+***				needed	... output: size of output including \0 termination
+***							(may be NULL)
+*** Returns:	true on success, false if buffer is too small
+**************************************************************************/
+
+bool SaveSGFToBuffer(struct SGFInfo *sgfc, char *buffer, size_t size, size_t *needed)
+{
+	struct SaveFileHandler sfh = {FixedBufferIO_open, FixedBufferIO_close, NULL, {NULL},
+								  FixedBufferIO_write, true, 0};
+	char name[8];
+	U_LONG error;
+
+	sfh.fh.memh.buffer = buffer;
+	sfh.fh.memh.buffer_size = buffer ? size : 0;
+	sfh.fh.memh.pos = buffer;
+
+	error = WriteSGF(sgfc, &sfh, "buffer", false, name, sizeof(name));
+	if(needed)
+		*needed = sfh.size_hint + 1;
+	return error == E_NO_ERROR;
 }
@@ -0,0 +1,777 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 snapshot.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+*** Notes:	Binary snapshots of checked SGF data (--write-snapshot,
+***			--read-snapshot). A snapshot holds the game trees as they are
+***			after ParseSGF(), so that they can be loaded again without
+***			parsing and checking them.
+***
+***			Layout: SnapshotHeader (native byte order), followed by a
+***			byte stream (padded with 0 to 8 bytes):
+***				string head, string encoding
+***				per tree:  FF, GM, bwidth, bheight, string encoding_name
+***				per node (pre-order of all trees):
+***					flags (NODE_xxx, number of properties),
+***					[8 byte hash, little endian], properties
+***				per property:
+***					id << 2 | PROP_xxx, [flags, string idstr],
+***					[number of values], values
+***				per value:
+***					(length+1 or 0 for NULL) << 1 | value2 present,
+***					chars + '\0', [length+1 of value2, chars + '\0']
+***			Numbers are unsigned LEB128 varints. Strings are stored as
+***			length+1 (0: NULL), chars and '\0', so that values are used
+***			directly from the file buffer.
+**************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "all.h"
+#include "protos.h"
+
+
+#define SNAPSHOT_MAGIC		"SGFCSNAP"
+#define SNAPSHOT_VERSION	3u
+#define SNAPSHOT_BYTE_ORDER	0x01020304u
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t checksum;		/* of everything following the header */
+	uint64_t size;			/* size of snapshot file */
+	uint32_t num_trees;
+	uint32_t num_nodes;
+	uint32_t num_props;
+	uint32_t num_values;
+	int32_t error_count;
+	int32_t critical_count;
+	int32_t warning_count;
+	int32_t ignored_count;
+};
+
+/* node flags: tree structure, hash and number of properties */
+#define NODE_CHILD			0x01	/* next node is first child */
+#define NODE_SIBLING		0x02	/* node after subtree is sibling */
+#define NODE_HASH_MASK		0x0c
+#define NODE_HASH_PARENT	0x00	/* same hash as parent (or 0 for root) */
+#define NODE_HASH_MOVE		0x04	/* hash of parent ^ key of B/W move */
+#define NODE_HASH_STORED	0x08	/* 8 bytes follow */
+#define NODE_PROPS_SHIFT	4		/* 15: varint (number - 15) follows */
+
+/* property flags (low bits of id) */
+#define PROP_VALUES		0x01	/* number of values follows (otherwise 1) */
+#define PROP_EXTRA		0x02	/* flags and idstr follow (idstr NULL: sgf_token[id].id) */
+
+/* SaveSnapshot() walks the trees twice: counting (image == NULL) & writing */
+struct SnapshotWriter
+{
+	struct SGFInfo *sgfc;
+	char *image;
+	size_t size;			/* bytes written or counted */
+
+	size_t num_trees;
+	size_t num_nodes;
+	size_t num_props;
+	size_t num_values;
+};
+
+struct SnapshotReader
+{
+	const char *pos;
+	const char *end;
+};
+
+
+/**************************************************************************
+*** Function:	SnapshotChecksum
+***				FNV style hash over 64bit words (size is a multiple of 8)
+*** Parameters: data ... start of data
+***				size ... number of bytes
+*** Returns:	checksum
+**************************************************************************/
+
+static uint64_t SnapshotChecksum(const char *data, size_t size)
+{
+	uint64_t h = 14695981039346656037ULL, w;
+
+	for(; size >= 8; size -= 8, data += 8)
+	{
+		memcpy(&w, data, 8);
+		h = (h ^ w) * 1099511628211ULL;
+		h ^= h >> 32;
+	}
+	return h;
+}
+
+
+/**************************************************************************
+*** Function:	SnapshotMoveKey
+***				Zobrist key of the B/W move of a node
+*** Parameters: n		... node
+***				bwidth	... board width of tree
+***				bheight	... board height of tree
+***				key		... output: key
+*** Returns:	true if node has a move on the board
+**************************************************************************/
+
+static bool SnapshotMoveKey(const struct Node *n, int bwidth, int bheight, uint64_t *key)
+{
+	const struct Property *p;
+	int x, y;
+
+	for(p = n->prop; p; p = p->next)
+		if(p->id == TKN_B || p->id == TKN_W)
+		{
+			if(!p->value || !p->value->value || p->value->value_len != 2)
+				return false;
+			x = DecodePosChar(p->value->value[0]);
+			y = DecodePosChar(p->value->value[1]);
+			if(x < 1 || y < 1 || x > bwidth || y > bheight)
+				return false;
+			*key = ZobristKey((y-1) * bwidth + x-1, p->id == TKN_B ? BLACK : WHITE);
+			return true;
+		}
+	return false;
+}
+
+
+/**************************************************************************
+*** Function:	PutByte // PutVarint // PutString // PutHash
+***				Append to the snapshot image (or only count the size)
+*** Parameters: w	... pointer to SnapshotWriter
+***				c	... byte
+***				x	... number
+***				s	... string (or NULL)
+***				len	... length of string
+***				h	... hash
+*** Returns:	-
+**************************************************************************/
+
+static void PutByte(struct SnapshotWriter *w, unsigned char c)
+{
+	if(w->image)
+		w->image[w->size] = (char)c;
+	w->size++;
+}
+
+static void PutVarint(struct SnapshotWriter *w, uint64_t x)
+{
+	for(; x >= 0x80; x >>= 7)
+		PutByte(w, (unsigned char)(x | 0x80));
+	PutByte(w, (unsigned char)x);
+}
+
+static void PutString(struct SnapshotWriter *w, const char *s, size_t len)
+{
+	if(!s)
+	{
+		PutVarint(w, 0);
+		return;
+	}
+	PutVarint(w, (uint64_t)len + 1);
+	if(w->image)
+	{
+		memcpy(w->image + w->size, s, len);
+		w->image[w->size + len] = 0;
+	}
+	w->size += len + 1;
+}
+
+static void PutHash(struct SnapshotWriter *w, uint64_t h)
+{
+	for(int i = 0; i < 8; i++, h >>= 8)
+		PutByte(w, (unsigned char)h);
+}
+
+
+/**************************************************************************
+*** Function:	PutNode
+***				Appends a node with its properties and values
+*** Parameters: w  ... pointer to SnapshotWriter
+***				n  ... node
+***				ti ... tree info of node
+*** Returns:	-
+**************************************************************************/
+
+static void PutNode(struct SnapshotWriter *w, const struct Node *n, const struct TreeInfo *ti)
+{
+	const struct Property *p;
+	const struct PropValue *v;
+	uint64_t delta = n->hash ^ (n->parent ? n->parent->hash : 0), key;
+	size_t num_props = 0, num_values;
+	unsigned char flags = 0;
+
+	for(p = n->prop; p; p = p->next)
+		num_props++;
+
+	if(n->child)	flags |= NODE_CHILD;
+	if(n->sibling)	flags |= NODE_SIBLING;
+	if(delta)
+	{
+		if(SnapshotMoveKey(n, ti->bwidth, ti->bheight, &key) && key == delta)
+			flags |= NODE_HASH_MOVE;
+		else
+			flags |= NODE_HASH_STORED;
+	}
+	PutByte(w, flags | (unsigned char)((num_props < 15 ? num_props : 15) << NODE_PROPS_SHIFT));
+	if(num_props >= 15)
+		PutVarint(w, num_props - 15);
+	if((flags & NODE_HASH_MASK) == NODE_HASH_STORED)
+		PutHash(w, n->hash);
+
+	for(p = n->prop; p; p = p->next, w->num_props++)
+	{
+		bool extra = p->flags != sgf_token[p->id].flags ||
+					 p->id == TKN_UNKNOWN || strcmp(p->idstr, sgf_token[p->id].id);
+
+		num_values = 0;
+		for(v = p->value; v; v = v->next)
+			num_values++;
+
+		PutVarint(w, (uint64_t)p->id << 2 | (num_values != 1 ? PROP_VALUES : 0) | (extra ? PROP_EXTRA : 0));
+		if(extra)
+		{
+			PutVarint(w, p->flags);
+			if(p->id == TKN_UNKNOWN || strcmp(p->idstr, sgf_token[p->id].id))
+				PutString(w, p->idstr, strlen(p->idstr));
+			else
+				PutString(w, NULL, 0);
+		}
+		if(num_values != 1)
+			PutVarint(w, num_values);
+
+		for(v = p->value; v; v = v->next, w->num_values++)
+		{
+			PutVarint(w, (v->value ? (uint64_t)v->value_len + 1 : 0) << 1 | (v->value2 != NULL));
+			if(v->value)
+			{
+				if(w->image)
+				{
+					memcpy(w->image + w->size, v->value, v->value_len);
+					w->image[w->size + v->value_len] = 0;
+				}
+				w->size += v->value_len + 1;
+			}
+			if(v->value2)
+				PutString(w, v->value2, v->value2_len);
+		}
+	}
+}
+
+
+/**************************************************************************
+*** Function:	WalkSnapshot
+***				Counts or writes head, trees, nodes, properties and
+***				values. Nodes are visited in pre-order of all trees,
+***				i.e. a parent always comes before its children.
+*** Parameters: w		 ... pointer to SnapshotWriter
+***				head	 ... text in front of SGF data (see keep_head)
+***				head_len ... length of head
+*** Returns:	-
+**************************************************************************/
+
+static void WalkSnapshot(struct SnapshotWriter *w, const char *head, size_t head_len)
+{
+	struct SGFInfo *sgfc = w->sgfc;
+	struct TreeInfo *ti, *root_ti;
+	struct Node *n = sgfc->root;
+
+	w->num_trees = w->num_nodes = w->num_props = w->num_values = 0;
+	w->size = sizeof(struct SnapshotHeader);
+
+	PutString(w, head, head_len);
+	PutString(w, sgfc->global_encoding_name,
+			  sgfc->global_encoding_name ? strlen(sgfc->global_encoding_name) : 0);
+
+	for(ti = sgfc->tree; ti; ti = ti->next, w->num_trees++)
+	{
+		PutVarint(w, (uint32_t)ti->FF);
+		PutVarint(w, (uint32_t)ti->GM);
+		PutVarint(w, (uint32_t)ti->bwidth);
+		PutVarint(w, (uint32_t)ti->bheight);
+		PutString(w, ti->encoding_name, ti->encoding_name ? strlen(ti->encoding_name) : 0);
+	}
+
+	root_ti = sgfc->tree;
+	while(n)
+	{
+		PutNode(w, n, root_ti);
+		w->num_nodes++;
+
+		if(n->child)
+			n = n->child;
+		else
+		{
+			while(n && !n->sibling)		/* roots are siblings of each other */
+				n = n->parent;
+			if(n)
+			{
+				if(!n->parent)
+					root_ti = root_ti->next;
+				n = n->sibling;
+			}
+		}
+	}
+
+	while(w->size % 8)
+		PutByte(w, 0);
+}
+
+
+/**************************************************************************
+*** Function:	SaveSnapshot
+***				Writes a binary snapshot of the checked SGF data
+***				(call after ParseSGF())
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				name ... filename/path
+*** Returns:	true on success, false on error (message printed)
+**************************************************************************/
+
+bool SaveSnapshot(struct SGFInfo *sgfc, const char *name)
+{
+	struct SnapshotWriter w;
+	struct SnapshotHeader *hdr;
+	const char *buffer = sgfc->decoded_buffer ? sgfc->decoded_buffer : sgfc->buffer;
+	size_t head_len = sgfc->start && buffer ? (size_t)(sgfc->start - buffer) : 0;
+	size_t written;
+	FILE *file;
+
+	if(!buffer)
+		buffer = "";
+
+	memset(&w, 0, sizeof(w));
+	w.sgfc = sgfc;
+	WalkSnapshot(&w, buffer, head_len);		/* counting pass */
+
+	if(w.num_nodes > UINT32_MAX || w.num_props > UINT32_MAX ||
+	   w.num_values > UINT32_MAX || w.num_trees > UINT32_MAX)
+	{
+		PrintError(FE_BAD_SNAPSHOT, sgfc, name, "too big (more than 4G nodes, properties or values)");
+		return false;
+	}
+
+	w.image = SaveCalloc(sgfc, w.size, "snapshot buffer");
+	WalkSnapshot(&w, buffer, head_len);		/* writing pass */
+
+	hdr = (struct SnapshotHeader *)w.image;
+	memcpy(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic));
+	hdr->version = SNAPSHOT_VERSION;
+	hdr->byte_order = SNAPSHOT_BYTE_ORDER;
+	hdr->size = w.size;
+	hdr->num_trees = (uint32_t)w.num_trees;
+	hdr->num_nodes = (uint32_t)w.num_nodes;
+	hdr->num_props = (uint32_t)w.num_props;
+	hdr->num_values = (uint32_t)w.num_values;
+	hdr->error_count = sgfc->error_count;
+	hdr->critical_count = sgfc->critical_count;
+	hdr->warning_count = sgfc->warning_count;
+	hdr->ignored_count = sgfc->ignored_count;
+	hdr->checksum = SnapshotChecksum(w.image + sizeof(struct SnapshotHeader),
+									 w.size - sizeof(struct SnapshotHeader));
+
+	if(!(file = fopen(name, "wb")))
+	{
+		free(w.image);
+		PrintError(FE_DEST_FILE_OPEN, sgfc, name);
+		return false;
+	}
+	written = fwrite(w.image, 1, w.size, file);
+	free(w.image);
+	if(fclose(file) || written != w.size)
+	{
+		PrintError(FE_DEST_FILE_WRITE, sgfc, name);
+		return false;
+	}
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	GetVarint // GetString
+***				Reads from the snapshot stream with bounds checks
+*** Parameters: r	 ... pointer to SnapshotReader
+***				max	 ... maximum value of number
+***				x	 ... output: number
+***				code ... length+1 of string (0: NULL)
+***				s	 ... output: string (or NULL)
+***				len	 ... output: length of string (may be NULL)
+*** Returns:	true if data is valid
+**************************************************************************/
+
+static bool GetVarint(struct SnapshotReader *r, uint64_t max, uint64_t *x)
+{
+	unsigned char c;
+	int shift = 0;
+
+	*x = 0;
+	do {
+		if(r->pos == r->end || shift > 63)
+			return false;
+		c = (unsigned char)*r->pos++;
+		if(shift == 63 && c > 1)		/* more than 64 bits */
+			return false;
+		*x |= (uint64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while(c & 0x80);
+	return *x <= max;
+}
+
+static bool GetString(struct SnapshotReader *r, uint64_t code, char **s, size_t *len)
+{
+	*s = NULL;
+	if(len)
+		*len = 0;
+	if(!code)
+		return true;
+	if(code - 1 >= (uint64_t)(r->end - r->pos) || r->pos[code - 1])
+		return false;
+	*s = (char *)r->pos;
+	if(len)
+		*len = (size_t)(code - 1);
+	r->pos += code;
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	GetNode
+***				Reads properties and values of a node
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				r		... pointer to SnapshotReader
+***				n		... node (properties are added)
+***				num		... number of properties
+***				props	... next free Property
+***				values	... next free PropValue
+***				end_p	... end of Property array
+***				end_v	... end of PropValue array
+*** Returns:	true if data is valid
+**************************************************************************/
+
+static bool GetNode(struct SGFInfo *sgfc, struct SnapshotReader *r, struct Node *n, uint64_t num,
+					struct Property **props, struct PropValue **values,
+					struct Property *end_p, struct PropValue *end_v)
+{
+	struct Property *p;
+	struct PropValue *v;
+	uint64_t x, id, num_values, code;
+	char *s;
+
+	if(num > (uint64_t)(end_p - *props))
+		return false;
+	for(; num; num--)
+	{
+		p = (*props)++;
+		if(!GetVarint(r, (uint64_t)NUM_SGF_TOKENS << 2, &x) || (id = x >> 2) >= NUM_SGF_TOKENS)
+			return false;
+		p->id = (token)id;
+		p->idstr = sgf_token[p->id].id;
+		p->flags = sgf_token[p->id].flags;
+		if(x & PROP_EXTRA)
+		{
+			if(!GetVarint(r, 0xffff, &code))
+				return false;
+			p->flags = (U_SHORT)code;
+			if(!GetVarint(r, UINT64_MAX, &code) || !GetString(r, code, &s, NULL))
+				return false;
+			if(s)
+				p->idstr = InternPropID(sgfc, p->id, s);
+		}
+		if(!p->idstr)
+			return false;
+		num_values = 1;
+		if((x & PROP_VALUES) && !GetVarint(r, UINT64_MAX, &num_values))
+			return false;
+
+		p->priority = sgf_token[p->id].priority;
+		p->pos = 0;
+		p->value = p->valend = NULL;
+		p->next = NULL;
+		p->prev = n->last;
+		if(n->last)
+			n->last->next = p;
+		else
+			n->prop = p;
+		n->last = p;
+
+		if(num_values > (uint64_t)(end_v - *values))
+			return false;
+		for(; num_values; num_values--)
+		{
+			v = (*values)++;
+			if(!GetVarint(r, UINT64_MAX, &code) ||
+			   !GetString(r, code >> 1, &v->value, &v->value_len))
+				return false;
+			v->value2 = NULL;
+			v->value2_len = 0;
+			if((code & 1) &&
+			   (!GetVarint(r, UINT64_MAX, &code) || !GetString(r, code, &v->value2, &v->value2_len)))
+				return false;
+			v->pos = 0;
+			v->next = NULL;
+			v->prev = p->valend;
+			if(p->valend)
+				p->valend->next = v;
+			else
+				p->value = v;
+			p->valend = v;
+		}
+	}
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	LinkSnapshot
+***				Builds tree info, nodes, properties and values from the
+***				snapshot stream. Values point into the file buffer.
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				hdr	 ... snapshot header (checksum ok)
+***				r	 ... pointer to SnapshotReader (behind head & encoding)
+*** Returns:	true on success, false if snapshot is inconsistent
+**************************************************************************/
+
+struct SnapshotOpen			/* node whose subtree is being read */
+{
+	struct Node *n;
+	bool sibling;
+};
+
+static bool LinkSnapshot(struct SGFInfo *sgfc, const struct SnapshotHeader *hdr, struct SnapshotReader *r)
+{
+	struct Node *nodes, *n, *parent = NULL;
+	struct Property *props = NULL, *next_p;
+	struct PropValue *values = NULL, *next_v;
+	struct TreeInfo *ti, *root_ti = NULL;
+	struct SnapshotOpen *open = NULL;
+	size_t depth = 0, max_depth = 0;
+	uint64_t x, code, key, hash;
+	unsigned char flags;
+	bool ok = false, done = false;
+	char *s;
+
+	/* every record takes at least one byte: don't allocate for bogus counts */
+	if((uint64_t)hdr->num_nodes + hdr->num_props + hdr->num_values > hdr->size)
+		return false;
+
+	for(uint32_t i = 0; i < hdr->num_trees; i++)
+	{
+		ti = SaveMalloc(sgfc, sizeof(struct TreeInfo), "tree info structure");
+		ti->num = (int)i + 1;
+		ti->encoding = NULL;			/* text values are decoded already */
+		ti->encoding_name = NULL;
+		ti->root = NULL;
+		ti->source = NULL;
+		ti->source_len = 0;
+		ti->source_hash = 0;
+		ti->modified = true;
+		AddTail(&sgfc->tree, ti);
+
+		if(!GetVarint(r, UINT32_MAX, &x))		return false;
+		ti->FF = (int32_t)(uint32_t)x;
+		if(!GetVarint(r, UINT32_MAX, &x))		return false;
+		ti->GM = (int32_t)(uint32_t)x;
+		if(!GetVarint(r, UINT32_MAX, &x))		return false;
+		ti->bwidth = (int32_t)(uint32_t)x;
+		if(!GetVarint(r, UINT32_MAX, &x))		return false;
+		ti->bheight = (int32_t)(uint32_t)x;
+		if(!GetVarint(r, UINT64_MAX, &code) || !GetString(r, code, &s, NULL))
+			return false;
+		ti->encoding_name = s;
+	}
+	sgfc->info = sgfc->last;
+
+	nodes = ArenaAlloc(sgfc, hdr->num_nodes * sizeof(struct Node));
+	if(hdr->num_props)
+		props = ArenaAlloc(sgfc, hdr->num_props * sizeof(struct Property));
+	if(hdr->num_values)
+		values = ArenaAlloc(sgfc, hdr->num_values * sizeof(struct PropValue));
+	next_p = props;
+	next_v = values;
+	ti = sgfc->tree;
+
+	for(uint32_t i = 0; i < hdr->num_nodes; i++)
+	{
+		if(done || r->pos == r->end)
+			goto end;
+		flags = (unsigned char)*r->pos++;
+		x = flags >> NODE_PROPS_SHIFT;
+		if(x == 15)
+		{
+			if(!GetVarint(r, UINT32_MAX, &code))
+				goto end;
+			x += code;
+		}
+
+		n = &nodes[i];
+		n->next = i + 1 < hdr->num_nodes ? n + 1 : NULL;
+		n->prev = i ? n - 1 : NULL;
+		n->child = n->sibling = n->last_child = NULL;
+		n->prop = n->last = NULL;
+		n->pos = 0;
+		n->parent = parent;
+		if(parent)
+		{
+			if(parent->last_child)
+				parent->last_child->sibling = n;
+			else
+				parent->child = n;
+			parent->last_child = n;
+		}
+		else
+		{
+			if(!ti)
+				goto end;
+			ti->root = n;
+			root_ti = ti;
+			ti = ti->next;
+			if(sgfc->last_root)
+				sgfc->last_root->sibling = n;
+			else
+				sgfc->root = n;
+			sgfc->last_root = n;
+		}
+
+		hash = 0;
+		if((flags & NODE_HASH_MASK) == NODE_HASH_STORED)
+		{
+			if(r->end - r->pos < 8)
+				goto end;
+			for(int b = 7; b >= 0; b--)
+				hash = hash << 8 | (unsigned char)r->pos[b];
+			r->pos += 8;
+		}
+		if(!GetNode(sgfc, r, n, x, &next_p, &next_v, props + hdr->num_props, values + hdr->num_values))
+			goto end;
+
+		switch(flags & NODE_HASH_MASK)
+		{
+			case NODE_HASH_PARENT:
+				n->hash = parent ? parent->hash : 0;
+				break;
+			case NODE_HASH_MOVE:
+				if(!SnapshotMoveKey(n, root_ti->bwidth, root_ti->bheight, &key))
+					goto end;
+				n->hash = (parent ? parent->hash : 0) ^ key;
+				break;
+			case NODE_HASH_STORED:
+				n->hash = hash;
+				break;
+			default:
+				goto end;
+		}
+
+		if(flags & NODE_CHILD)			/* descend: remember where to go on */
+		{
+			if(depth == max_depth)
+				open = GrowStack(sgfc, open, &max_depth, sizeof(struct SnapshotOpen));
+			open[depth].n = n;
+			open[depth++].sibling = (flags & NODE_SIBLING) != 0;
+			parent = n;
+		}
+		else if(!(flags & NODE_SIBLING))	/* subtree done: back to open sibling */
+		{
+			while(depth && !open[depth-1].sibling)
+				depth--;
+			if(depth)
+				parent = open[--depth].n->parent;
+			else
+				done = true;
+		}
+	}
+
+	ok = done && !ti && r->end - r->pos < 8 && next_p == props + hdr->num_props &&
+		 next_v == values + hdr->num_values;
+	while(ok && r->pos != r->end)		/* padding */
+		ok = !*r->pos++;
+
+	sgfc->first = nodes;
+	sgfc->tail = &nodes[hdr->num_nodes - 1];
+end:
+	free(open);
+	return ok;
+}
+
+
+/**************************************************************************
+*** Function:	LoadSnapshot
+***				Loads a snapshot written by SaveSnapshot(). Afterwards
+***				SGFInfo is in the same state as after ParseSGF(), i.e.
+***				ParseSGF() must not be called. Nodes, properties and
+***				values have no buffer positions. Snapshots are not
+***				portable between different versions of SGFC or machines
+***				with different byte order.
+*** Parameters: sgfc ... pointer to SGFInfo structure (empty)
+***				name ... filename/path
+*** Returns:	true on success, false on fatal error
+**************************************************************************/
+
+bool LoadSnapshot(struct SGFInfo *sgfc, const char *name)
+{
+	const struct SnapshotHeader *hdr;
+	struct SnapshotReader r;
+	uint64_t size, code;
+	size_t head_len;
+	char *head, *encoding;
+
+	if(!ReadSGFFile(sgfc, name))
+		return false;
+
+	size = (uint64_t)(sgfc->b_end - sgfc->buffer);
+	hdr = (const struct SnapshotHeader *)sgfc->buffer;
+	if(size < sizeof(struct SnapshotHeader) || memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)))
+	{
+		PrintError(FE_BAD_SNAPSHOT, sgfc, name, "is not an SGFC snapshot");
+		return false;
+	}
+	if(hdr->version != SNAPSHOT_VERSION || hdr->byte_order != SNAPSHOT_BYTE_ORDER)
+	{
+		PrintError(FE_BAD_SNAPSHOT, sgfc, name, "was written by another version of SGFC or on another platform");
+		return false;
+	}
+
+	if(hdr->size != size || size % 8 ||
+	   hdr->checksum != SnapshotChecksum(sgfc->buffer + sizeof(struct SnapshotHeader),
+										 (size_t)size - sizeof(struct SnapshotHeader)))
+	{
+		PrintError(FE_BAD_SNAPSHOT, sgfc, name, "is corrupt (size or checksum mismatch)");
+		return false;
+	}
+
+	if(!hdr->num_trees)
+	{
+		PrintError(FE_NO_SGFDATA, sgfc);
+		return false;
+	}
+
+	r.pos = sgfc->buffer + sizeof(struct SnapshotHeader);
+	r.end = sgfc->b_end;
+	if(!GetVarint(&r, UINT64_MAX, &code) || !GetString(&r, code, &head, &head_len) || !head ||
+	   !GetVarint(&r, UINT64_MAX, &code) || !GetString(&r, code, &encoding, NULL) ||
+	   !LinkSnapshot(sgfc, hdr, &r))
+	{
+		PrintError(FE_BAD_SNAPSHOT, sgfc, name, "is corrupt (inconsistent data)");
+		return false;
+	}
+
+	/* head is kept as decoded buffer, so that keep_head works as usual */
+	sgfc->decoded_buffer = SaveMalloc(sgfc, head_len + 1, "snapshot head");
+	memcpy(sgfc->decoded_buffer, head, head_len + 1);
+	sgfc->decoded_end = sgfc->decoded_buffer + head_len;
+	sgfc->start = sgfc->decoded_end;
+	if(encoding)
+		sgfc->global_encoding_name = SaveDupString(sgfc, encoding, 0, "encoding name");
+
+	sgfc->error_count = hdr->error_count;
+	sgfc->critical_count = hdr->critical_count;
+	sgfc->warning_count = hdr->warning_count;
+	sgfc->ignored_count = hdr->ignored_count;
+	return true;
+}
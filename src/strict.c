@@ -45,10 +45,10 @@ static void CheckHandicap(struct SGFInfo *sgfc, struct Node *root)
 	if((handicap = FindProperty(root, TKN_HA))) /* handicap game info */
 	{
 		if(atoi(handicap->value->value) != setup_stones)
-			PrintError(W_HANDICAP_NOT_SETUP, sgfc, handicap->row, handicap->col);
+			PrintError(W_HANDICAP_NOT_SETUP, sgfc, handicap->pos);
 	}
 	else if(setup_stones != 0)
-		PrintError(W_HANDICAP_NOT_SETUP, sgfc, addBlack->row, addBlack->col);
+		PrintError(W_HANDICAP_NOT_SETUP, sgfc, addBlack->pos);
 }
 
 
@@ -65,37 +65,65 @@ static void CheckHandicap(struct SGFInfo *sgfc, struct Node *root)
 
 static void CheckMoveOrder(struct SGFInfo *sgfc, struct Node *node, bool check_setup)
 {
+	struct MoveOrderFrame
+	{
+		struct Node *node;
+		int old_col;
+		bool check_setup;
+	} *stack = NULL;
+	size_t depth = 0, max_depth = 0;
 	int old_col = 0;
 
-	if(!node)		/* does tree only consist of root node? */
-		return;
-	while(node)
+	while(true)
 	{
-		if(FindProperty(node, TKN_AB) || FindProperty(node, TKN_AW)
-		   || FindProperty(node, TKN_AE))
+		while(node)
 		{
-			if(check_setup)
-				PrintError(W_SETUP_AFTER_ROOT, sgfc, node->row, node->col);
-			else
+			if(FindProperty(node, TKN_AB) || FindProperty(node, TKN_AW)
+			   || FindProperty(node, TKN_AE))
+			{
+				if(check_setup)
+					PrintError(W_SETUP_AFTER_ROOT, sgfc, node->pos);
+				else
+					old_col = 0;
+			}
+
+			if(FindProperty(node, TKN_B))
+			{
+				if(old_col && old_col != TKN_W)
+					PrintError(W_MOVE_OUT_OF_SEQUENCE, sgfc, node->pos);
+				old_col = TKN_B;
+			}
+			if(FindProperty(node, TKN_W))
+			{
+				if(old_col && old_col != TKN_B)
+					PrintError(W_MOVE_OUT_OF_SEQUENCE, sgfc, node->pos);
+				old_col = TKN_W;
+			}
+			if(node->sibling)		/* check variation first, continue later */
+			{
+				if(depth == max_depth)
+					stack = GrowStack(sgfc, stack, &max_depth, sizeof(struct MoveOrderFrame));
+				stack[depth].node = node->child;
+				stack[depth].old_col = old_col;
+				stack[depth].check_setup = check_setup;
+				depth++;
+				node = node->sibling;
 				old_col = 0;
+				check_setup = false;
+			}
+			else
+				node = node->child;
 		}
 
-		if(FindProperty(node, TKN_B))
-		{
-			if(old_col && old_col != TKN_W)
-				PrintError(W_MOVE_OUT_OF_SEQUENCE, sgfc, node->row, node->col);
-			old_col = TKN_B;
-		}
-		if(FindProperty(node, TKN_W))
-		{
-			if(old_col && old_col != TKN_B)
-				PrintError(W_MOVE_OUT_OF_SEQUENCE, sgfc, node->row, node->col);
-			old_col = TKN_W;
-		}
-		if (node->sibling)
-			CheckMoveOrder(sgfc, node->sibling, false);
-		node = node->child;
+		if(!depth)		/* (also: tree only consists of root node) */
+			break;
+		depth--;
+		node = stack[depth].node;
+		old_col = stack[depth].old_col;
+		check_setup = stack[depth].check_setup;
 	}
+
+	free(stack);
 }
 
 
@@ -121,20 +121,38 @@ void f_Delete(struct ListHead *h, struct ListNode *n)
 }
 
 
+/**************************************************************************
+*** Function:	OutOfMemory
+***				Applies the out-of-memory policy of the SGFInfo structure
+***				(oom_panic_hook); without SGFInfo context ExitWithOOMError()
+*** Parameters: sgfc ... pointer to SGFInfo or NULL
+***				err	 ... error message
+*** Returns:	does not return
+**************************************************************************/
+
+void OutOfMemory(struct SGFInfo *sgfc, const char *err)
+{
+	if(sgfc && sgfc->oom_panic_hook)
+		(*sgfc->oom_panic_hook)(sgfc, err);
+	ExitWithOOMError(sgfc, err);
+}
+
+
 /**************************************************************************
 *** Function:	SaveMalloc
 ***				malloc() + error handling (i.e. printing error + failing)
-*** Parameters: size ... size of memory to allocate
+*** Parameters: sgfc ... pointer to SGFInfo (OOM policy) or NULL
+***				size ... size of memory to allocate
 ***				err	 ... error message
 *** Returns:	pointer to memory (or termination in case of error)
 **************************************************************************/
 
-void *SaveMalloc(size_t size, const char *err)
+void *SaveMalloc(struct SGFInfo *sgfc, size_t size, const char *err)
 {
 	void *mem = malloc(size);
 	if(!mem)
 	{
-		(*oom_panic_hook)(err); /* function will not return */
+		OutOfMemory(sgfc, err);	/* function will not return */
 		/* exit() will never be reached; safe-guard and hint for linting */
 		exit(20);
 	}
@@ -145,17 +163,18 @@ void *SaveMalloc(size_t size, const char *err)
 /**************************************************************************
 *** Function:	SaveCalloc
 ***				calloc() + error handling (i.e. printing error + failing)
-*** Parameters: size ... size of memory to allocate
+*** Parameters: sgfc ... pointer to SGFInfo (OOM policy) or NULL
+***				size ... size of memory to allocate
 ***				err	 ... error message
 *** Returns:	pointer to memory (or termination in case of error)
 **************************************************************************/
 
-void *SaveCalloc(size_t size, const char *err)
+void *SaveCalloc(struct SGFInfo *sgfc, size_t size, const char *err)
 {
 	void *mem = calloc(size, 1);
 	if(!mem)
 	{
-		(*oom_panic_hook)(err); /* function will not return */
+		OutOfMemory(sgfc, err);	/* function will not return */
 		/* exit() will never be reached; safe-guard and hint for linting */
 		exit(20);
 	}
@@ -163,20 +182,293 @@ void *SaveCalloc(size_t size, const char *err)
 }
 
 
+/**************************************************************************
+*** Function:	SaveRealloc
+***				realloc() + error handling (i.e. printing error + failing)
+*** Parameters: sgfc ... pointer to SGFInfo (OOM policy) or NULL
+***				mem	 ... memory to resize (or NULL)
+***				size ... new size of memory
+***				err	 ... error message
+*** Returns:	pointer to memory (or termination in case of error)
+**************************************************************************/
+
+void *SaveRealloc(struct SGFInfo *sgfc, void *mem, size_t size, const char *err)
+{
+	void *new_mem = realloc(mem, size);
+	if(!new_mem)
+	{
+		OutOfMemory(sgfc, err);	/* function will not return */
+		/* exit() will never be reached; safe-guard and hint for linting */
+		exit(20);
+	}
+	return new_mem;
+}
+
+
+/**************************************************************************
+*** Function:	GrowStack
+***				Doubles the size of an explicit stack used by the
+***				iterative tree traversals (instead of recursion)
+*** Parameters: sgfc	  ... pointer to SGFInfo (OOM policy) or NULL
+***				stack	  ... stack (or NULL)
+***				max		  ... pointer to number of items (updated)
+***				item_size ... size of one item
+*** Returns:	pointer to resized stack
+**************************************************************************/
+
+void *GrowStack(struct SGFInfo *sgfc, void *stack, size_t *max, size_t item_size)
+{
+	*max = *max ? *max * 2 : 64;
+	return SaveRealloc(sgfc, stack, *max * item_size, "traversal stack");
+}
+
+
 /**************************************************************************
 *** Function:	SaveDupString
 ***				Safely duplicate a string (possibly not \0 terminated)
-*** Parameters: src ... source buffer
+*** Parameters: sgfc ... pointer to SGFInfo (OOM policy) or NULL
+***				src  ... source buffer
 ***				len	 ... size of buffer
 ***				err	 ... error message
 *** Returns:	pointer to \0-terminated duplicate (or termination in case of error)
 **************************************************************************/
 
-char *SaveDupString(const char *src, size_t len, const char *err)
+char *SaveDupString(struct SGFInfo *sgfc, const char *src, size_t len, const char *err)
 {
 	if(!len)
 		len = strlen(src);
-	char *dst = SaveMalloc(len+1, err);
+	char *dst = SaveMalloc(sgfc, len+1, err);
+	memcpy(dst, src, len);
+	*(dst+len) = 0;	/* 0-terminate */
+	return dst;
+}
+
+
+/* Internal data structure for the node/property/value arena.
+** Memory is handed out by bumping a pointer within a block and is
+** released as a whole by ResetMemArena() or FreeMemArena() only. */
+
+#define ARENA_BLOCK_SIZE	(64*1024)
+#define ARENA_LARGE_SIZE	(ARENA_BLOCK_SIZE/4)	/* gets a block of its own */
+
+union ArenaAlign { void *p; long l; double d; long double ld; };
+#define ARENA_ALIGN			(sizeof(union ArenaAlign))
+
+struct MemArenaBlock
+{
+	struct MemArenaBlock *next;
+	size_t size;			/* usable size of data[] */
+	size_t used;
+	union ArenaAlign data[];
+};
+
+struct MemArena
+{
+	struct MemArenaBlock *first;	/* ARENA_BLOCK_SIZE blocks, kept on reset */
+	struct MemArenaBlock *current;
+	struct MemArenaBlock *large;	/* oversized blocks, freed on reset */
+	struct SGFInfo *sgfc;			/* for OOM policy */
+};
+
+
+/**************************************************************************
+*** Function:	SetupMemArena
+***				Allocate and initialize an empty arena
+*** Parameters: sgfc ... pointer to SGFInfo the arena belongs to
+*** Returns:	pointer to arena
+**************************************************************************/
+
+struct MemArena *SetupMemArena(struct SGFInfo *sgfc)
+{
+	struct MemArena *arena = SaveCalloc(sgfc, sizeof(struct MemArena), "memory arena");
+	arena->sgfc = sgfc;
+	return arena;
+}
+
+
+/**************************************************************************
+*** Function:	ResetMemArena // FreeMemArena
+***				Releases all memory handed out by the arena at once.
+***				Reset keeps the standard sized blocks for reuse,
+***				Free returns everything (including arena) to the system.
+*** Parameters: arena ... pointer to arena
+*** Returns:	-
+**************************************************************************/
+
+static void FreeArenaBlocks(struct MemArenaBlock *b)
+{
+	struct MemArenaBlock *next;
+
+	for(; b; b = next)
+	{
+		next = b->next;
+		free(b);
+	}
+}
+
+void ResetMemArena(struct MemArena *arena)
+{
+	struct MemArenaBlock *b;
+
+	for(b = arena->first; b; b = b->next)
+		b->used = 0;
+	arena->current = arena->first;
+
+	FreeArenaBlocks(arena->large);
+	arena->large = NULL;
+}
+
+void FreeMemArena(struct MemArena *arena)
+{
+	if(!arena)
+		return;
+	FreeArenaBlocks(arena->first);
+	FreeArenaBlocks(arena->large);
+	free(arena);
+}
+
+
+/**************************************************************************
+*** Function:	MergeMemArena
+***				Takes over all memory of another arena (e.g. of a worker
+***				in parallel mode). Blocks are inserted behind the current
+***				block; their remaining space is still used.
+*** Parameters: arena ... pointer to arena
+***				from  ... arena to be merged (gets freed)
+*** Returns:	-
+**************************************************************************/
+
+void MergeMemArena(struct MemArena *arena, struct MemArena *from)
+{
+	struct MemArenaBlock *b;
+
+	if(from->first)
+	{
+		for(b = from->first; b->next; b = b->next)
+			;
+		if(arena->current)
+		{
+			b->next = arena->current->next;
+			arena->current->next = from->first;
+		}
+		else
+		{
+			b->next = arena->first;
+			arena->first = arena->current = from->first;
+		}
+	}
+
+	if(from->large)
+	{
+		for(b = from->large; b->next; b = b->next)
+			;
+		b->next = arena->large;
+		arena->large = from->large;
+	}
+	free(from);
+}
+
+
+/**************************************************************************
+*** Function:	ArenaAllocBytes
+***				Returns size bytes from the arena
+*** Parameters: arena ... pointer to arena
+***				size  ... number of bytes
+***				align ... true: align for any structure, false: byte aligned
+*** Returns:	pointer to memory (or termination in case of error)
+**************************************************************************/
+
+static void *ArenaAllocBytes(struct MemArena *arena, size_t size, bool align)
+{
+	struct MemArenaBlock *b;
+	size_t offset;
+
+	if(size > ARENA_LARGE_SIZE)
+	{
+		b = SaveMalloc(arena->sgfc, sizeof(struct MemArenaBlock) + size, "large arena block");
+		b->size = b->used = size;
+		b->next = arena->large;
+		arena->large = b;
+		return b->data;
+	}
+
+	while(true)
+	{
+		b = arena->current;
+		if(b)
+		{
+			offset = b->used;
+			if(align)
+				offset = (offset + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+			if(offset + size <= b->size)
+			{
+				b->used = offset + size;
+				return (char *)b->data + offset;
+			}
+			if(b->next)			/* block kept from before last reset */
+			{
+				arena->current = b->next;
+				continue;
+			}
+		}
+
+		b = SaveMalloc(arena->sgfc, sizeof(struct MemArenaBlock) + ARENA_BLOCK_SIZE, "arena block");
+		b->size = ARENA_BLOCK_SIZE;
+		b->used = 0;
+		b->next = NULL;
+		if(arena->current)
+			arena->current->next = b;
+		else
+			arena->first = b;
+		arena->current = b;
+	}
+}
+
+
+/**************************************************************************
+*** Function:	ArenaAlloc
+***				Allocates memory for nodes, properties, values etc.
+***				from the SGFInfo arena. Memory must not be free()d;
+***				it's released by FreeSGFInfo() or ResetSGFInfo().
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				size ... size of memory to allocate
+*** Returns:	pointer to aligned memory (or termination in case of error)
+**************************************************************************/
+
+void *ArenaAlloc(struct SGFInfo *sgfc, size_t size)
+{
+	return ArenaAllocBytes(sgfc->_arena, size, true);
+}
+
+
+/**************************************************************************
+*** Function:	ArenaAllocString
+***				Same as ArenaAlloc, but without alignment (for char buffers)
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				size ... size of buffer (including '\0')
+*** Returns:	pointer to memory
+**************************************************************************/
+
+char *ArenaAllocString(struct SGFInfo *sgfc, size_t size)
+{
+	return ArenaAllocBytes(sgfc->_arena, size, false);
+}
+
+
+/**************************************************************************
+*** Function:	ArenaDupString
+***				SaveDupString() for strings stored in the SGFInfo arena
+*** Parameters: sgfc ... pointer to SGFInfo structure
+***				src  ... source buffer
+***				len	 ... size of buffer (0 = use strlen)
+*** Returns:	pointer to \0-terminated duplicate
+**************************************************************************/
+
+char *ArenaDupString(struct SGFInfo *sgfc, const char *src, size_t len)
+{
+	if(!len)
+		len = strlen(src);
+	char *dst = ArenaAllocString(sgfc, len+1);
 	memcpy(dst, src, len);
 	*(dst+len) = 0;	/* 0-terminate */
 	return dst;
@@ -374,28 +666,135 @@ struct Property *FindProperty(struct Node *n, token id)
 }
 
 
+/* Internal data structure for interned property ID strings (see InternPropID).
+** Open addressing hash table; the strings themselves live in the arena. */
+
+#define ID_TABLE_MIN_SIZE	64
+
+struct IDTable
+{
+	const char **slot;
+	size_t size;			/* power of 2 */
+	size_t used;
+};
+
+
+/**************************************************************************
+*** Function:	FreeIDTable
+***				Frees the table of interned property IDs
+***				(must be called whenever the arena is reset)
+*** Parameters: sgfc ... pointer to SGFInfo structure
+*** Returns:	-
+**************************************************************************/
+
+void FreeIDTable(struct SGFInfo *sgfc)
+{
+	if(!sgfc->_id_table)
+		return;
+	free(sgfc->_id_table->slot);
+	free(sgfc->_id_table);
+	sgfc->_id_table = NULL;
+}
+
+
+/**************************************************************************
+*** Function:	IDTableSlot
+***				Finds slot of ID string (or the empty slot where it belongs)
+*** Parameters: t	... pointer to IDTable
+***				id	... ID string
+*** Returns:	pointer to slot
+**************************************************************************/
+
+static const char **IDTableSlot(struct IDTable *t, const char *id)
+{
+	size_t h = 2166136261u;			/* FNV-1a */
+	const unsigned char *c;
+
+	for(c = (const unsigned char *)id; *c; c++)
+		h = (h ^ *c) * 16777619u;
+
+	for(h &= t->size - 1; t->slot[h]; h = (h + 1) & (t->size - 1))
+		if(!strcmp(t->slot[h], id))
+			break;
+	return &t->slot[h];
+}
+
+
+/**************************************************************************
+*** Function:	InternPropID
+***				Returns the shared copy of a property ID string.
+***				Known IDs (uppercase only) share sgf_token[].id, others
+***				(lowercase, unknown) are stored once per SGFInfo.
+***				Equal ID strings therefore have equal pointers (except for
+***				trees loaded in parallel, which bring their own copies).
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				id		... token of ID
+***				id_str	... ID string
+*** Returns:	pointer to interned string (read-only)
+**************************************************************************/
+
+const char *InternPropID(struct SGFInfo *sgfc, token id, const char *id_str)
+{
+	struct IDTable *t = sgfc->_id_table;
+	const char **slot;
+
+	if(id != TKN_UNKNOWN && !strcmp(id_str, sgf_token[id].id))
+		return sgf_token[id].id;
+
+	if(!t)
+	{
+		t = sgfc->_id_table = SaveMalloc(sgfc, sizeof(struct IDTable), "ID table");
+		t->size = ID_TABLE_MIN_SIZE;
+		t->used = 0;
+		t->slot = SaveCalloc(sgfc, t->size * sizeof(const char *), "ID table slots");
+	}
+
+	slot = IDTableSlot(t, id_str);
+	if(*slot)
+		return *slot;
+
+	if(2 * (t->used + 1) > t->size)		/* keep load factor below 1/2 */
+	{
+		const char **old = t->slot;
+		size_t i, old_size = t->size;
+
+		t->size *= 2;
+		t->slot = SaveCalloc(sgfc, t->size * sizeof(const char *), "ID table slots");
+		for(i = 0; i < old_size; i++)
+			if(old[i])
+				*IDTableSlot(t, old[i]) = old[i];
+		free(old);
+		slot = IDTableSlot(t, id_str);
+	}
+
+	t->used++;
+	*slot = ArenaDupString(sgfc, id_str, 0);
+	return *slot;
+}
+
+
 /**************************************************************************
 *** Function:	AddProperty
 ***				Creates new property structure and adds it to the node
 *** Parameters: sgfc	... pointer to SGFInfo structure
 ***				n		... node to which property belongs to
 ***				id		... tokenized ID of property
-***				id_buf	... pointer to property ID string
-***				idstr	... ID string
+***				pos		... buffer position of property (or 0)
+***				id_str	... ID string
 *** Returns:	pointer to new Property structure
 ***				(exits on fatal error)
 **************************************************************************/
 
-struct Property *AddProperty(struct Node *n, token id, U_LONG row, U_LONG col, const char *id_str)
+struct Property *AddProperty(struct SGFInfo *sgfc, struct Node *n, token id,
+							 U_LONG pos, const char *id_str)
 {
-	struct Property *newp = SaveMalloc(sizeof(struct Property), "property structure");
+	struct Property *newp = ArenaAlloc(sgfc, sizeof(struct Property));
 	/* init property structure */
 	newp->id = id;
-	newp->idstr = SaveDupString(id_str, 0, "ID string");
+	newp->idstr = InternPropID(sgfc, id, id_str);
 	newp->priority = sgf_token[id].priority;
 	newp->flags = sgf_token[id].flags;		/* local copy */
-	newp->row = row;
-	newp->col = col;
+	newp->pos = pos;
 	newp->value = NULL;
 	newp->valend = NULL;
 
@@ -407,7 +806,7 @@ struct Property *AddProperty(struct Node *n, token id, U_LONG row, U_LONG col, c
 
 /**************************************************************************
 *** Function:	DelProperty
-***				Deletes a property
+***				Deletes a property (memory stays in arena)
 *** Parameters: n ... node which contains property
 ***				p ... property to be deleted
 *** Returns:	p->next
@@ -427,8 +826,6 @@ struct Property *DelProperty(struct Node *n, struct Property *p)
 	if(n)
 		Delete(&n->prop, p);
 
-	free(p->idstr);
-	free(p);
 	return next;
 }
 
@@ -437,27 +834,27 @@ struct Property *DelProperty(struct Node *n, struct Property *p)
 ***				Inserts a new node into the current SGF tree
 *** Parameters: sgfc	  ... pointer to SGFInfo structure
 ***				parent	  ... parent node
-***				row		  ... row number to assign to node
-***				col		  ... column number to assign to node
+***				pos		  ... buffer position to assign to node (or 0)
 ***				new_child ... create a new child for parent node
 ***							  (insert an empty node into the tree)
 *** Returns:	pointer to node or NULL (success / error)
 ***				(exits on fatal error)
 **************************************************************************/
 
-struct Node *NewNode(struct SGFInfo *sgfc, struct Node *parent, U_LONG row, U_LONG col, bool new_child)
+struct Node *NewNode(struct SGFInfo *sgfc, struct Node *parent, U_LONG pos, bool new_child)
 {
 	struct Node *newn, *hlp;
 
-	newn = SaveMalloc(sizeof(struct Node), "node structure");
+	newn = ArenaAlloc(sgfc, sizeof(struct Node));
 
 	newn->parent	= parent;		/* init node structure */
 	newn->child		= NULL;
 	newn->sibling	= NULL;
+	newn->last_child = NULL;
 	newn->prop		= NULL;
 	newn->last		= NULL;
-	newn->row		= row;
-	newn->col		= col;
+	newn->pos		= pos;
+	newn->hash		= 0;
 
 	AddTail(sgfc, newn);
 
@@ -466,7 +863,9 @@ struct Node *NewNode(struct SGFInfo *sgfc, struct Node *parent, U_LONG row, U_LO
 		if(new_child)				/* insert node as new child of parent */
 		{
 			newn->child = parent->child;
+			newn->last_child = parent->last_child;
 			parent->child = newn;
+			parent->last_child = newn;
 
 			hlp = newn->child;		/* set new parent of children */
 			while(hlp)
@@ -480,12 +879,8 @@ struct Node *NewNode(struct SGFInfo *sgfc, struct Node *parent, U_LONG row, U_LO
 			if(!parent->child)			/* parent has no child? */
 				parent->child = newn;
 			else						/* parent has a child already */
-			{							/* -> insert as sibling */
-				hlp = parent->child;
-				while(hlp->sibling)
-					hlp = hlp->sibling;
-				hlp->sibling = newn;
-			}
+				parent->last_child->sibling = newn;	/* -> insert as sibling */
+			parent->last_child = newn;
 		}
 	}
 	else							/* new root node */
@@ -493,12 +888,8 @@ struct Node *NewNode(struct SGFInfo *sgfc, struct Node *parent, U_LONG row, U_LO
 		if(!sgfc->root)				/* first root? */
 			sgfc->root = newn;
 		else
-		{
-			hlp = sgfc->root;		/* root sibling */
-			while(hlp->sibling)
-				hlp = hlp->sibling;
-			hlp->sibling = newn;
-		}
+			sgfc->last_root->sibling = newn;
+		sgfc->last_root = newn;
 	}
 
 	return newn;
@@ -532,7 +923,7 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 	}
 
 	if(error != E_NO_ERROR)
-		PrintError(error, sgfc, n->row, n->col);
+		PrintError(error, sgfc, n->pos);
 
 	if(n->prop)						/* delete properties */
 	{
@@ -549,6 +940,9 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 			n->child->parent = NULL;
 		}
 
+		if(sgfc->last_root == n)
+			sgfc->last_root = n->child;	/* subsequent root: fixed below */
+
 		if(sgfc->root == n)			/* n is first root */
 		{
 			if(n->child)
@@ -580,6 +974,8 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 			else					/* delete whole gametree */
 			{
 				tiprev->root->sibling = n->sibling;
+				if(!sgfc->last_root)
+					sgfc->last_root = tiprev->root;
 				Delete(&sgfc->tree, ti);
 				if(sgfc->info == ti)
 					sgfc->info = NULL;
@@ -597,6 +993,7 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 				n->child->sibling = n->sibling;
 			}
 
+			h = NULL;
 			if(p->child == n)		/* n is first sibling */
 			{
 				if(n->child)		p->child = n->child;
@@ -611,10 +1008,14 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 				if(n->child)		h->sibling = n->child;
 				else				h->sibling = n->sibling;
 			}
+
+			if(p->last_child == n)
+				p->last_child = n->child ? n->child : h;
 		}
 		else						/* empty node has no siblings */
 		{							/* but child may have siblings */
 			p->child = n->child;
+			p->last_child = n->last_child;
 			h = n->child;
 			while(h)				/* set new parent */
 			{
@@ -625,7 +1026,60 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 	}
 
 	Delete(&sgfc->first, n);
-	free(n);
+}
+
+
+/**************************************************************************
+*** Function:	DupValueString
+***				Copies a property value string into the arena
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				value	... value string
+***				size	... length of value (excluding any 0 bytes)
+*** Returns:	pointer to \0-terminated copy
+**************************************************************************/
+
+char *DupValueString(struct SGFInfo *sgfc, const char *value, size_t size)
+{
+	/* +2 because Parse_Float may add 1 char and for trailing '\0' byte */
+	char *copy = ArenaAllocString(sgfc, size+2);
+	memcpy(copy, value, size);
+	*(copy + size) = 0;
+	return copy;
+}
+
+
+/**************************************************************************
+*** Function:	IsBufferSlice
+***				Checks if a value string points into the decoded buffer
+***				(see NewValue in load.c) instead of a private copy
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				value	... value string
+*** Returns:	true if value is a slice of the buffer
+**************************************************************************/
+
+bool IsBufferSlice(struct SGFInfo *sgfc, const char *value)
+{
+	return value && sgfc->decoded_buffer &&
+		   value >= sgfc->decoded_buffer && value < sgfc->decoded_end;
+}
+
+
+/**************************************************************************
+*** Function:	OwnPropValue
+***				Replaces buffer slices of a property value with private
+***				copies, so that the value may be modified in place.
+***				Has to be called before any in-place modification.
+*** Parameters: sgfc	... pointer to SGFInfo structure
+***				v		... property value
+*** Returns:	-
+**************************************************************************/
+
+void OwnPropValue(struct SGFInfo *sgfc, struct PropValue *v)
+{
+	if(IsBufferSlice(sgfc, v->value))
+		v->value = DupValueString(sgfc, v->value, v->value_len);
+	if(IsBufferSlice(sgfc, v->value2))
+		v->value2 = DupValueString(sgfc, v->value2, v->value2_len);
 }
 
 
@@ -634,8 +1088,7 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 ***				Adds a value to the property (inits structure etc.)
 *** Parameters: sgfc	... pointer to SGFInfo structure
 ***				p		... pointer to property
-***				row		... row number associated with property value (or 0)
-***				col		... column associated with property value (or 0)
+***				pos		... buffer position of property value (or 0)
 ***				value	... pointer to first value
 ***				size	... length of first value (excluding any 0 bytes)
 ***				value2	... pointer to second value (or NULL)
@@ -645,20 +1098,16 @@ void DelNode(struct SGFInfo *sgfc, struct Node *n, U_LONG error)
 **************************************************************************/
 
 struct PropValue *AddPropValue(struct SGFInfo *sgfc,
-							   struct Property *p, U_LONG row, U_LONG col,
+							   struct Property *p, U_LONG pos,
 							   const char *value, size_t size,
 							   const char *value2, size_t size2)
 {
-	struct PropValue *newv = SaveMalloc(sizeof(struct PropValue), "property value structure");
-	newv->row = row;
-	newv->col = col;
+	struct PropValue *newv = ArenaAlloc(sgfc, sizeof(struct PropValue));
+	newv->pos = pos;
 
 	if(value)
 	{
-		/* +2 because Parse_Float may add 1 char and for trailing '\0' byte */
-		newv->value = SaveMalloc(size+2, "property value buffer");
-		memcpy(newv->value, value, size);
-		*(newv->value + size) = 0;
+		newv->value = DupValueString(sgfc, value, size);
 		newv->value_len = size;
 	}
 	else
@@ -669,9 +1118,7 @@ struct PropValue *AddPropValue(struct SGFInfo *sgfc,
 
 	if(value2)
 	{
-		newv->value2 = SaveMalloc(size2+2, "property value2 buffer");
-		memcpy(newv->value2, value2, size2);
-		*(newv->value2 + size2) = 0;
+		newv->value2 = DupValueString(sgfc, value2, size2);
 		newv->value2_len = size2;
 	}
 	else
@@ -712,11 +1159,11 @@ struct Property *NewPropValue(struct SGFInfo *sgfc, struct Node *n, token id,
 			for(v = p->value; v; v = DelPropValue(p, v));
 	}
 	else
-		p = AddProperty(n, id, n->row, n->col, sgf_token[id].id);
+		p = AddProperty(sgfc, n, id, n->pos, sgf_token[id].id);
 
 	size1 = strlen(value);
 	size2 = value2 ? strlen(value2) : 0;
-	AddPropValue(sgfc, p, 0, 0, value, size1, value2, size2);
+	AddPropValue(sgfc, p, 0, value, size1, value2, size2);
 
 	return p;
 }
@@ -724,7 +1171,7 @@ struct Property *NewPropValue(struct SGFInfo *sgfc, struct Node *n, token id,
 
 /**************************************************************************
 *** Function:	DelPropValue
-***				Deletes a value of a property
+***				Deletes a value of a property (memory stays in arena)
 *** Parameters: p ... property to which value belongs
 ***				v ... value to be deleted
 *** Returns:	v->next
@@ -737,17 +1184,128 @@ struct PropValue *DelPropValue(struct Property *p, struct PropValue *v)
 	if (!v)
 		return NULL;
 
-	if(v->value)		free(v->value);
-	if(v->value2)		free(v->value2);
-
 	next = v->next;
 
 	Delete(&p->value, v);
-	free(v);
 	return next;
 }
 
 
+/**************************************************************************
+*** Function:	HashBytes // HashPointList // HashGameTree
+***				Calculates a hash (FNV-1a) of the contents of a game tree:
+***				tree structure, property IDs and values.
+***				Point lists are hashed as the set of their points, so that
+***				expanding a compressed list (or reordering it) while
+***				checking doesn't count as a change (option verbatim).
+*** Parameters: h		... hash so far
+***				s, len	... bytes to add
+***				p		... property with PVT_CPLIST flag
+***				root	... root node of game tree
+*** Returns:	hash value
+**************************************************************************/
+
+#define FNV_BASIS	14695981039346656037ULL
+
+static unsigned long long HashBytes(unsigned long long h, const char *s, size_t len)
+{
+	const unsigned char *c = (const unsigned char *)s;
+
+	for(; len; len--, c++)
+		h = (h ^ *c) * 1099511628211ULL;
+	return h;
+}
+
+static unsigned long long HashPointList(unsigned long long h, const struct Property *p)
+{
+	unsigned long long sum = 0, count = 0;
+	struct PropValue *v;
+	int x1, y1, x2, y2, x, y;
+	char pt[2];
+
+	for(v = p->value; v; v = v->next)
+	{
+		if(!v->value || !v->value2)
+		{
+			if(v->value)
+				sum += HashBytes(FNV_BASIS, v->value, strlen(v->value));
+			count++;
+			continue;
+		}
+		x1 = x2 = y1 = y2 = 0;
+		if(strlen(v->value) == 2 && strlen(v->value2) == 2)
+		{
+			x1 = DecodePosChar(v->value[0]);	y1 = DecodePosChar(v->value[1]);
+			x2 = DecodePosChar(v->value2[0]);	y2 = DecodePosChar(v->value2[1]);
+		}
+		if(!x1 || !y1 || !x2 || !y2 || x1 > x2 || y1 > y2 || (x1 == x2 && y1 == y2))
+		{								/* gets corrected: hash as it is */
+			sum += HashBytes(HashBytes(FNV_BASIS, v->value, strlen(v->value) + 1),
+							 v->value2, strlen(v->value2) + 1);
+			count++;
+			continue;
+		}
+		for(x = x1; x <= x2; x++)		/* same points as ExpandPointList() */
+			for(y = y1; y <= y2; y++)
+			{
+				pt[0] = EncodePosChar(x);
+				pt[1] = EncodePosChar(y);
+				sum += HashBytes(FNV_BASIS, pt, 2);
+				count++;
+			}
+	}
+	h = HashBytes(h, (const char *)&sum, sizeof(sum));
+	return HashBytes(h, (const char *)&count, sizeof(count));
+}
+
+unsigned long long HashGameTree(struct Node *root)
+{
+	unsigned long long h = FNV_BASIS;
+	struct Node *n = root;
+	struct Property *p;
+	struct PropValue *v;
+
+	while(n)
+	{
+		h = HashBytes(h, ";", 1);
+		for(p = n->prop; p; p = p->next)
+		{
+			h = HashBytes(h, (const char *)&p->id, sizeof(p->id));
+			h = HashBytes(h, p->idstr, strlen(p->idstr) + 1);
+			if(sgf_token[p->id].flags & PVT_CPLIST)
+			{
+				h = HashPointList(h, p);
+				continue;
+			}
+			for(v = p->value; v; v = v->next)
+			{
+				h = HashBytes(h, "[", 1);
+				if(v->value)			/* as written by SaveSGF(), incl. \0 */
+					h = HashBytes(h, v->value, strlen(v->value) + 1);
+				if(v->value2)
+					h = HashBytes(h, v->value2, strlen(v->value2) + 1);
+			}
+		}
+
+		if(n->child)					/* pre-order walk without stack */
+		{
+			h = HashBytes(h, "(", 1);
+			n = n->child;
+			continue;
+		}
+		while(n != root && !n->sibling)
+		{
+			h = HashBytes(h, ")", 1);
+			n = n->parent;
+		}
+		if(n == root)
+			break;
+		n = n->sibling;
+	}
+	return h;
+}
+
+
 /**************************************************************************
 *** Function:	CalcGameSig
 ***				Calculates game signature as proposed by Dave Dyer
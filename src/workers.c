@@ -0,0 +1,781 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 workers.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+*** Notes:	Batch mode: checks many files within one process.
+***			Files are handed out to a pool of worker threads, each file
+***			gets its own SGFInfo. Output of a file is buffered and
+***			printed in input order as soon as all previous files are done.
+***
+***			Parallel mode: parts of a single file (game trees) are
+***			loaded and checked by jobs on worker threads (see load.c,
+***			parse2.c). Each job works on a worker SGFInfo that records
+***			messages; MergeWorkerSGFInfo() hands out the messages and
+***			the loaded data to the SGFInfo of the file in job order.
+**************************************************************************/
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L		/* for pthreads, open_memstream(), dirent */
+#define HAVE_PTHREAD
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <setjmp.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "all.h"
+#include "protos.h"
+
+
+struct BatchFile
+{
+	char *name;
+	char *output;			/* buffered messages & status line */
+	size_t output_size;
+	int ret;				/* exit status of this file (like main()) */
+	int error_count;
+	int warning_count;
+	int critical_count;
+	int ignored_count;
+	bool done;
+};
+
+struct BatchInfo
+{
+	struct SGFInfo *sgfc;	/* options & error reporting of batch itself */
+	FILE *out;
+	struct BatchFile *files;
+	size_t num_files;
+	size_t max_files;
+	size_t next;			/* next file to be checked */
+	size_t printed;			/* files [0..printed) have been output */
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t lock;
+#endif
+};
+
+/* SGFInfo->user_data of a file checked in batch mode */
+struct BatchContext
+{
+	FILE *out;				/* output (buffer) of this file */
+	jmp_buf oom;			/* recovery point if file runs out of memory */
+};
+
+/* SGFInfo->user_data of a worker SGFInfo (parallel mode) */
+struct WorkerContext
+{
+	struct SGFInfo *sgfc;		/* SGFInfo of the file */
+	struct SGFCError *messages;	/* recorded messages */
+	size_t num_messages;
+	size_t max_messages;
+};
+
+struct WorkerPool
+{
+	void (*job)(void *, size_t);
+	void *data;
+	size_t num_jobs;
+	size_t next;			/* next job to be run */
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t lock;
+#endif
+};
+
+
+/**************************************************************************
+*** Function:	AddBatchFile
+***				Appends a file to the list of files to be checked
+*** Parameters: batch ... pointer to BatchInfo
+***				name  ... filename
+*** Returns:	-
+**************************************************************************/
+
+static void AddBatchFile(struct BatchInfo *batch, const char *name)
+{
+	struct BatchFile *file;
+
+	if(batch->num_files == batch->max_files)
+		batch->files = GrowStack(batch->sgfc, batch->files, &batch->max_files, sizeof(struct BatchFile));
+
+	file = &batch->files[batch->num_files++];
+	memset(file, 0, sizeof(struct BatchFile));
+	file->name = SaveDupString(batch->sgfc, name, 0, "batch filename");
+}
+
+
+/**************************************************************************
+*** Function:	AddListFile
+***				Adds all files listed in a list file (one per line)
+*** Parameters: batch ... pointer to BatchInfo
+***				name  ... filename of list file
+*** Returns:	true on success / false if list file could not be read
+**************************************************************************/
+
+static bool AddListFile(struct BatchInfo *batch, const char *name)
+{
+	char line[FILENAME_MAX + 2];
+	size_t len;
+	FILE *list;
+
+	if(!(list = fopen(name, "r")))
+	{
+		PrintError(FE_SOURCE_OPEN, batch->sgfc, name);
+		return false;
+	}
+
+	while(fgets(line, sizeof(line), list))
+	{
+		len = strlen(line);
+		while(len && isspace((unsigned char)line[len-1]))
+			line[--len] = 0;
+		if(len)
+			AddBatchFile(batch, line);
+	}
+
+	if(ferror(list))
+	{
+		PrintError(FE_SOURCE_READ, batch->sgfc, name);
+		fclose(list);
+		return false;
+	}
+	fclose(list);
+	return true;
+}
+
+
+#ifdef HAVE_PTHREAD
+
+static int CompareBatchFiles(const void *a, const void *b)
+{
+	return strcmp(((const struct BatchFile *)a)->name, ((const struct BatchFile *)b)->name);
+}
+
+
+/**************************************************************************
+*** Function:	AddDirectory
+***				Adds all *.sgf files of a directory and its subdirectories.
+***				Symbolic links to directories are not followed (loops).
+*** Parameters: batch ... pointer to BatchInfo
+***				name  ... directory name
+*** Returns:	true on success / false if directory could not be read
+**************************************************************************/
+
+static bool AddDirectory(struct BatchInfo *batch, const char *name)
+{
+	struct dirent *entry;
+	struct stat st;
+	size_t len;
+	char *path;
+	bool result = true;
+	DIR *dir;
+
+	if(!(dir = opendir(name)))
+	{
+		PrintError(FE_SOURCE_OPEN, batch->sgfc, name);
+		return false;
+	}
+
+	while(result && (entry = readdir(dir)))
+	{
+		if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		len = strlen(entry->d_name);
+		path = SaveMalloc(batch->sgfc, strlen(name) + len + 2, "batch filename");
+		sprintf(path, "%s/%s", name, entry->d_name);
+
+		/* lstat(): symlinked directories would queue files repeatedly */
+		if(!lstat(path, &st))
+		{
+			if(S_ISDIR(st.st_mode))
+				result = AddDirectory(batch, path);
+			else if(len > 4 && !strcmp(&entry->d_name[len-4], ".sgf") &&
+					(S_ISREG(st.st_mode) ||
+					 (S_ISLNK(st.st_mode) && !stat(path, &st) && S_ISREG(st.st_mode))))
+				AddBatchFile(batch, path);
+		}
+		free(path);
+	}
+
+	closedir(dir);
+	return result;
+}
+
+#endif
+
+
+/**************************************************************************
+*** Function:	CollectBatchFiles
+***				Expands the batch arguments into a list of files:
+***				@listfile, directory, or plain filename
+*** Parameters: batch ... pointer to BatchInfo
+*** Returns:	true on success / false on fatal error
+**************************************************************************/
+
+static bool CollectBatchFiles(struct BatchInfo *batch)
+{
+	const struct SGFCOptions *options = batch->sgfc->options;
+	const char *arg;
+	int i;
+
+	for(i = 0; i < options->batch_count; i++)
+	{
+		arg = options->batch_files[i];
+		if(*arg == '@')
+		{
+			if(!AddListFile(batch, arg+1))
+				return false;
+			continue;
+		}
+#ifdef HAVE_PTHREAD
+		struct stat st;
+		size_t start = batch->num_files;
+		if(!stat(arg, &st) && S_ISDIR(st.st_mode))
+		{
+			if(!AddDirectory(batch, arg))
+				return false;
+			/* readdir() order is arbitrary */
+			qsort(&batch->files[start], batch->num_files - start,
+				  sizeof(struct BatchFile), CompareBatchFiles);
+			continue;
+		}
+#endif
+		AddBatchFile(batch, arg);
+	}
+	return true;
+}
+
+
+/**************************************************************************
+*** Function:	BatchErrorOutputHook
+***				Writes error messages into the output of the file
+*** Parameters: sgfc  ... pointer to SGFInfo of file
+***				error ... structure that contains error information
+*** Returns:	-
+**************************************************************************/
+
+static void BatchErrorOutputHook(struct SGFInfo *sgfc, struct SGFCError *error)
+{
+	CommonPrintErrorOutputHook(error, ((struct BatchContext *)sgfc->user_data)->out);
+}
+
+
+/**************************************************************************
+*** Function:	BatchOOMHook
+***				Out-of-memory policy in batch mode: gives up on the
+***				current file only; the other files are still checked
+*** Parameters: sgfc   ... pointer to SGFInfo of file
+***				detail ... error message
+*** Returns:	does not return
+**************************************************************************/
+
+static void BatchOOMHook(struct SGFInfo *sgfc, const char *detail)
+{
+	longjmp(((struct BatchContext *)sgfc->user_data)->oom, 1);
+}
+
+
+/**************************************************************************
+*** Function:	CheckBatchFile
+***				Loads and checks one file with its own SGFInfo
+*** Parameters: batch		... pointer to BatchInfo
+***				file		... file to be checked (result is stored here)
+***				out			... output stream for this file
+***				iconv_cache ... iconv descriptors of the calling thread
+*** Returns:	-
+**************************************************************************/
+
+static void CheckBatchFile(struct BatchInfo *batch, struct BatchFile *file, FILE *out,
+						   struct IConvCache *iconv_cache)
+{
+	struct SGFCOptions *options;
+	struct SGFInfo *sgfc;
+	struct BatchContext ctx;
+
+	options = SaveMalloc(batch->sgfc, sizeof(struct SGFCOptions), "SGFC options");
+	memcpy(options, batch->sgfc->options, sizeof(struct SGFCOptions));
+	options->infile = file->name;
+	options->outfile = NULL;
+	options->interactive = false;
+	options->parallel = false;			/* files are checked in parallel already */
+	options->batch_files = NULL;
+	options->batch_count = 0;
+	sgfc = SetupSGFInfo(options);
+	ShareIConvCache(sgfc, iconv_cache);
+
+	ctx.out = out;
+	sgfc->user_data = &ctx;
+	sgfc->print_error_handler = batch->sgfc->print_error_handler;
+	if(batch->sgfc->print_error_output_hook)
+		sgfc->print_error_output_hook = BatchErrorOutputHook;
+	else
+		sgfc->print_error_output_hook = NULL;
+	sgfc->oom_panic_hook = BatchOOMHook;
+
+	if(setjmp(ctx.oom))
+	{
+		/* memory of temporary buffers may be lost; SGFInfo can be freed */
+		file->ret = 20;
+		fprintf(out, "%s: fatal error (out of memory)\n", file->name);
+	}
+	else if(LoadSGF(sgfc, file->name) && ParseSGF(sgfc))
+	{
+		if(sgfc->options->game_signature)
+			PrintGameSignatures(sgfc, out);
+		if(sgfc->options->position_hashes)
+			PrintPositionHashes(sgfc, out);
+
+		if(sgfc->error_count)			file->ret = 10;
+		else if(sgfc->warning_count)	file->ret = 5;
+		else							file->ret = 0;
+
+		PrintStatusLine(sgfc, out);
+	}
+	else
+	{
+		file->ret = 20;
+		fprintf(out, "%s: fatal error\n", file->name);
+	}
+
+	file->error_count = sgfc->error_count;
+	file->warning_count = sgfc->warning_count;
+	file->critical_count = sgfc->critical_count;
+	file->ignored_count = sgfc->ignored_count;
+	FreeSGFInfo(sgfc);
+}
+
+
+/**************************************************************************
+*** Function:	PrintBatchSummary
+***				Prints combined status line for all files of the batch
+*** Parameters: batch ... pointer to BatchInfo
+*** Returns:	-
+**************************************************************************/
+
+static void PrintBatchSummary(const struct BatchInfo *batch)
+{
+	int errors = 0, warnings = 0, critical = 0, ignored = 0;
+	size_t i, ok = 0, fatal = 0;
+
+	for(i = 0; i < batch->num_files; i++)
+	{
+		errors += batch->files[i].error_count;
+		warnings += batch->files[i].warning_count;
+		critical += batch->files[i].critical_count;
+		ignored += batch->files[i].ignored_count;
+		if(!batch->files[i].ret)			ok++;
+		else if(batch->files[i].ret == 20)	fatal++;
+	}
+
+	fprintf(batch->out, "%lu file(s): ", (U_LONG)batch->num_files);
+
+	if(errors || warnings)
+	{
+		if(errors)
+			fprintf(batch->out, "%d error(s)  ", errors);
+		if(warnings)
+			fprintf(batch->out, "%d warning(s)  ", warnings);
+		if(critical)
+			fprintf(batch->out, "(critical:%d)  ", critical);
+	}
+
+	fprintf(batch->out, "%lu OK  ", (U_LONG)ok);
+	if(fatal)
+		fprintf(batch->out, "%lu fatal  ", (U_LONG)fatal);
+	if(ignored)
+		fprintf(batch->out, "(%d message(s) ignored)", ignored);
+
+	fprintf(batch->out, "\n");
+}
+
+
+/**************************************************************************
+*** Function:	NumWorkerThreads
+***				Number of worker threads (option --threads=n)
+*** Parameters: sgfc ... pointer to SGFInfo (options)
+*** Returns:	number of threads (1 if threads aren't supported)
+**************************************************************************/
+
+size_t NumWorkerThreads(const struct SGFInfo *sgfc)
+{
+#ifdef HAVE_PTHREAD
+	size_t num_threads = (size_t)sgfc->options->threads;
+
+	if(!num_threads)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = cpus > 0 ? (size_t)cpus : 1;
+	}
+	if(num_threads > MAX_THREADS)
+		num_threads = MAX_THREADS;
+	return num_threads;
+#else
+	return 1;
+#endif
+}
+
+
+#ifdef HAVE_PTHREAD
+
+/**************************************************************************
+*** Function:	BatchWorker
+***				Thread main: checks files until none are left;
+***				prints finished output in input order
+*** Parameters: arg ... pointer to BatchInfo
+*** Returns:	NULL
+**************************************************************************/
+
+static void *BatchWorker(void *arg)
+{
+	struct BatchInfo *batch = arg;
+	struct BatchFile *file;
+	struct IConvCache *iconv_cache = SetupIConvCache(batch->sgfc);	/* for all files of thread */
+	FILE *out;
+	size_t i;
+
+	while(true)
+	{
+		pthread_mutex_lock(&batch->lock);
+		i = batch->next++;
+		pthread_mutex_unlock(&batch->lock);
+		if(i >= batch->num_files)
+			break;
+
+		file = &batch->files[i];
+		if(!(out = open_memstream(&file->output, &file->output_size)))
+			OutOfMemory(batch->sgfc, "batch output buffer");
+		CheckBatchFile(batch, file, out, iconv_cache);
+		fclose(out);
+
+		pthread_mutex_lock(&batch->lock);
+		file->done = true;
+		while(batch->printed < batch->num_files && batch->files[batch->printed].done)
+		{
+			file = &batch->files[batch->printed++];
+			fwrite(file->output, 1, file->output_size, batch->out);
+			free(file->output);
+			file->output = NULL;
+		}
+		fflush(batch->out);
+		pthread_mutex_unlock(&batch->lock);
+	}
+
+	FreeIConvCache(iconv_cache);
+	return NULL;
+}
+
+#endif
+
+
+/**************************************************************************
+*** Function:	RunBatch
+***				Checks all files of the batch (options->batch_files)
+***				on options->threads worker threads. No output files
+***				are written.
+*** Parameters: sgfc ... pointer to SGFInfo (options)
+***				out  ... output stream for messages and status lines
+*** Returns:	highest exit status of all files (see main())
+**************************************************************************/
+
+int RunBatch(struct SGFInfo *sgfc, FILE *out)
+{
+	struct BatchInfo batch;
+	size_t i;
+	int ret = 0;
+
+	memset(&batch, 0, sizeof(batch));
+	batch.sgfc = sgfc;
+	batch.out = out;
+
+	if(!sgfc->options->batch_count)
+	{
+		PrintError(FE_MISSING_SOURCE_FILE, sgfc);
+		return 20;
+	}
+	if(!CollectBatchFiles(&batch))
+		ret = 20;
+	else
+	{
+#ifdef HAVE_PTHREAD
+		pthread_t threads[MAX_THREADS];
+		size_t num_threads = NumWorkerThreads(sgfc);
+
+		if(num_threads > batch.num_files)	num_threads = batch.num_files;
+
+		pthread_mutex_init(&batch.lock, NULL);
+
+		for(i = 0; i < num_threads; i++)
+			if(pthread_create(&threads[i], NULL, BatchWorker, &batch))
+				break;
+		if(!i)								/* no thread at all? */
+			BatchWorker(&batch);
+		while(i)
+			pthread_join(threads[--i], NULL);
+
+		pthread_mutex_destroy(&batch.lock);
+#else
+		struct IConvCache *iconv_cache = SetupIConvCache(sgfc);
+
+		for(i = 0; i < batch.num_files; i++)	/* sequential: no buffering */
+			CheckBatchFile(&batch, &batch.files[i], out, iconv_cache);
+		FreeIConvCache(iconv_cache);
+#endif
+		for(i = 0; i < batch.num_files; i++)
+			if(batch.files[i].ret > ret)
+				ret = batch.files[i].ret;
+		PrintBatchSummary(&batch);
+	}
+
+	for(i = 0; i < batch.num_files; i++)
+		free(batch.files[i].name);
+	free(batch.files);
+	return ret;
+}
+
+
+#ifdef HAVE_PTHREAD
+
+/**************************************************************************
+*** Function:	PoolWorker
+***				Thread main of RunWorkers(): runs jobs until none are left
+*** Parameters: arg ... pointer to WorkerPool
+*** Returns:	NULL
+**************************************************************************/
+
+static void *PoolWorker(void *arg)
+{
+	struct WorkerPool *pool = arg;
+	size_t i;
+
+	while(true)
+	{
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		if(i >= pool->num_jobs)
+			break;
+		(*pool->job)(pool->data, i);
+	}
+
+	return NULL;
+}
+
+#endif
+
+
+/**************************************************************************
+*** Function:	RunWorkers
+***				Runs job(data, i) for all i in [0, num_jobs) on
+***				options->threads worker threads and waits until all
+***				jobs are done. Jobs are started in ascending order.
+*** Parameters: sgfc	 ... pointer to SGFInfo (options)
+***				num_jobs ... number of jobs
+***				job		 ... job function
+***				data	 ... passed on to job function
+*** Returns:	-
+**************************************************************************/
+
+void RunWorkers(struct SGFInfo *sgfc, size_t num_jobs, void (*job)(void *, size_t), void *data)
+{
+	struct WorkerPool pool;
+	size_t i;
+
+	pool.job = job;
+	pool.data = data;
+	pool.num_jobs = num_jobs;
+	pool.next = 0;
+
+#ifdef HAVE_PTHREAD
+	pthread_t threads[MAX_THREADS];
+	size_t num_threads = NumWorkerThreads(sgfc);
+
+	if(num_threads > num_jobs)
+		num_threads = num_jobs;
+
+	pthread_mutex_init(&pool.lock, NULL);
+
+	for(i = 0; i < num_threads; i++)
+		if(pthread_create(&threads[i], NULL, PoolWorker, &pool))
+			break;
+	if(!i)								/* no thread at all? */
+		PoolWorker(&pool);
+	while(i)
+		pthread_join(threads[--i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+#else
+	for(i = 0; i < num_jobs; i++)
+		(*job)(data, i);
+#endif
+}
+
+
+/**************************************************************************
+*** Function:	WorkerErrorOutputHook
+***				Records a message of a worker SGFInfo
+***				(see MergeWorkerSGFInfo)
+*** Parameters: worker ... pointer to worker SGFInfo
+***				error  ... structure that contains error information
+*** Returns:	-
+**************************************************************************/
+
+static void WorkerErrorOutputHook(struct SGFInfo *worker, struct SGFCError *error)
+{
+	struct WorkerContext *ctx = worker->user_data;
+	struct SGFCError *copy;
+
+	if(ctx->num_messages == ctx->max_messages)
+		ctx->messages = GrowStack(worker, ctx->messages, &ctx->max_messages, sizeof(struct SGFCError));
+
+	copy = &ctx->messages[ctx->num_messages++];
+	*copy = *error;
+	copy->message = SaveDupString(worker, error->message, 0, "error message");
+}
+
+
+/**************************************************************************
+*** Function:	WorkerOOMHook
+***				Out-of-memory policy of a worker: that of the file
+*** Parameters: worker ... pointer to worker SGFInfo
+***				detail ... error message
+*** Returns:	does not return
+**************************************************************************/
+
+static void WorkerOOMHook(struct SGFInfo *worker, const char *detail)
+{
+	OutOfMemory(((struct WorkerContext *)worker->user_data)->sgfc, detail);
+}
+
+
+/**************************************************************************
+*** Function:	SetupWorkerSGFInfo
+***				Creates an SGFInfo for a job working on a part of a file.
+***				Options and the decoded buffer are shared (read-only),
+***				messages are recorded instead of printed.
+*** Parameters: sgfc ... pointer to SGFInfo of file
+*** Returns:	pointer to worker SGFInfo
+**************************************************************************/
+
+struct SGFInfo *SetupWorkerSGFInfo(struct SGFInfo *sgfc)
+{
+	struct SGFInfo *worker = SetupSGFInfo(sgfc->options);
+	struct WorkerContext *ctx = SaveCalloc(sgfc, sizeof(struct WorkerContext), "worker context");
+
+	ctx->sgfc = sgfc;
+	worker->user_data = ctx;
+	worker->print_error_handler = sgfc->print_error_handler;
+	if(sgfc->print_error_output_hook)
+		worker->print_error_output_hook = WorkerErrorOutputHook;
+	else
+		worker->print_error_output_hook = NULL;
+	worker->oom_panic_hook = WorkerOOMHook;
+
+	worker->decoded_buffer = sgfc->decoded_buffer;
+	worker->decoded_end = sgfc->decoded_end;
+	return worker;
+}
+
+
+/**************************************************************************
+*** Function:	FreeWorkerSGFInfo
+***				Frees a worker SGFInfo (and everything it loaded)
+*** Parameters: worker ... pointer to worker SGFInfo
+*** Returns:	-
+**************************************************************************/
+
+void FreeWorkerSGFInfo(struct SGFInfo *worker)
+{
+	struct WorkerContext *ctx = worker->user_data;
+	size_t i;
+
+	for(i = 0; i < ctx->num_messages; i++)
+		free((char *)ctx->messages[i].message);
+	free(ctx->messages);
+	free(ctx);
+
+	worker->options = NULL;				/* shared with SGFInfo of file */
+	worker->decoded_buffer = NULL;
+	FreeSGFInfo(worker);
+}
+
+
+/**************************************************************************
+*** Function:	MergeWorkerSGFInfo
+***				Hands out the recorded messages of a worker to the output
+***				hook of the file and adds the message counts. Nodes, root
+***				nodes, source trees and arena memory are taken over.
+***				Frees the worker.
+*** Parameters: sgfc   ... pointer to SGFInfo of file
+***				worker ... pointer to worker SGFInfo
+***				row	   ... row & column where the position index of
+***				col		   the worker started at (1,1 if absolute)
+*** Returns:	-
+**************************************************************************/
+
+void MergeWorkerSGFInfo(struct SGFInfo *sgfc, struct SGFInfo *worker, U_LONG row, U_LONG col)
+{
+	struct WorkerContext *ctx = worker->user_data;
+	struct SGFCError *error;
+	size_t i;
+
+	for(i = 0; i < ctx->num_messages; i++)
+	{
+		error = &ctx->messages[i];
+		if(error->row)					/* relative -> absolute position */
+		{
+			if(error->row == 1)
+				error->col += col - 1;
+			error->row += row - 1;
+		}
+		if(sgfc->print_error_output_hook)
+			(*sgfc->print_error_output_hook)(sgfc, error);
+	}
+
+	sgfc->error_count += worker->error_count;
+	sgfc->warning_count += worker->warning_count;
+	sgfc->critical_count += worker->critical_count;
+	sgfc->ignored_count += worker->ignored_count;
+
+	if(worker->first)					/* append node list */
+	{
+		if(sgfc->tail)
+		{
+			sgfc->tail->next = worker->first;
+			worker->first->prev = sgfc->tail;
+		}
+		else
+			sgfc->first = worker->first;
+		sgfc->tail = worker->tail;
+	}
+
+	if(worker->root)					/* append game trees */
+	{
+		if(sgfc->root)
+			sgfc->last_root->sibling = worker->root;
+		else
+			sgfc->root = worker->root;
+		sgfc->last_root = worker->last_root;
+	}
+
+	for(i = 0; i < worker->_num_source; i++)	/* append source trees */
+	{
+		if(sgfc->_num_source == sgfc->_max_source)
+			sgfc->_source = GrowStack(sgfc, sgfc->_source, &sgfc->_max_source, sizeof(struct SourceTree));
+		sgfc->_source[sgfc->_num_source++] = worker->_source[i];
+	}
+
+	MergeMemArena(sgfc->_arena, worker->_arena);
+	worker->_arena = NULL;
+	FreeWorkerSGFInfo(worker);
+}
@@ -0,0 +1,152 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 tests/batch.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L		/* for mkdtemp(), symlink() */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "test-common.h"
+
+
+static const char *batch_test_files[] =
+{
+	"../test-files/test.sgf", "../test-files/strict.sgf",
+	"../test-files/reorder.sgf", "../test-files/escaping.sgf"
+};
+
+static void SetupBatch(int copies, int threads)
+{
+	int i;
+
+	sgfc->options->batch = true;
+	sgfc->options->threads = threads;
+	sgfc->options->batch_count = copies * 4;
+	sgfc->options->batch_files = SaveMalloc(NULL, sizeof(const char *) * (size_t)copies * 4, "batch files");
+	for(i = 0; i < copies * 4; i++)
+		sgfc->options->batch_files[i] = batch_test_files[i % 4];
+}
+
+static char *RunBatchToBuffer(int *ret)
+{
+	FILE *out = tmpfile();
+	char *buffer;
+	long size;
+
+	*ret = RunBatch(sgfc, out);
+	size = ftell(out);
+	buffer = SaveMalloc(NULL, (size_t)size + 1, "batch output");
+	rewind(out);
+	ck_assert_uint_eq(fread(buffer, 1, (size_t)size, out), (size_t)size);
+	buffer[size] = 0;
+	fclose(out);
+	return buffer;
+}
+
+
+START_TEST (test_batch_threads)
+{
+	char *single, *multi;
+	int ret;
+
+	sgfc->print_error_handler = PrintErrorHandler;
+	SetupBatch(4, 1);
+	single = RunBatchToBuffer(&ret);
+	ck_assert_int_eq(ret, 10);
+	ck_assert_ptr_ne(strstr(single, "../test-files/strict.sgf: OK"), NULL);
+	ck_assert_ptr_ne(strstr(single, "\n16 file(s): "), NULL);
+
+	sgfc->options->threads = 4;
+	multi = RunBatchToBuffer(&ret);
+	ck_assert_int_eq(ret, 10);
+	ck_assert_str_eq(single, multi);		/* output is in input order */
+	free(single);
+	free(multi);
+}
+END_TEST
+
+
+START_TEST (test_batch_missing_file)
+{
+	char *output;
+	int ret;
+
+	SetupBatch(1, 2);
+	sgfc->options->batch_files[1] = "../test-files/does-not-exist.sgf";
+	output = RunBatchToBuffer(&ret);
+	ck_assert_int_eq(ret, 20);
+	ck_assert_ptr_ne(strstr(output, "does-not-exist.sgf: fatal error\n"), NULL);
+	ck_assert_ptr_ne(strstr(output, "1 fatal"), NULL);
+	free(output);
+}
+END_TEST
+
+
+START_TEST (test_batch_directory)
+{
+	char *output;
+	int ret;
+
+	SetupBatch(1, 3);
+	sgfc->options->batch_count = 1;
+	sgfc->options->batch_files[0] = "../test-files";
+	output = RunBatchToBuffer(&ret);
+	ck_assert_int_eq(ret, 20);			/* mixed-encoding.sgf needs -E2 */
+	/* files of a directory are sorted */
+	ck_assert(strstr(output, "escaping-result.sgf: ") < strstr(output, "escaping.sgf: "));
+	ck_assert(strstr(output, "strict.sgf: ") < strstr(output, "test-result.sgf: "));
+	free(output);
+}
+END_TEST
+
+
+START_TEST (test_batch_directory_symlink_loop)
+{
+	char dir[] = "/tmp/sgfc-batch-XXXXXX", file[64], link[64];
+	char *output;
+	FILE *fp;
+	int ret;
+
+	ck_assert_ptr_ne(mkdtemp(dir), NULL);
+	sprintf(file, "%s/a.sgf", dir);
+	sprintf(link, "%s/loop", dir);
+	fp = fopen(file, "w");
+	ck_assert_ptr_ne(fp, NULL);
+	fputs("(;FF[4]GM[1]SZ[19])", fp);
+	fclose(fp);
+	ck_assert_int_eq(symlink(".", link), 0);
+
+	SetupBatch(1, 2);
+	sgfc->options->batch_count = 1;
+	sgfc->options->batch_files[0] = dir;
+	output = RunBatchToBuffer(&ret);
+	ck_assert_int_eq(ret, 0);
+	ck_assert_ptr_ne(strstr(output, "\n1 file(s): "), NULL);
+	free(output);
+
+	unlink(link);
+	unlink(file);
+	rmdir(dir);
+}
+END_TEST
+
+
+TCase *sgfc_tc_batch(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("batch");
+	tcase_add_checked_fixture(tc, common_setup, common_teardown);
+
+	tcase_add_test(tc, test_batch_threads);
+	tcase_add_test(tc, test_batch_missing_file);
+	tcase_add_test(tc, test_batch_directory);
+	tcase_add_test(tc, test_batch_directory_symlink_loop);
+	return tc;
+}
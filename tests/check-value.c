@@ -62,6 +62,66 @@ START_TEST (test_composed_value_removed)
 END_TEST
 
 
+START_TEST (test_values_slice_buffer)
+{
+	char buffer[] = "(;FF[4]SZ[19]AB[bb:cc]C[plain text]\n;B[aa];W[a b]C[two\nlines]LB[dd:x])";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	ParseSGF(sgfc);
+
+	/* unchanged values point into the decoded buffer */
+	struct PropValue *v = FindProperty(sgfc->root->child, TKN_B)->value;
+	ck_assert(IsBufferSlice(sgfc, v->value));
+	ck_assert_str_eq(v->value, "aa");
+	v = FindProperty(sgfc->root, TKN_C)->value;
+	ck_assert(IsBufferSlice(sgfc, v->value));
+	ck_assert_str_eq(v->value, "plain text");
+	v = FindProperty(sgfc->root, TKN_AB)->value;
+	ck_assert(!IsBufferSlice(sgfc, v->value));	/* expanded point list */
+
+	/* rewritten values are private copies */
+	v = FindProperty(sgfc->root->child->child, TKN_W)->value;
+	ck_assert(!IsBufferSlice(sgfc, v->value));
+	ck_assert_str_eq(v->value, "ab");
+	v = FindProperty(sgfc->root->child->child, TKN_C)->value;
+	ck_assert(!IsBufferSlice(sgfc, v->value));
+	ck_assert_str_eq(v->value, "two\nlines");
+
+	/* the decoded buffer itself is only changed at value ends */
+	const char *c = sgfc->decoded_buffer;
+	ck_assert(!strncmp(c, "(;FF[4", 6));
+	ck_assert_int_eq(c[6], 0);
+	ck_assert(!strncmp(c + 43, "W[a b", 5));
+	ck_assert(!strncmp(c + 51, "two\nlines", 9));
+	ck_assert(!IsBufferSlice(sgfc, buffer));
+	ck_assert_str_eq(buffer + 43, "W[a b]C[two\nlines]LB[dd:x])");
+}
+END_TEST
+
+
+/* deleted values get the parser's result (e.g. empty), like parsing in place */
+START_TEST (test_deleted_value_emptied)
+{
+	char buffer[] = "(;FF[4]CA[\xff]GM[1])";
+	struct Property *p;
+	struct PropValue *v;
+
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+
+	p = FindProperty(sgfc->root, TKN_CA);
+	v = p->value;
+	ck_assert_int_eq(Check_Value(sgfc, p, v, 0, Parse_Charset), false);
+	ck_assert_str_eq(v->value, "");
+	ck_assert_uint_eq(v->value_len, 0);
+}
+END_TEST
+
+
 TCase *sgfc_tc_check_value(void)
 {
 	TCase *tc;
@@ -71,5 +131,7 @@ TCase *sgfc_tc_check_value(void)
 
 	tcase_add_test(tc, test_composed_value_check);
 	tcase_add_test(tc, test_composed_value_removed);
+	tcase_add_test(tc, test_values_slice_buffer);
+	tcase_add_test(tc, test_deleted_value_emptied);
 	return tc;
 }
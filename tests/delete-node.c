@@ -7,11 +7,28 @@
 ***
 **************************************************************************/
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "test-common.h"
 
 
+/* checks last_child/last_root of all nodes against the sibling chains */
+static void VerifyLastChild(void)
+{
+	struct Node *n, *h;
+
+	for(n = sgfc->first; n; n = n->next)
+	{
+		for(h = n->child; h && h->sibling; h = h->sibling);
+		ck_assert_ptr_eq(h, n->last_child);
+	}
+	for(h = sgfc->root; h && h->sibling; h = h->sibling);
+	ck_assert_ptr_eq(h, sgfc->last_root);
+}
+
+
 START_TEST (test_delete_leaf_node)
 {
 	char buffer[] = "(;N[a];)";
@@ -22,6 +39,7 @@ START_TEST (test_delete_leaf_node)
 
 	sgfc->options->del_empty_nodes = true;
 	ParseSGF(sgfc);
+	VerifyLastChild();
 	ck_assert_ptr_eq(NULL, sgfc->root->child);
 }
 END_TEST
@@ -37,6 +55,7 @@ START_TEST (test_delete_middle_node)
 
 	sgfc->options->del_empty_nodes = true;
 	ParseSGF(sgfc);
+	VerifyLastChild();
 	ck_assert_ptr_eq(NULL, sgfc->root->child->child);
 	ck_assert_str_eq("b", sgfc->root->child->prop->value->value);
 }
@@ -53,6 +72,7 @@ START_TEST (test_delete_root_node)
 
 	sgfc->options->del_empty_nodes = true;
 	ParseSGF(sgfc);
+	VerifyLastChild();
 	ck_assert_ptr_eq(NULL, sgfc->root->child);
 	ck_assert_str_eq("b", sgfc->root->prop->value->value);
 }
@@ -69,6 +89,7 @@ START_TEST (test_delete_with_sibling)
 	InitAllTreeInfo(sgfc);	/* necessary for SaveSGF */
 
 	DelNode(sgfc, sgfc->root->child, E_NO_ERROR);
+	VerifyLastChild();
 
 	expected_output = "(;FF[4]CA[UTF-8]GM[1]SZ[19]N[a]\n(;N[c])\n(;N[d]))\n";
 	SaveSGF(sgfc, SetupSaveTestIO, "outfile");
@@ -86,6 +107,7 @@ START_TEST (test_delete_replace_with_sibling)
 	InitAllTreeInfo(sgfc);	/* necessary for SaveSGF */
 
 	DelNode(sgfc, sgfc->root->child, E_NO_ERROR);
+	VerifyLastChild();
 
 	expected_output = "(;FF[4]CA[UTF-8]GM[1]SZ[19]N[a];N[d])\n";
 	SaveSGF(sgfc, SetupSaveTestIO, "outfile");
@@ -103,6 +125,7 @@ START_TEST (test_delete_fails)
 	InitAllTreeInfo(sgfc);	/* necessary for SaveSGF */
 
 	DelNode(sgfc, sgfc->root->child, E_NO_ERROR);
+	VerifyLastChild();
 
 	expected_output = "(;FF[4]CA[UTF-8]GM[1]SZ[19]N[a]\n(;N[b]\n(;N[c1])\n(;N[c2]))\n(;N[d]))\n";
 	SaveSGF(sgfc, SetupSaveTestIO, "outfile");
@@ -110,6 +133,134 @@ START_TEST (test_delete_fails)
 END_TEST
 
 
+START_TEST (test_delete_last_sibling)
+{
+	char buffer[] = "(;N[a](;N[b])(;N[c])(;N[d]))";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	InitAllTreeInfo(sgfc);	/* necessary for SaveSGF */
+	VerifyLastChild();
+
+	DelNode(sgfc, sgfc->root->child->sibling->sibling, E_NO_ERROR);
+	VerifyLastChild();
+	NewPropValue(sgfc, NewNode(sgfc, sgfc->root, 0, false), TKN_N, "e", NULL, false);
+	VerifyLastChild();
+
+	expected_output = "(;FF[4]CA[UTF-8]GM[1]SZ[19]N[a]\n(;N[b])\n(;N[c])\n(;N[e]))\n";
+	SaveSGF(sgfc, SetupSaveTestIO, "outfile");
+}
+END_TEST
+
+
+START_TEST (test_delete_last_root)
+{
+	char buffer[] = "(;N[a])(;N[b])(;)";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	InitAllTreeInfo(sgfc);
+	VerifyLastChild();
+
+	DelNode(sgfc, sgfc->last_root, E_NO_ERROR);
+	VerifyLastChild();
+	ck_assert_str_eq("b", sgfc->last_root->prop->value->value);
+	DelNode(sgfc, sgfc->root, E_NO_ERROR);
+	VerifyLastChild();
+	ck_assert_ptr_eq(sgfc->root, sgfc->last_root);
+}
+END_TEST
+
+
+START_TEST (test_reorder_variations_last_child)
+{
+	char buffer[] = "(;N[a](;N[b])(;N[c])(;N[d](;N[e])(;N[f])))";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+
+	sgfc->options->reorder_variations = true;
+	ParseSGF(sgfc);
+	VerifyLastChild();
+	ck_assert_str_eq("b", sgfc->root->last_child->prop->value->value);
+}
+END_TEST
+
+
+/* deep trees must not run into native stack limits (1M nodes main line) */
+START_TEST (test_deep_main_line)
+{
+	const int num = 1000000;
+	char *buffer = malloc(num * 7 + 16), *b = buffer;
+	struct Node *n;
+	int i;
+
+	b += sprintf(b, "(;GM[1]");
+	for(i = 0; i < num; i++)
+		b += sprintf(b, i % 10 == 9 ? ";" : (i % 2 ? ";W[bb]" : ";B[aa]"));
+	b += sprintf(b, ")");
+	sgfc->buffer = buffer;
+	sgfc->b_end = b;
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+
+	sgfc->options->del_empty_nodes = true;
+	sgfc->options->strict_checking = true;
+	sgfc->options->fix_variation = true;
+	sgfc->options->reorder_variations = true;
+	ParseSGF(sgfc);
+	for(i = 0, n = sgfc->root->child; n; n = n->child)
+		i++;
+	ck_assert_int_eq(i, num - num/10);
+
+	expected_output = NULL;
+	ret = SaveSGF(sgfc, SetupSaveTestIO, "outfile");
+	ck_assert_int_eq(ret, true);
+	free(buffer);
+}
+END_TEST
+
+
+/* deep trees must not run into native stack limits (10k nested variations) */
+START_TEST (test_deep_variations)
+{
+	const int num = 10000;
+	char *buffer = malloc(num * 22 + 32), *b = buffer;
+	struct Node *n;
+	int i;
+
+	b += sprintf(b, "(;GM[1];B[aa]");
+	for(i = 0; i < num; i++)
+		b += sprintf(b, "(;W[bb];B[cc]");
+	for(i = 0; i < num; i++)
+		b += sprintf(b, "(;W[dd]))");
+	b += sprintf(b, ")");
+	sgfc->buffer = buffer;
+	sgfc->b_end = b;
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+
+	sgfc->options->del_empty_nodes = true;
+	sgfc->options->strict_checking = true;
+	sgfc->options->fix_variation = true;
+	sgfc->options->reorder_variations = true;
+	ParseSGF(sgfc);
+	VerifyLastChild();
+	for(i = 0, n = sgfc->first; n; n = n->next)
+		i++;
+	ck_assert_int_eq(i, 3 * num + 2);
+
+	expected_output = NULL;
+	ret = SaveSGF(sgfc, SetupSaveTestIO, "outfile");
+	ck_assert_int_eq(ret, true);
+	free(buffer);
+}
+END_TEST
+
+
 TCase *sgfc_tc_delete_node(void)
 {
 	TCase *tc;
@@ -123,5 +274,10 @@ TCase *sgfc_tc_delete_node(void)
 	tcase_add_test(tc, test_delete_with_sibling);
 	tcase_add_test(tc, test_delete_replace_with_sibling);
 	tcase_add_test(tc, test_delete_fails);
+	tcase_add_test(tc, test_delete_last_sibling);
+	tcase_add_test(tc, test_delete_last_root);
+	tcase_add_test(tc, test_reorder_variations_last_child);
+	tcase_add_test(tc, test_deep_main_line);
+	tcase_add_test(tc, test_deep_variations);
 	return tc;
 }
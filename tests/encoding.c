@@ -17,19 +17,19 @@ START_TEST (test_detect_encoding_BOM)
 	char *result;
 	char buffer[4] = {'\xFE', '\xFF', ' ', ' '};
 
-	result = DetectEncoding(buffer, buffer+4);
+	result = DetectEncoding(sgfc, buffer, buffer+4);
 	ck_assert_str_eq(result, "UTF-16BE");
 	free(result);
 
 	buffer[0] = '\xFF';
 	buffer[1] = '\xFE';
-	result = DetectEncoding(buffer, buffer+4);
+	result = DetectEncoding(sgfc, buffer, buffer+4);
 	ck_assert_str_eq(result, "UTF-16LE");
 	free(result);
 
 	buffer[2] = 0;
 	buffer[3] = 0;
-	result = DetectEncoding(buffer, buffer+4);
+	result = DetectEncoding(sgfc, buffer, buffer+4);
 	ck_assert_str_eq(result, "UTF-32LE");
 	free(result);
 
@@ -37,7 +37,7 @@ START_TEST (test_detect_encoding_BOM)
 	buffer[1] = 0;
 	buffer[2] = '\xFE';
 	buffer[3] = '\xFF';
-	result = DetectEncoding(buffer, buffer+4);
+	result = DetectEncoding(sgfc, buffer, buffer+4);
 	ck_assert_str_eq(result, "UTF-32BE");
 	free(result);
 
@@ -45,7 +45,7 @@ START_TEST (test_detect_encoding_BOM)
 	buffer[1] = '\xBB';
 	buffer[2] = '\xBF';
 	buffer[3] = '\n';
-	result = DetectEncoding(buffer, buffer+4);
+	result = DetectEncoding(sgfc, buffer, buffer+4);
 	ck_assert_str_eq(result, "UTF-8");
 	free(result);
 }
@@ -57,37 +57,37 @@ START_TEST (test_detect_encoding)
 	char *result;
 
 	char buffer[] = "some (text CA[basic-case] more text";
-	result = DetectEncoding(buffer, buffer + strlen(buffer));
+	result = DetectEncoding(sgfc, buffer, buffer + strlen(buffer));
 	ck_assert_str_eq(result, "basic-case");
 	free(result);
 
 	char buffer2[] = "some (CA\n [ spaces \n] ";
-	result = DetectEncoding(buffer2, buffer2 + strlen(buffer2));
+	result = DetectEncoding(sgfc, buffer2, buffer2 + strlen(buffer2));
 	ck_assert_str_eq(result, "spaces");
 	free(result);
 
 	char buffer3[] = "some text in (front ClowerAcase\n [ lower-case]";
-	result = DetectEncoding(buffer3, buffer3 + strlen(buffer3));
+	result = DetectEncoding(sgfc, buffer3, buffer3 + strlen(buffer3));
 	ck_assert_str_eq(result, "lower-case");
 	free(result);
 
 	char buffer4[] = "(CCA[one]CA[second]";
-	result = DetectEncoding(buffer4, buffer4 + strlen(buffer4));
+	result = DetectEncoding(sgfc, buffer4, buffer4 + strlen(buffer4));
 	ck_assert_str_eq(result, "second");
 	free(result);
 
 	char buffer5[] = "(xCyAzA[one]CxA[second-lower]";
-	result = DetectEncoding(buffer5, buffer5 + strlen(buffer5));
+	result = DetectEncoding(sgfc, buffer5, buffer5 + strlen(buffer5));
 	ck_assert_str_eq(result, "second-lower");
 	free(result);
 
 	char buffer6[] = "(xCyA.CzA[word-boundary] more";
-	result = DetectEncoding(buffer6, buffer6 + strlen(buffer6));
+	result = DetectEncoding(sgfc, buffer6, buffer6 + strlen(buffer6));
 	ck_assert_str_eq(result, "word-boundary");
 	free(result);
 
 	char buffer7[] = "no:CA[one] (CA[after-brace]";
-	result = DetectEncoding(buffer7, buffer7 + strlen(buffer7));
+	result = DetectEncoding(sgfc, buffer7, buffer7 + strlen(buffer7));
 	ck_assert_str_eq(result, "after-brace");
 	free(result);
 }
@@ -99,11 +99,11 @@ START_TEST (test_no_encoding_specified)
 	char *result;
 
 	char buffer[] = "you're not gonna find it";
-	result = DetectEncoding(buffer, buffer + strlen(buffer));
+	result = DetectEncoding(sgfc, buffer, buffer + strlen(buffer));
 	ck_assert_ptr_eq(result, NULL);
 
 	char buffer2[] = "you're not gonna CA[it";
-	result = DetectEncoding(buffer2, buffer2 + strlen(buffer2));
+	result = DetectEncoding(sgfc, buffer2, buffer2 + strlen(buffer2));
 	ck_assert_ptr_eq(result, NULL);
 }
 END_TEST
@@ -196,8 +196,8 @@ END_TEST
 
 START_TEST (test_8bit_value_in_middle)
 {
-	print_error_handler = PrintErrorHandler;	/* count errors */
-	print_error_output_hook = NULL;
+	sgfc->print_error_handler = PrintErrorHandler;	/* count errors */
+	sgfc->print_error_output_hook = NULL;
 	sgfc->options->forced_encoding = "UTF-8";
 	sgfc->options->encoding = OPTION_ENCODING_EVERYTHING;
 	/* UTF-8 of U+4E2D (中) */
@@ -209,8 +209,11 @@ START_TEST (test_8bit_value_in_middle)
 	ck_assert_str_eq("abc\xE4\xB8\xADxyz", sgfc->root->prop->value->value);
 	ck_assert_str_eq("def\xE4\xB8\xADuvw", sgfc->root->prop->value->value2);
 	ck_assert_str_eq("ab\xE4\xB8\xADxyz", sgfc->root->prop->next->value->value);
-	ck_assert_int_eq(3, (long)sgfc->root->prop->col);
-	ck_assert_int_eq(22, (long)sgfc->root->prop->next->col);
+	U_LONG row, col;
+	ResolvePosition(sgfc, sgfc->root->prop->pos, &row, &col);
+	ck_assert_int_eq(3, (long)col);
+	ResolvePosition(sgfc, sgfc->root->prop->next->pos, &row, &col);
+	ck_assert_int_eq(22, (long)col);
 	ck_assert_int_eq(0, sgfc->error_count);
 	ck_assert_int_eq(0, sgfc->warning_count);
 }
@@ -219,8 +222,8 @@ END_TEST
 
 START_TEST (test_8bit_value_at_end)
 {
-	print_error_handler = PrintErrorHandler;	/* count errors */
-	print_error_output_hook = NULL;
+	sgfc->print_error_handler = PrintErrorHandler;	/* count errors */
+	sgfc->print_error_output_hook = NULL;
 	sgfc->options->forced_encoding = "UTF-8";
 	sgfc->options->encoding = OPTION_ENCODING_EVERYTHING;
 
@@ -232,14 +235,278 @@ START_TEST (test_8bit_value_at_end)
 	ck_assert_str_eq("\xE4\xB8\xAD", sgfc->root->prop->value->value);
 	ck_assert_str_eq("\xE5\xB8\xAE", sgfc->root->prop->value->value2);
 	ck_assert_str_eq("ab\xE4\xB8\xAD", sgfc->root->prop->next->value->value);
-	ck_assert_int_eq(3, (long)sgfc->root->prop->col);
-	ck_assert_int_eq(10, (long)sgfc->root->prop->next->col);
+	U_LONG row, col;
+	ResolvePosition(sgfc, sgfc->root->prop->pos, &row, &col);
+	ck_assert_int_eq(3, (long)col);
+	ResolvePosition(sgfc, sgfc->root->prop->next->pos, &row, &col);
+	ck_assert_int_eq(10, (long)col);
 	ck_assert_int_eq(0, sgfc->error_count);
 	ck_assert_int_eq(0, sgfc->warning_count);
 }
 END_TEST
 
 
+START_TEST (test_valid_utf8_no_iconv)
+{
+	sgfc->print_error_handler = PrintErrorHandler;	/* count errors */
+	sgfc->print_error_output_hook = NULL;
+	sgfc->options->forced_encoding = "UTF-8";
+	/* 2, 3 and 4 byte sequences, and a BOM that has to be kept */
+	char buffer[] = "\xEF\xBB\xBF(;C[a\xC3\xA4\xE4\xB8\xAD\xF0\x9D\x84\x9E]GN[\xF4\x8F\xBF\xBF])";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	ck_assert_ptr_ne(sgfc->decoded_buffer, buffer);		/* not writable -> copy */
+	ck_assert_int_eq(sgfc->decoded_end - sgfc->decoded_buffer, strlen(buffer));
+	ck_assert_int_eq(sgfc->decoded_buffer[0], '\xEF');
+	ck_assert_str_eq("a\xC3\xA4\xE4\xB8\xAD\xF0\x9D\x84\x9E", FindProperty(sgfc->root, TKN_C)->value->value);
+	ck_assert_str_eq("\xF4\x8F\xBF\xBF", FindProperty(sgfc->root, TKN_GN)->value->value);
+	ck_assert_int_eq(0, sgfc->error_count);
+	ck_assert_int_eq(0, sgfc->warning_count);
+}
+END_TEST
+
+
+START_TEST (test_ascii_zero_copy)
+{
+	sgfc->print_error_handler = PrintErrorHandler;	/* count errors */
+	sgfc->print_error_output_hook = NULL;
+	/* default encoding ISO-8859-1 maps ASCII to itself */
+	char buffer[] = "(;C[plain ASCII]GN[game])";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	sgfc->buffer_writable = true;
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	ck_assert_ptr_eq(sgfc->decoded_buffer, buffer);		/* buffer is used directly */
+	ck_assert_ptr_eq(FindProperty(sgfc->root, TKN_C)->value->value, buffer + 4);
+	ck_assert_str_eq("plain ASCII", FindProperty(sgfc->root, TKN_C)->value->value);
+	ck_assert_str_eq("game", FindProperty(sgfc->root, TKN_GN)->value->value);
+	ck_assert_int_eq(0, sgfc->warning_count);
+	sgfc->decoded_buffer = NULL;		/* buffer is on stack */
+}
+END_TEST
+
+
+START_TEST (test_mapped_file_not_written)
+{
+	const char *sgf = "(;C[plain ASCII]GN[game])";
+	FILE *file = fopen("encoding-test.sgf", "wb");
+
+	ck_assert_ptr_ne(file, NULL);
+	fputs(sgf, file);
+	fclose(file);
+
+	/* value slices are terminated in a copy, not in the read-only mapping */
+	ck_assert_int_eq(LoadSGF(sgfc, "encoding-test.sgf"), true);
+	ck_assert_ptr_ne(sgfc->decoded_buffer, sgfc->buffer);
+	ck_assert_int_eq(memcmp(sgfc->buffer, sgf, strlen(sgf)), 0);
+	ck_assert_str_eq("plain ASCII", FindProperty(sgfc->root, TKN_C)->value->value);
+	FreeSGFBuffer(sgfc);
+
+	/* verbatim: no slices, mapping is used as it is */
+	sgfc->options->verbatim = true;
+	ResetSGFInfo(sgfc);
+	ck_assert_int_eq(LoadSGF(sgfc, "encoding-test.sgf"), true);
+	if(sgfc->buffer_mapped)
+		ck_assert_ptr_eq(sgfc->decoded_buffer, sgfc->buffer);
+	ck_assert_str_eq("game", FindProperty(sgfc->root, TKN_GN)->value->value);
+	FreeSGFBuffer(sgfc);
+	remove("encoding-test.sgf");
+}
+END_TEST
+
+
+START_TEST (test_needs_iconv)
+{
+	sgfc->print_error_handler = PrintErrorHandler;	/* count errors */
+	sgfc->print_error_output_hook = NULL;
+	/* valid UTF-8, but encoding is ISO-8859-1 */
+	char buffer[] = "(;C[\xC3\xA4])";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	sgfc->buffer_writable = true;
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	ck_assert_ptr_ne(sgfc->decoded_buffer, buffer);
+	ck_assert_str_eq("\xC3\x83\xC2\xA4", sgfc->root->prop->value->value);
+	ck_assert_int_eq(0, sgfc->warning_count);
+}
+END_TEST
+
+
+START_TEST (test_invalid_utf8_to_iconv)
+{
+	sgfc->print_error_handler = PrintErrorHandler;	/* count errors */
+	sgfc->print_error_output_hook = NULL;
+	sgfc->options->forced_encoding = "UTF-8";
+	/* surrogate U+D800, overlong '/', beyond U+10FFFF, truncated sequence */
+	const char *invalid[] = {"\xED\xA0\x80", "\xC0\xAF", "\xF4\x90\x80\x80", "\xE4\xB8"};
+
+	for(int i = 0; i < 4; i++)
+	{
+		char buffer[32];
+		sprintf(buffer, "(;C[a%sb])", invalid[i]);
+		sgfc->buffer = buffer;
+		sgfc->b_end = buffer + strlen(buffer);
+		sgfc->buffer_writable = true;
+		sgfc->warning_count = 0;
+		int ret = LoadSGFFromFileBuffer(sgfc);
+		ck_assert_int_eq(ret, true);
+		ck_assert_ptr_ne(sgfc->decoded_buffer, buffer);
+		/* not all iconv implementations reject code points beyond U+10FFFF */
+		if(i != 2)
+			ck_assert_int_eq(1, sgfc->warning_count);	/* WS_ENCODING_ERRORS */
+		sgfc->root = sgfc->last_root = NULL;
+	}
+}
+END_TEST
+
+
+START_TEST (test_iconv_cache)
+{
+	const char *names[] = {"UTF-8", "ISO-8859-1", "ISO-8859-2", "ISO-8859-5",
+						   "ISO-8859-15", "CP1252", "UTF-16LE", "UTF-16BE", "ASCII"};
+	iconv_t cd[9];
+
+	cd[0] = AcquireIConV(sgfc, "UTF-8");
+	ck_assert_ptr_ne(cd[0], (iconv_t)-1);
+	ck_assert_ptr_eq(AcquireIConV(sgfc, "utf-8"), cd[0]);	/* shared; case-insensitive */
+	ReleaseIConV(sgfc, cd[0]);
+	ck_assert_ptr_eq(AcquireIConV(sgfc, "nonsense-encoding"), (iconv_t)-1);
+
+	for(int i = 1; i < 9; i++)		/* cache is full after 8 encodings */
+		ck_assert_ptr_ne(cd[i] = AcquireIConV(sgfc, names[i]), (iconv_t)-1);
+	iconv_t uncached = AcquireIConV(sgfc, "ASCII");
+	ck_assert_ptr_ne(uncached, cd[8]);
+	ReleaseIConV(sgfc, uncached);			/* gets closed */
+	for(int i = 0; i < 9; i++)
+		ReleaseIConV(sgfc, cd[i]);
+
+	cd[8] = AcquireIConV(sgfc, "ASCII");	/* evicts least recently used */
+	ck_assert_ptr_eq(AcquireIConV(sgfc, "ASCII"), cd[8]);
+	ReleaseIConV(sgfc, cd[8]);
+	ReleaseIConV(sgfc, cd[8]);
+}
+END_TEST
+
+
+START_TEST (test_iconv_shared_by_trees)
+{
+	sgfc->options->encoding = OPTION_ENCODING_TEXT_ONLY;
+	char buffer[] = "(;CA[UTF-8]C[\xC3\xA4])(;CA[utf-8]C[\xC3\xB6])(;CA[ISO-8859-1]C[\xE4])";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ck_assert_int_eq(ParseSGF(sgfc), true);
+	ck_assert_ptr_eq(sgfc->tree->encoding, sgfc->tree->next->encoding);
+	ck_assert_ptr_ne(sgfc->tree->encoding, sgfc->tree->next->next->encoding);
+	ck_assert_str_eq("\xC3\xB6", FindProperty(sgfc->root->sibling, TKN_C)->value->value);
+	ck_assert_str_eq("\xC3\xA4", FindProperty(sgfc->root->sibling->sibling, TKN_C)->value->value);
+}
+END_TEST
+
+
+START_TEST (test_decode_segments)
+{
+	/* incomplete sequences at the end of a segment must not continue in the next one */
+	char *values[] = {"ab\xC3", "\xA4" "cd", "", "x\xF0\x9F\x98\x80y\xFF\xFEz", "\xE2\x82", "\xAC"};
+	struct DecodeSegment seg[6];
+	char *result, *single;
+	size_t i, size;
+
+	iconv_t cd = iconv_open("UTF-8", "UTF-8");
+	for(i = 0; i < 6; i++)
+	{
+		seg[i].in = values[i];
+		seg[i].in_len = strlen(values[i]);
+	}
+	result = DecodeSegments(sgfc, cd, seg, 6, &size);
+	for(i = 0; i < 6; i++)
+	{
+		single = DecodeBuffer(sgfc, cd, values[i], strlen(values[i]), 0, NULL);
+		ck_assert(seg[i].ok);
+		ck_assert_str_eq(result + seg[i].out_offset, single);
+		ck_assert_uint_eq(seg[i].out_len, strlen(single));
+		free(single);
+	}
+	ck_assert_uint_eq(seg[0].illegal, 2);
+	ck_assert_uint_eq(seg[1].illegal, 0);
+	ck_assert_uint_eq(seg[2].illegal, (size_t)-1);
+	ck_assert_uint_eq(seg[3].illegal, 6);
+	ck_assert_str_eq(result + seg[3].out_offset, "x\xF0\x9F\x98\x80y�z");
+	ck_assert_uint_eq(size, seg[5].out_offset + seg[5].out_len + 1);
+	free(result);
+	iconv_close(cd);
+
+	char latin[300];	/* output grows beyond input size */
+	memset(latin, 0xE4, 300);
+	for(i = 0; i < 6; i++)
+	{
+		seg[i].in = latin;
+		seg[i].in_len = 50 * i;
+	}
+	cd = iconv_open("UTF-8", "ISO-8859-1");
+	result = DecodeSegments(sgfc, cd, seg, 6, &size);
+	for(i = 0; i < 6; i++)
+	{
+		ck_assert_uint_eq(seg[i].out_len, 100 * i);
+		ck_assert_uint_eq(strlen(result + seg[i].out_offset), 100 * i);
+	}
+	free(result);
+	iconv_close(cd);
+}
+END_TEST
+
+
+static char message_log[1024];
+
+static void LogMessage(struct SGFInfo *s, struct SGFCError *error)
+{
+	strncat(message_log, error->message, sizeof(message_log) - strlen(message_log) - 1);
+}
+
+START_TEST (test_text_only_tree_values)
+{
+	sgfc->options->encoding = OPTION_ENCODING_TEXT_ONLY;
+	sgfc->print_error_handler = PrintErrorHandler;
+	sgfc->print_error_output_hook = LogMessage;
+	message_log[0] = 0;
+	char buffer[] = "(;CA[UTF-8]GN[ok\xC3]PB[\\\xC3\\\xA4]"
+					"C[a\\]b\xFF" "c\xFE\xFF" "d\\\nsoft]N[\xE4\xB8\xAD]LB[aa:x\xC0y]"
+					";C[\xC3\xA4]C[\xFF]"
+					"(;C[first ok])(;C[\xE4\xB8\xAD\xFE]))";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ck_assert_int_eq(ParseSGF(sgfc), true);
+
+	struct Node *n = sgfc->root;
+	ck_assert_str_eq("ok�", FindProperty(n, TKN_GN)->value->value);
+	ck_assert_str_eq("\xC3\xA4", FindProperty(n, TKN_PB)->value->value);
+	ck_assert_str_eq("a]b�" "c�dsoft", FindProperty(n, TKN_C)->value->value);
+	ck_assert_str_eq("\xE4\xB8\xAD", FindProperty(n, TKN_N)->value->value);
+	ck_assert_str_eq("x�y", FindProperty(n, TKN_LB)->value->value2);
+	/* merged value: not part of the batch, decoded on its own */
+	ck_assert_str_eq("\xC3\xA4\n\n�", FindProperty(n->child, TKN_C)->value->value);
+	ck_assert_str_eq("first ok", FindProperty(n->child->child, TKN_C)->value->value);
+	ck_assert_str_eq("\xE4\xB8\xAD�", FindProperty(n->child->child->sibling, TKN_C)->value->value);
+
+	/* one warning per value in order of checking (GN, LB, C, C, C);
+	** offsets within the (unescaped) value */
+	char *s = message_log;
+	const char *offsets[] = {"offset: 2\n", "offset: 1\n", "offset: 3\n", "offset: 0\n", "offset: 3\n"};
+	for(int i = 0; i < 5; i++)
+	{
+		s = strstr(s, offsets[i]);
+		ck_assert_ptr_ne(s, NULL);
+		s++;
+	}
+}
+END_TEST
+
+
 TCase *sgfc_tc_encoding(void)
 {
 	TCase *tc;
@@ -255,5 +522,14 @@ TCase *sgfc_tc_encoding(void)
 	tcase_add_test(tc, test_buffer_overflow_conversion);
 	tcase_add_test(tc, test_8bit_value_in_middle);
 	tcase_add_test(tc, test_8bit_value_at_end);
+	tcase_add_test(tc, test_valid_utf8_no_iconv);
+	tcase_add_test(tc, test_ascii_zero_copy);
+	tcase_add_test(tc, test_mapped_file_not_written);
+	tcase_add_test(tc, test_needs_iconv);
+	tcase_add_test(tc, test_invalid_utf8_to_iconv);
+	tcase_add_test(tc, test_iconv_cache);
+	tcase_add_test(tc, test_iconv_shared_by_trees);
+	tcase_add_test(tc, test_decode_segments);
+	tcase_add_test(tc, test_text_only_tree_values);
 	return tc;
 }
@@ -85,7 +85,7 @@ struct SGFCError test_lwic_errors[] =
 };
 
 
-void test_lwic_error_output(struct SGFCError *error)
+void test_lwic_error_output(struct SGFInfo *sgfc, struct SGFCError *error)
 {
 	test_lwic_errors_seen++;
 	ck_assert_msg(test_lwic_errors_seen <= 12, "too many errors, latest %lx at %ld:%ld:%s",
@@ -107,8 +107,8 @@ START_TEST (test_lowercase_with_illegal_chars)
 	sgfc->buffer = buffer;
 	sgfc->b_end = buffer + strlen(buffer);
 
-	print_error_handler = PrintErrorHandler;
-	print_error_output_hook = test_lwic_error_output;
+	sgfc->print_error_handler = PrintErrorHandler;
+	sgfc->print_error_output_hook = test_lwic_error_output;
 	int ret = LoadSGFFromFileBuffer(sgfc);
 	ck_assert_int_eq(ret, true);
 	ck_assert_str_eq("yyAB", sgfc->root->prop->idstr);
@@ -122,6 +122,119 @@ START_TEST (test_lowercase_with_illegal_chars)
 END_TEST
 
 
+static int test_lv_errors_seen = 0;
+static void test_lv_error_output(struct SGFInfo *sgfc, struct SGFCError *error)
+{
+	U_LONG expected_row[] = {1, 4};
+	U_LONG expected_col[] = {80, 3};
+
+	ck_assert_int_eq(error->error & M_ERROR_NUM, E_ILLEGAL_OUTSIDE_CHARS & M_ERROR_NUM);
+	ck_assert_int_lt(test_lv_errors_seen, 2);
+	ck_assert_int_eq(error->row, expected_row[test_lv_errors_seen]);
+	ck_assert_int_eq(error->col, expected_col[test_lv_errors_seen]);
+	test_lv_errors_seen++;
+}
+
+START_TEST (test_long_values_position)
+{
+	/* long values are skipped in bulk; positions have to stay exact */
+	char buffer[] = "(;CA[UTF-8]C[\xc3\xa4\xc3\xb6\xc3\xbc\xe6\x97\xa5\xe6\x9c\xac long text "
+					"0123456789abcdefghij \xc3\xa4\xc3\xb6\xc3\xbc 0123456789abcdefghij\\]x] x "
+					";C[line one \xc3\xa4\r\nline two \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e "
+					"0123456789abcdefghijklmnopqrstuvwxyz0123456789]\n  y)";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+
+	sgfc->print_error_handler = PrintErrorHandler;
+	sgfc->print_error_output_hook = test_lv_error_output;
+	sgfc->options->warnings = false;
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	ck_assert_int_eq(test_lv_errors_seen, 2);
+}
+END_TEST
+
+
+START_TEST (test_resolve_position)
+{
+	char buffer[] = "x[aa] (;B[aa]W[bb]C[\xc3\xa4\n]\n\rAB[cc][cc])";
+	U_LONG row, col;
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+
+	/* '[aa]' in front of '(;' isn't counted */
+	ResolvePosition(sgfc, FindProperty(sgfc->root, TKN_W)->pos, &row, &col);
+	ck_assert_int_eq(row, 1);
+	ck_assert_int_eq(col, 10);
+	/* linebreak after multi-byte char counts twice, "\n\r" once */
+	ResolvePosition(sgfc, FindProperty(sgfc->root, TKN_AB)->value->next->pos, &row, &col);
+	ck_assert_int_eq(row, 4);
+	ck_assert_int_eq(col, 7);
+	ResolvePosition(sgfc, FindProperty(sgfc->root, TKN_B)->pos, &row, &col);
+	ck_assert_int_eq(row, 1);
+	ck_assert_int_eq(col, 5);
+
+	ResolvePosition(sgfc, 0, &row, &col);
+	ck_assert_int_eq(row, 0);
+	ck_assert_int_eq(col, 0);
+}
+END_TEST
+
+
+START_TEST (test_interned_idstr)
+{
+	char buffer[] = "(;B[aa]ccB[bb]XY[1]XY[2]xXY[3];B[cc]W[dd]ccB[ee]xXY[4])";
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+
+	struct Property *p = sgfc->root->prop, *q = sgfc->root->child->prop;
+	ck_assert_ptr_eq(p->idstr, sgf_token[TKN_B].id);	/* B */
+	ck_assert_ptr_eq(q->idstr, sgf_token[TKN_B].id);	/* B */
+	ck_assert_ptr_eq(q->next->idstr, sgf_token[TKN_W].id);
+	ck_assert_str_eq(p->next->idstr, "ccB");
+	ck_assert_ptr_eq(p->next->idstr, q->next->next->idstr);
+	ck_assert_str_eq(p->next->next->idstr, "XY");
+	ck_assert_ptr_eq(p->next->next->idstr, p->next->next->next->idstr);
+	ck_assert_str_eq(p->next->next->next->next->idstr, "xXY");
+	ck_assert_ptr_eq(p->next->next->next->next->idstr, q->next->next->next->idstr);
+}
+END_TEST
+
+
+START_TEST (test_token_lookup)
+{
+	char id[3] = "";
+	int hits = 0;
+
+	for(int i = 1; i < NUM_SGF_TOKENS; i++)
+		if(sgf_token[i].id)
+			ck_assert_int_eq(LookupToken(sgf_token[i].id), i);
+
+	for(char a = 'A'; a <= 'Z'; a++)
+		for(char b = '@'; b <= 'Z'; b++)
+		{
+			id[0] = a;
+			id[1] = (b == '@') ? 0 : b;
+			if(LookupToken(id) != TKN_UNKNOWN)
+				hits++;
+		}
+	ck_assert_int_eq(hits, NUM_SGF_TOKENS-2);
+
+	ck_assert_int_eq(LookupToken(""), TKN_UNKNOWN);
+	ck_assert_int_eq(LookupToken("ZZ"), TKN_UNKNOWN);
+	ck_assert_int_eq(LookupToken("ABC"), TKN_UNKNOWN);
+	ck_assert_int_eq(LookupToken("ab"), TKN_UNKNOWN);
+	ck_assert_int_eq(LookupToken("B2"), TKN_UNKNOWN);
+}
+END_TEST
+
+
 TCase *sgfc_tc_load_properties(void)
 {
 	TCase *tc;
@@ -134,5 +247,9 @@ TCase *sgfc_tc_load_properties(void)
 	tcase_add_test(tc, test_lowercase_second_prop);
 	tcase_add_test(tc, test_lowercase_missing_semicolon);
 	tcase_add_test(tc, test_lowercase_with_illegal_chars);
+	tcase_add_test(tc, test_long_values_position);
+	tcase_add_test(tc, test_resolve_position);
+	tcase_add_test(tc, test_interned_idstr);
+	tcase_add_test(tc, test_token_lookup);
 	return tc;
 }
@@ -141,6 +141,44 @@ START_TEST (test_mix2)
 END_TEST
 
 
+START_TEST (test_batch)
+{
+	const char *args[] = {"sgfc", "in1", "--batch", "-r", "in2", "--threads=4", "--", "-in3", "in4"};
+	bool result = ParseArgs(sgfc, 9, args);
+	ck_assert(result == true);
+	ck_assert(sgfc->options->batch == true);
+	ck_assert(sgfc->options->strict_checking == true);
+	ck_assert_int_eq(sgfc->options->threads, 4);
+	ck_assert_int_eq(sgfc->options->batch_count, 4);
+	ck_assert_str_eq(sgfc->options->batch_files[0], "in1");
+	ck_assert_str_eq(sgfc->options->batch_files[2], "-in3");
+	ck_assert_ptr_eq(sgfc->options->infile, NULL);
+}
+END_TEST
+
+
+START_TEST (test_batch_snapshot)
+{
+	const char *args[] = {"sgfc", "--batch", "in1", "--read-snapshot", "--write-snapshot=out.snap"};
+	ck_assert(ParseArgs(sgfc, 3, args) == true);
+	ck_assert(ParseArgs(sgfc, 4, args) == false);
+	sgfc->options->read_snapshot = false;
+	args[3] = "in2";
+	ck_assert(ParseArgs(sgfc, 5, args) == false);
+}
+END_TEST
+
+
+START_TEST (test_too_many_files)
+{
+	const char *args[] = {"sgfc", "in1", "in2", "in3", "--threads=0"};
+	ck_assert(ParseArgs(sgfc, 3, args) == true);
+	ck_assert(ParseArgs(sgfc, 4, args) == false);
+	ck_assert(ParseArgs(sgfc, 5, args) == false);
+}
+END_TEST
+
+
 TCase *sgfc_tc_options(void)
 {
 	TCase *tc;
@@ -158,5 +196,8 @@ TCase *sgfc_tc_options(void)
 	tcase_add_test(tc, test_long_options_and_encoding);
 	tcase_add_test(tc, test_mix1);
 	tcase_add_test(tc, test_mix2);
+	tcase_add_test(tc, test_batch);
+	tcase_add_test(tc, test_batch_snapshot);
+	tcase_add_test(tc, test_too_many_files);
 	return tc;
 }
@@ -0,0 +1,214 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 tests/parallel.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "test-common.h"
+
+#define COLLECTION	"parallel-collection.sgf"
+#define RESULT		"parallel-result.sgf"
+
+static const char *collection_files[] =
+{
+	"../test-files/test.sgf", "../test-files/strict.sgf",
+	"../test-files/reorder.sgf", "../test-files/escaping.sgf"
+};
+
+/* trees with quirks: "((" isn't a variation for the lexer, so the
+** pre-scan guesses wrong until an extra ')' closes the tree */
+static const char *quirks[] =
+{
+	"junk [aa] in between (;GM[1]FF[4]C[value with ( and ) chars];B[aa])\n",
+	"(;GM[1]FF[4]B[aa]((;W[bb]))\n",
+	"(;GM[1]FF[4]SZ[9]C[escaped \\] and ( chars];B[cc]))\n",
+	"(;GM[1]FF[4]\r\nPB[crlf]\r\n;B[dd]\r\n;W[ee]\r\n)\r\n",
+	"(;GM[1]FF[4]CA[UTF-8]C[\xc3\xa4\xc3\xb6\xc3\xbc];B[ff]\n(;W[gg])(;W[hh]))\n",
+};
+
+/* about 'copies' * 4.4KB of game trees taken from test-files */
+static void WriteCollection(int copies, bool with_quirks)
+{
+	FILE *out = fopen(COLLECTION, "wb"), *in;
+	char *buffer = NULL;
+	size_t len;
+	int i, f;
+
+	ck_assert_ptr_ne(out, NULL);
+	fputs("Some text in front of the collection [aa]\n", out);
+	for(i = 0; i < copies; i++)
+	{
+		for(f = 0; f < 4; f++)
+		{
+			ck_assert_ptr_ne(in = fopen(collection_files[f], "rb"), NULL);
+			len = AppendFile(&buffer, 0, in);
+			fclose(in);
+			fwrite(buffer, 1, len, out);
+		}
+		if(with_quirks && i % 10 == 9)
+			fputs(quirks[(i / 10) % 5], out);
+	}
+	if(with_quirks)
+		fputs("(;GM[1]FF[4]C[unterminated value", out);
+	free(buffer);
+	fclose(out);
+}
+
+static void ParallelTestOutput(struct SGFInfo *s, struct SGFCError *error)
+{
+	CommonPrintErrorOutputHook(error, s->user_data);
+}
+
+/* like main(): messages, status line, and saved file in one buffer */
+static char *RunCollection(const char *option, bool parallel)
+{
+	const char *argv[5] = {"sgfc", option, COLLECTION, RESULT, NULL};
+	struct SGFInfo *s = SetupSGFInfo(NULL);
+	FILE *out = tmpfile(), *saved;
+	char *buffer = NULL, name[40];
+	size_t len;
+	int i;
+
+	s->options->add_sgfc_ap_property = false;
+	s->print_error_output_hook = ParallelTestOutput;
+	s->user_data = out;
+
+	ck_assert(ParseArgs(s, 4, argv));
+	s->options->parallel = parallel;
+	s->options->threads = 4;
+	if(LoadSGF(s, s->options->infile) && ParseSGF(s))
+	{
+		SaveSGF(s, SetupSaveFileIO, s->options->outfile);
+		PrintStatusLine(s, out);
+	}
+	FreeSGFInfo(s);
+
+	len = AppendFile(&buffer, 0, out);
+	fclose(out);
+	if((saved = fopen(RESULT, "rb")))
+	{
+		len = AppendFile(&buffer, len, saved);
+		fclose(saved);
+		remove(RESULT);
+	}
+	for(i = 1; ; i++)					/* option -s: one file per game tree */
+	{
+		snprintf(name, sizeof(name), "%s_%03d.sgf", RESULT, i);
+		if(!(saved = fopen(name, "rb")))
+			break;
+		len = AppendFile(&buffer, len, saved);
+		fclose(saved);
+		remove(name);
+	}
+	return buffer;
+}
+
+static pthread_t main_thread;
+static int split_files;
+
+/* handlers of split files are set up on the thread of the SGFInfo */
+static struct SaveFileHandler *SetupSplitIO(void)
+{
+	ck_assert(pthread_equal(pthread_self(), main_thread));
+	split_files++;
+	return SetupSaveExactSizeTestIO();
+}
+
+static void CompareParallel(const char *option)
+{
+	char *sequential = RunCollection(option, false);
+	char *parallel = RunCollection(option, true);
+
+	ck_assert_str_eq(sequential, parallel);
+	free(sequential);
+	free(parallel);
+}
+
+
+START_TEST (test_parallel_collection)
+{
+	WriteCollection(300, false);
+	CompareParallel("-c");
+	CompareParallel("-rvz");
+	CompareParallel("-cE2");
+	remove(COLLECTION);
+}
+END_TEST
+
+
+START_TEST (test_parallel_quirks)
+{
+	WriteCollection(300, true);
+	CompareParallel("-c");
+	CompareParallel("-roun");
+	remove(COLLECTION);
+}
+END_TEST
+
+
+START_TEST (test_parallel_small_file)
+{
+	WriteCollection(2, true);		/* not split at all */
+	CompareParallel("-c");
+	remove(COLLECTION);
+}
+END_TEST
+
+
+START_TEST (test_parallel_save)
+{
+	const char *argv[4] = {"sgfc", "-ckE2", COLLECTION, NULL};
+	struct SGFInfo *s;
+	struct Node *n;
+	int trees = 0;
+
+	WriteCollection(50, false);
+	CompareParallel("-cE2");
+	CompareParallel("-ckE2");
+	CompareParallel("-csE2");
+	CompareParallel("-cskE2");
+
+	/* concatenated trees: size of output is known in advance */
+	s = SetupSGFInfo(NULL);
+	s->print_error_handler = NULL;
+	ck_assert(ParseArgs(s, 3, argv));
+	s->options->parallel = true;
+	s->options->threads = 4;
+	ck_assert(LoadSGF(s, s->options->infile));
+	ck_assert(ParseSGF(s));
+	expected_output = NULL;
+	ck_assert(SaveSGF(s, SetupSaveExactSizeTestIO, "test"));
+
+	/* split files: setup_sfh() isn't called on worker threads */
+	for(n = s->root; n; n = n->sibling)
+		trees++;
+	s->options->split_file = true;
+	main_thread = pthread_self();
+	split_files = 0;
+	ck_assert(SaveSGF(s, SetupSplitIO, "test"));
+	ck_assert_int_eq(split_files, trees);
+	FreeSGFInfo(s);
+	remove(COLLECTION);
+}
+END_TEST
+
+
+TCase *sgfc_tc_parallel(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("parallel");
+	tcase_set_timeout(tc, 60);
+	tcase_add_test(tc, test_parallel_collection);
+	tcase_add_test(tc, test_parallel_quirks);
+	tcase_add_test(tc, test_parallel_small_file);
+	tcase_add_test(tc, test_parallel_save);
+	return tc;
+}
@@ -14,9 +14,8 @@ struct PropValue *prop_value;
 void parse_text_setup(void)
 {
 	common_setup();
-	prop_value = SaveCalloc(sizeof(struct PropValue), "propval");
-	prop_value->row = 3;
-	prop_value->col = 1;
+	prop_value = SaveCalloc(NULL, sizeof(struct PropValue), "propval");
+	prop_value->pos = 0;		/* no position: no buffer loaded */
 }
 
 void parse_text_teardown(void)
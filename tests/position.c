@@ -44,6 +44,166 @@ START_TEST (test_add_effect_across_variations)
 END_TEST
 
 
+static void CheckPosition(char *buffer, char *expected)
+{
+	ResetSGFInfo(sgfc);
+	sgfc->buffer = buffer;
+	sgfc->b_end = buffer + strlen(buffer);
+
+	int ret = LoadSGFFromFileBuffer(sgfc);
+	ck_assert_int_eq(ret, true);
+	ParseSGF(sgfc);
+
+	expected_output = expected;
+	ret = SaveSGF(sgfc, SetupSaveTestIO, "outfile");
+	ck_assert_int_eq(ret, true);
+	sgfc->buffer = NULL;
+}
+
+
+/* captured / suicided stones: AE[] on their positions has no effect */
+START_TEST (test_capture_and_suicide)
+{
+	char capture[] = "(;SZ[5];B[ba];W[aa];B[ab];AE[aa])";
+	char suicide[] = "(;SZ[5]AB[ba][ab];W[aa];AE[aa])";
+	char chain_suicide[] = "(;SZ[5]AW[ca][bb][ab];B[aa];B[ba];AE[aa][ba])";
+	char capture_first[] = "(;SZ[3]AB[ba][ab]AW[ca][bb][ac];W[aa];AE[aa][ab][ba])";
+	char overwrite[] = "(;SZ[3]AB[ab][bb]AW[ba];W[ab];B[aa];AE[aa][ab])";
+
+	CheckPosition(capture, "(;FF[4]CA[UTF-8]GM[1]SZ[5];B[ba];W[aa];B[ab];)\n");
+	CheckPosition(suicide, "(;FF[4]CA[UTF-8]GM[1]SZ[5]AB[ab][ba];W[aa];)\n");
+	CheckPosition(chain_suicide, "(;FF[4]CA[UTF-8]GM[1]SZ[5]AW[ab:bb][ca];B[aa];B[ba];)\n");
+	CheckPosition(capture_first, "(;FF[4]CA[UTF-8]GM[1]SZ[3]AB[ab][ba]AW[ac][bb][ca];W[aa];AE[aa]\n)\n");
+	CheckPosition(overwrite, "(;FF[4]CA[UTF-8]GM[1]SZ[3]AB[ab:bb]AW[ba];W[ab];B[aa];AE[ab]\n)\n");
+}
+END_TEST
+
+
+/* board changes (moves, captures, setup) are undone for sibling variations */
+START_TEST (test_capture_in_variations)
+{
+	char capture[] = "(;SZ[5];B[ba];W[aa](;B[ab];AE[aa])(;B[bb];AE[aa]))";
+	char setup[] = "(;SZ[3](;AB[ab];W[aa];B[ba])(;W[aa];B[ba];AE[aa]))";
+
+	CheckPosition(capture, "(;FF[4]CA[UTF-8]GM[1]SZ[5];B[ba];W[aa]\n(;B[ab];)\n(;B[bb];AE[aa]))\n");
+	CheckPosition(setup, "(;FF[4]CA[UTF-8]GM[1]SZ[3]\n(;AB[ab];W[aa];B[ba])\n(;W[aa];B[ba];AE[aa]))\n");
+}
+END_TEST
+
+
+/* captures at the far edge: bit board (up to 19x19) and chains (larger) */
+START_TEST (test_capture_board_sizes)
+{
+	char bits[] = "(;SZ[19];B[sr];W[ss];B[rs];AE[ss])";
+	char rect[] = "(;SZ[19:5];B[sd];W[se];B[re];AE[se])";
+	char chains[] = "(;SZ[25];B[yx];W[yy];B[xy];AE[yy])";
+
+	CheckPosition(bits, "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[sr];W[ss];B[rs];)\n");
+	CheckPosition(rect, "(;FF[4]CA[UTF-8]GM[1]SZ[19:5];B[sd];W[se];B[re];)\n");
+	CheckPosition(chains, "(;FF[4]CA[UTF-8]GM[1]SZ[25];B[yx];W[yy];B[xy];)\n");
+}
+END_TEST
+
+
+/* hashes depend on position only: transpositions, setup & captures */
+START_TEST (test_position_hashes)
+{
+	char sgf[] = "(;SZ[9](;B[aa];W[bb];B[cc])(;B[cc];W[bb];B[aa])(;AB[aa][cc]AW[bb])"
+				 "(;B[ba];W[aa];B[ab];AE[ba][ab]))(;SZ[25];B[yx];W[yy];B[xy])";
+	struct Node *root, *n;
+
+	ResetSGFInfo(sgfc);
+	sgfc->buffer = sgf;
+	sgfc->b_end = sgf + strlen(sgf);
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ParseSGF(sgfc);
+
+	root = sgfc->root;
+	ck_assert(root->hash == 0);
+	n = root->child;							/* B[aa];W[bb];B[cc] */
+	ck_assert(n->hash == ZobristKey(0, BLACK));
+	n = n->child->child;
+	ck_assert(n->hash == (ZobristKey(0, BLACK) ^ ZobristKey(9+1, WHITE) ^ ZobristKey(18+2, BLACK)));
+	ck_assert(root->child->sibling->child->child->hash == n->hash);		/* transposition */
+	ck_assert(root->child->sibling->sibling->hash == n->hash);			/* setup */
+
+	n = root->child->sibling->sibling->sibling->child->child;	/* W[aa] captured */
+	ck_assert(n->hash == (ZobristKey(1, BLACK) ^ ZobristKey(9, BLACK)));
+	ck_assert(n->child->hash == 0);				/* AE[ba][ab] */
+
+	n = root->sibling->child->child->child;		/* chain board: W[yy] captured */
+	ck_assert(n->hash == (ZobristKey(23*25+24, BLACK) ^ ZobristKey(24*25+23, BLACK)));
+	sgfc->buffer = NULL;
+}
+END_TEST
+
+
+/* split setup/move node: setup node gets hash of setup part only */
+START_TEST (test_position_hashes_split_node)
+{
+	char sgf[] = "(;AB[aa]B[bb])(;SZ[9];B[cc]AB[dd])";
+	struct Node *n;
+
+	ResetSGFInfo(sgfc);
+	sgfc->buffer = sgf;
+	sgfc->b_end = sgf + strlen(sgf);
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ParseSGF(sgfc);
+
+	n = sgfc->root;								/* AB[aa] */
+	ck_assert(n->hash == ZobristKey(0, BLACK));
+	ck_assert(n->child->hash == (ZobristKey(0, BLACK) ^ ZobristKey(19+1, BLACK)));
+
+	n = sgfc->root->sibling->child;				/* AB[dd] (move came first) */
+	ck_assert(n->hash == ZobristKey(27+3, BLACK));
+	ck_assert(n->child->hash == (ZobristKey(27+3, BLACK) ^ ZobristKey(18+2, BLACK)));
+	sgfc->buffer = NULL;
+}
+END_TEST
+
+
+static U_LONG split_node_cols[4];
+static int split_node_errors;
+
+static void SplitNodeErrorOutput(struct SGFInfo *s, struct SGFCError *error)
+{
+	if(split_node_errors < 4)
+		split_node_cols[split_node_errors] = error->col;
+	split_node_errors++;
+}
+
+/* properties of a node with setup & move get checked in node order */
+START_TEST (test_split_node_message_order)
+{
+	char sgf[] = "(;FF[4]GM[1]SZ[9];B[bb]BM[x]PL[x]AB[aa])";
+
+	split_node_errors = 0;
+	sgfc->buffer = sgf;
+	sgfc->b_end = sgf + strlen(sgf);
+	sgfc->print_error_handler = PrintErrorHandler;
+	sgfc->print_error_output_hook = SplitNodeErrorOutput;
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ParseSGF(sgfc);
+
+	ck_assert_int_eq(split_node_errors, 3);
+	ck_assert_uint_eq(split_node_cols[0], 26);		/* BM[x] */
+	ck_assert_uint_eq(split_node_cols[1], 31);		/* PL[x] */
+	ck_assert(sgfc->root->child->hash == ZobristKey(0, BLACK));
+	sgfc->buffer = NULL;
+}
+END_TEST
+
+
+/* markup has to be unique within a node only */
+START_TEST (test_markup_per_node)
+{
+	char sgf[] = "(;FF[4]SZ[5];B[aa]TR[aa][bb]SQ[aa]TR[bb];TR[aa][bb](;MA[aa]LB[aa:x][bb:y];TR[bb])(;MA[bb][bb]))";
+
+	CheckPosition(sgf, "(;FF[4]CA[UTF-8]GM[1]SZ[5];B[aa]TR[aa][bb];TR[aa][bb]\n(;MA[aa]LB[aa:x][bb:y];TR[bb])\n(;MA[bb]))\n");
+}
+END_TEST
+
+
 TCase *sgfc_tc_position(void)
 {
 	TCase *tc;
@@ -53,5 +213,12 @@ TCase *sgfc_tc_position(void)
 
 	tcase_add_test(tc, test_add_has_no_effect);
 	tcase_add_test(tc, test_add_effect_across_variations);
+	tcase_add_test(tc, test_capture_and_suicide);
+	tcase_add_test(tc, test_capture_in_variations);
+	tcase_add_test(tc, test_capture_board_sizes);
+	tcase_add_test(tc, test_markup_per_node);
+	tcase_add_test(tc, test_position_hashes);
+	tcase_add_test(tc, test_position_hashes_split_node);
+	tcase_add_test(tc, test_split_node_message_order);
 	return tc;
 }
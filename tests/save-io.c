@@ -0,0 +1,267 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 tests/save-io.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include "test-common.h"
+
+static char *saved;
+
+
+static int KeepOutputClose(struct SaveFileHandler *sfh, U_LONG error)
+{
+	ck_assert_uint_eq(error, E_NO_ERROR);
+	*sfh->fh.memh.pos = 0;
+	free(saved);
+	saved = SaveDupString(NULL, sfh->fh.memh.buffer, 0, "saved output");
+	return SaveBufferIO_close(sfh, error);
+}
+
+static struct SaveFileHandler *SetupBlockIO(void)
+{
+	return SetupSaveBufferIO(NULL, KeepOutputClose);
+}
+
+static int PutcIO_putc(struct SaveFileHandler *sfh, int c)
+{
+	struct MemoryIOHandle *m = &sfh->fh.memh;
+	size_t used = (size_t)(m->pos - m->buffer);
+	char *b;
+
+	if(used + 1 >= m->buffer_size)
+	{
+		if(!(b = realloc(m->buffer, m->buffer_size * 2)))
+			return EOF;
+		m->buffer = b;
+		m->pos = b + used;
+		m->buffer_size *= 2;
+	}
+	*m->pos++ = (char)c;
+	return c;
+}
+
+/* handler of an application that only knows about putc(): members
+ * after fh are left uninitialized and must not be used */
+static struct SaveFileHandler *SetupPutcIO(void)
+{
+	struct SaveFileHandler *sfh = malloc(sizeof(struct SaveFileHandler));
+	memset(sfh, 0xA5, sizeof(struct SaveFileHandler));
+	sfh->open = SaveBufferIO_open;
+	sfh->close = KeepOutputClose;
+	sfh->putc = PutcIO_putc;
+	return sfh;
+}
+
+/* saves with block IO, putc() only IO and exact size IO; returns output (to be freed) */
+static char *SaveBoth(const char *sgf, bool soft_linebreaks)
+{
+	char *block;
+
+	ResetSGFInfo(sgfc);
+	sgfc->buffer = SaveDupString(NULL, sgf, 0, "sgf buffer");
+	sgfc->b_end = sgfc->buffer + strlen(sgf);
+	sgfc->options->soft_linebreaks = soft_linebreaks;
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ck_assert_int_eq(ParseSGF(sgfc), true);
+
+	ck_assert_int_eq(SaveSGF(sgfc, SetupBlockIO, "block"), true);
+	block = saved;
+	saved = NULL;
+	ck_assert_int_eq(SaveSGF(sgfc, SetupPutcIO, "putc"), true);
+	ck_assert_str_eq(block, saved);
+	expected_output = block;
+	ck_assert_int_eq(SaveSGF(sgfc, SetupSaveExactSizeTestIO, "exact"), true);
+	expected_output = NULL;
+	free(saved);
+	saved = NULL;
+	free(sgfc->buffer);
+	sgfc->buffer = NULL;
+	return block;
+}
+
+
+START_TEST (test_save_putc_fallback)
+{
+	char *out = SaveBoth("(;GM[1]FF[4]SZ[19]GN[x]C[a\\]b\\\\c];B[aa]LB[bb:x\\:y](;W[cc])(;W[dd]))", true);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[19]\n\nGN[x]\n\nC[a\\]b\\\\c];B[aa]LB[bb:x\\:y]\n(;W[cc])\n(;W[dd]))\n");
+	free(out);
+}
+END_TEST
+
+
+START_TEST (test_save_long_values)
+{
+	/* values longer than the output buffer; runs have to stop at line length limits */
+	char sgf[30000], *s = sgf, *out, *line;
+	size_t len;
+
+	s += sprintf(s, "(;GM[1]FF[4]SZ[19]PB[");
+	for(int i = 0; i < 500; i++)
+		s += sprintf(s, "name%d ", i);
+	s += sprintf(s, "]C[");
+	for(int i = 0; i < 2000; i++)
+		s += sprintf(s, i % 7 ? "word%d " : "\xC3\xA4\\]%d", i);
+	s += sprintf(s, "])");
+
+	out = SaveBoth(sgf, true);
+	for(line = out; *line; line += len + 1)
+	{
+		len = strcspn(line, "\n");
+		ck_assert_uint_le(len, 80);		/* SimpleText and soft linebreaks */
+		if(!line[len])
+			break;
+	}
+	free(out);
+
+	out = SaveBoth(sgf, false);
+	ck_assert(strlen(out) > 20000);
+	ck_assert_ptr_eq(strstr(out, "\\\n"), NULL);
+	free(out);
+}
+END_TEST
+
+
+START_TEST (test_save_exact_size)
+{
+	/* compressed point lists have to come out the same in measuring pass */
+	char *out = SaveBoth("(;GM[1]FF[4]SZ[19]AB[aa][ab][ba][bb][cc]AW[dd:ff][dg]C[x];B[ss]\n(;W[aa])(;W[bb]))", false);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[19]AB[aa:bb][cc]AW[dd:ff][dg]C[x];B[ss]\n(;W[aa])\n(;W[bb]))\n");
+
+	/* second save: already compressed lists */
+	expected_output = out;
+	ck_assert_int_eq(SaveSGF(sgfc, SetupSaveExactSizeTestIO, "again"), true);
+	expected_output = NULL;
+
+	/* split files and header (keep_head) */
+	sgfc->options->split_file = true;
+	sgfc->options->keep_head = true;
+	ck_assert_int_eq(SaveSGF(sgfc, SetupSaveExactSizeTestIO, "split"), true);
+	free(out);
+}
+END_TEST
+
+
+START_TEST (test_save_to_buffer)
+{
+	char buffer[200];
+	size_t needed = 0;
+	char *out = SaveBoth("(;GM[1]FF[4]SZ[9]GN[buffer]C[a\\]b];B[aa](;W[bb])(;W[cc]))", true);
+	size_t len = strlen(out);
+
+	ck_assert_int_eq(SaveSGFToBuffer(sgfc, NULL, 0, &needed), false);
+	ck_assert_uint_eq(needed, len + 1);
+
+	memset(buffer, 'x', sizeof(buffer));
+	ck_assert_int_eq(SaveSGFToBuffer(sgfc, buffer, len, &needed), false);
+	ck_assert_uint_eq(needed, len + 1);
+	ck_assert_int_eq(buffer[0], 'x');		/* nothing written */
+
+	ck_assert_int_eq(SaveSGFToBuffer(sgfc, buffer, len + 1, &needed), true);
+	ck_assert_uint_eq(needed, len + 1);
+	ck_assert_str_eq(buffer, out);
+
+	/* split_file doesn't apply */
+	sgfc->options->split_file = true;
+	ck_assert_int_eq(SaveSGFToBuffer(sgfc, buffer, sizeof(buffer), NULL), true);
+	ck_assert_str_eq(buffer, out);
+	free(out);
+}
+END_TEST
+
+
+START_TEST (test_save_verbatim)
+{
+	const char *sgf = "(;FF[4]CA[UTF-8]GM[1]SZ[19]AP[x:1]\n  ;B[aa] ;W[bb] (;B[cc])(;B[dd]))\n"
+					  "(;FF[4]CA[UTF-8]GM[1]SZ[19]KM[ 5.5])\n"		/* corrected by ParseSGF */
+					  "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa] ] )\n"	/* error while loading */
+					  "(;FF[3]CA[UTF-8]GM[1];B[aa])";				/* FF[4] gets set */
+	struct TreeInfo *ti;
+	char *out;
+
+	sgfc->options->verbatim = true;
+	out = SaveBoth(sgf, true);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[19]AP[x:1]\n  ;B[aa] ;W[bb] (;B[cc])(;B[dd]))\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19]\n\nKM[5.5]\n\n)\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa])\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa])\n");
+	free(out);
+
+	ti = sgfc->tree;
+	ck_assert_int_eq(ti->modified, false);
+	ck_assert_int_eq(ti->next->modified, true);
+	ck_assert_ptr_eq(ti->next->next->source, NULL);
+	ck_assert_int_eq(ti->next->next->next->modified, true);	/* FF[4] set by SaveSGF */
+
+	sgfc->options->verbatim = false;
+	out = SaveBoth(sgf, true);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[19]AP[x:1];B[aa];W[bb]\n(;B[cc])\n(;B[dd]))\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19]\n\nKM[5.5]\n\n)\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa])\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa])\n");
+	free(out);
+}
+END_TEST
+
+
+START_TEST (test_save_verbatim_point_lists)
+{
+	const char *sgf = "(;FF[4]CA[UTF-8]GM[1]SZ[19] AB[aa:bb][cc] ;W[dd])\n"	/* expanded only */
+					  "(;FF[4]CA[UTF-8]GM[1]SZ[19]AB[aa:bb][ab])\n"		/* duplicate point */
+					  "(;FF[4]CA[UTF-8]GM[1]SZ[19]AB[bb:aa])";				/* corners swapped */
+	char *out;
+
+	sgfc->options->verbatim = true;
+	out = SaveBoth(sgf, true);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[19] AB[aa:bb][cc] ;W[dd])\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19]AB[aa:bb])\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[19]AB[aa:bb])\n");
+	free(out);
+
+	ck_assert_int_eq(sgfc->tree->modified, false);
+	ck_assert_int_eq(sgfc->tree->next->modified, true);
+}
+END_TEST
+
+
+START_TEST (test_save_verbatim_root_props)
+{
+	char *out;
+
+	sgfc->options->verbatim = true;
+	/* no CA[]: only copied if the other trees are copied as well */
+	out = SaveBoth("(;FF[4]GM[1]SZ[9] ;B[aa])\n(;FF[4]GM[1]SZ[9])", true);
+	ck_assert_str_eq(out, "(;FF[4]GM[1]SZ[9] ;B[aa])\n(;FF[4]GM[1]SZ[9])\n");
+	free(out);
+	out = SaveBoth("(;FF[4]GM[1]SZ[9] ;B[aa])\n(;FF[4]GM[1]SZ[9]KM[ 5.5])", true);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[9];B[aa])\n"
+						  "(;FF[4]CA[UTF-8]GM[1]SZ[9]\n\nKM[5.5]\n\n)\n");
+	free(out);
+
+	/* missing GM[1] or SZ[19] gets added */
+	out = SaveBoth("(;FF[4]CA[UTF-8]SZ[19] ;B[aa])\n(;FF[4]CA[UTF-8]GM[1] ;B[aa])", true);
+	ck_assert_str_eq(out, "(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa])\n(;FF[4]CA[UTF-8]GM[1]SZ[19];B[aa])\n");
+	free(out);
+}
+END_TEST
+
+
+TCase *sgfc_tc_save_io(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("save_io");
+	tcase_add_checked_fixture(tc, common_setup, common_teardown);
+
+	tcase_add_test(tc, test_save_putc_fallback);
+	tcase_add_test(tc, test_save_long_values);
+	tcase_add_test(tc, test_save_exact_size);
+	tcase_add_test(tc, test_save_to_buffer);
+	tcase_add_test(tc, test_save_verbatim);
+	tcase_add_test(tc, test_save_verbatim_point_lists);
+	tcase_add_test(tc, test_save_verbatim_root_props);
+	return tc;
+}
@@ -0,0 +1,181 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 tests/snapshot.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test-common.h"
+
+#define SNAPSHOT	"snapshot-test.snap"
+#define SNAPSHOT2	"snapshot-test2.snap"
+#define SGF_FILE	"snapshot-test.sgf"
+
+
+static struct SGFInfo *SetupQuiet(const char *option, const char *file)
+{
+	const char *argv[4] = {"sgfc", option, file, NULL};
+	struct SGFInfo *s = SetupSGFInfo(NULL);
+
+	s->print_error_output_hook = NULL;	/* count messages, but print nothing */
+	ck_assert(ParseArgs(s, 3, argv));
+	return s;
+}
+
+static char *SavedOutput(struct SGFInfo *s)
+{
+	size_t size;
+	char *out;
+
+	SaveSGFToBuffer(s, NULL, 0, &size);
+	out = malloc(size);
+	ck_assert(SaveSGFToBuffer(s, out, size, NULL));
+	return out;
+}
+
+static void WriteFile(const char *name, const char *buffer, size_t len)
+{
+	FILE *file = fopen(name, "wb");
+
+	ck_assert_ptr_ne(file, NULL);
+	ck_assert_uint_eq(fwrite(buffer, 1, len, file), len);
+	fclose(file);
+}
+
+/* both trees (incl. siblings) have the same shape & position hashes */
+static void SameHashes(const struct Node *a, const struct Node *b)
+{
+	for(; a && b; a = a->sibling, b = b->sibling)
+	{
+		ck_assert(a->hash == b->hash);
+		SameHashes(a->child, b->child);
+	}
+	ck_assert(!a && !b);
+}
+
+/* saved SGF of snapshot equals saved SGF of text file */
+static void RoundTrip(const char *option, const char *file)
+{
+	struct SGFInfo *text = SetupQuiet(option, file), *snap = SetupQuiet(option, SNAPSHOT);
+	char *expected, *out, *a = NULL, *b = NULL;
+	size_t len_a, len_b;
+	FILE *in;
+
+	ck_assert(LoadSGF(text, file));
+	ck_assert(ParseSGF(text));
+	ck_assert(SaveSnapshot(text, SNAPSHOT));
+	expected = SavedOutput(text);
+
+	ck_assert(LoadSnapshot(snap, SNAPSHOT));
+	ck_assert_int_eq(snap->error_count, text->error_count);
+	ck_assert_int_eq(snap->critical_count, text->critical_count);
+	ck_assert_int_eq(snap->warning_count, text->warning_count);
+	SameHashes(snap->root, text->root);
+
+	/* snapshot of loaded snapshot is the same (SaveSGF() adds properties) */
+	ck_assert(SaveSnapshot(snap, SNAPSHOT2));
+	ck_assert_ptr_ne(in = fopen(SNAPSHOT, "rb"), NULL);
+	len_a = AppendFile(&a, 0, in);
+	fclose(in);
+	ck_assert_ptr_ne(in = fopen(SNAPSHOT2, "rb"), NULL);
+	len_b = AppendFile(&b, 0, in);
+	fclose(in);
+	ck_assert_uint_eq(len_a, len_b);
+	ck_assert(!memcmp(a, b, len_a));
+
+	out = SavedOutput(snap);
+	ck_assert_str_eq(out, expected);
+
+	free(a);
+	free(b);
+	free(expected);
+	free(out);
+	FreeSGFInfo(text);
+	FreeSGFInfo(snap);
+	remove(SNAPSHOT);
+	remove(SNAPSHOT2);
+}
+
+
+START_TEST (test_snapshot_round_trip)
+{
+	RoundTrip("-c", "../test-files/test.sgf");
+	RoundTrip("-ck", "../test-files/test.sgf");
+	RoundTrip("-cr", "../test-files/strict.sgf");
+	RoundTrip("-cz", "../test-files/reorder.sgf");
+	RoundTrip("-ctE2", "../test-files/escaping.sgf");
+	RoundTrip("-cekE2", "../test-files/mixed-encoding.sgf");
+}
+END_TEST
+
+
+START_TEST (test_snapshot_corrected_values)
+{
+	/* values replaced by ParseSGF(): FG[fig] -> FG[0:fig], SZ[9:9] -> SZ[9] */
+	const char *sgf = "(;FF[4]GM[1]SZ[9:9]FG[fig];B[aa]FG[x3:three];W[bb]AB[cc:cc])";
+
+	WriteFile(SGF_FILE, sgf, strlen(sgf));
+	RoundTrip("-c", SGF_FILE);
+	remove(SGF_FILE);
+}
+END_TEST
+
+
+START_TEST (test_snapshot_corrupt)
+{
+	struct SGFInfo *s = SetupQuiet("-c", "../test-files/test.sgf");
+	char *snap = NULL;
+	size_t len;
+	FILE *file;
+
+	ck_assert(LoadSGF(s, "../test-files/test.sgf"));
+	ck_assert(ParseSGF(s));
+	ck_assert(SaveSnapshot(s, SNAPSHOT));
+	FreeSGFInfo(s);
+	ck_assert_ptr_ne(file = fopen(SNAPSHOT, "rb"), NULL);
+	len = AppendFile(&snap, 0, file);
+	fclose(file);
+
+	s = SetupQuiet("-c", SNAPSHOT);				/* SGF file instead of snapshot */
+	ck_assert(!LoadSnapshot(s, "../test-files/test.sgf"));
+	FreeSGFInfo(s);
+
+	snap[len / 2] ^= 0x20;						/* checksum mismatch */
+	WriteFile(SNAPSHOT, snap, len);
+	s = SetupQuiet("-c", SNAPSHOT);
+	ck_assert(!LoadSnapshot(s, SNAPSHOT));
+	FreeSGFInfo(s);
+
+	snap[len / 2] ^= 0x20;						/* truncated */
+	WriteFile(SNAPSHOT, snap, len - 8);
+	s = SetupQuiet("-c", SNAPSHOT);
+	ck_assert(!LoadSnapshot(s, SNAPSHOT));
+	FreeSGFInfo(s);
+
+	snap[8]++;									/* other version */
+	WriteFile(SNAPSHOT, snap, len);
+	s = SetupQuiet("-c", SNAPSHOT);
+	ck_assert(!LoadSnapshot(s, SNAPSHOT));
+	FreeSGFInfo(s);
+
+	free(snap);
+	remove(SNAPSHOT);
+}
+END_TEST
+
+
+TCase *sgfc_tc_snapshot(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("snapshot");
+	tcase_add_test(tc, test_snapshot_round_trip);
+	tcase_add_test(tc, test_snapshot_corrected_values);
+	tcase_add_test(tc, test_snapshot_corrupt);
+	return tc;
+}
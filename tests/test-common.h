@@ -10,6 +10,7 @@
 #ifndef TEST_COMMON_H_
 #define TEST_COMMON_H_
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <check.h>
 
@@ -22,6 +23,8 @@ extern struct SGFInfo *sgfc;
 extern char *expected_output;
 
 struct SaveFileHandler *SetupSaveTestIO(void);
+struct SaveFileHandler *SetupSaveExactSizeTestIO(void);
+size_t AppendFile(char **buffer, size_t len, FILE *file);
 void common_setup(void);
 void common_teardown(void);
 
@@ -16,13 +16,13 @@ static char *ReadTestFile(const char *path, size_t *length)
 	FILE *file = fopen(path, "rb");
 	ck_assert_msg(!!file, "could not open file %s", path);
 	/* being lazy: we know that all files are smaller than 10000 bytes */
-	char *buffer = SaveMalloc(10000, "test file buffer");
+	char *buffer = SaveMalloc(NULL, 10000, "test file buffer");
 	*length = fread(buffer, 1, 10000, file);
 	fclose(file);
 	return buffer;
 }
 
-static void FileTestOutput(struct SGFCError *error)
+static void FileTestOutput(struct SGFInfo *sgfc, struct SGFCError *error)
 {
 	CommonPrintErrorOutputHook(error, testout);
 }
@@ -31,14 +31,13 @@ static void FileTestSetup(void)
 {
 	sgfc = SetupSGFInfo(NULL);
 	testout = tmpfile();
-	print_error_output_hook = FileTestOutput;
+	sgfc->print_error_output_hook = FileTestOutput;
 }
 
 static void FileTestTeardown(void)
 {
 	FreeSGFInfo(sgfc);
 	fclose(testout);
-	print_error_output_hook = PrintErrorOutputHook;
 }
 
 static void TestWithFile(const char *path, const char *expected, char *output)
@@ -60,7 +59,7 @@ static void TestWithFile(const char *path, const char *expected, char *output)
 	*(expected_output+explen) = 0;
 	size_t actual_size = (size_t)ftell(testout);
 	ck_assert_uint_gt(actual_size, explen - 70); /* longest summary line ~63 bytes */
-	char *outbuf = SaveMalloc(actual_size, "stdout buffer");
+	char *outbuf = SaveMalloc(NULL, actual_size, "stdout buffer");
 	ck_assert_int_ne(-1, fseek(testout, 0, SEEK_SET));
 	ck_assert_uint_eq(actual_size, fread(outbuf, 1, actual_size, testout));
 	/* by only comparing up to actual_size we do not compare summary line */
@@ -143,6 +142,46 @@ START_TEST (test_escaping_sgf)
 END_TEST
 
 
+START_TEST (test_reset_sgfinfo)
+{
+	sgfc->options->soft_linebreaks = false;
+	TestWithFile("../test-files/escaping.sgf",
+			     "../test-files/escaping-result.sgf",
+			     "../test-files/escaping-output.txt");
+	ResetSGFInfo(sgfc);
+	sgfc->options->soft_linebreaks = true;
+	fclose(testout);
+	testout = tmpfile();
+	TestWithFile("../test-files/test.sgf",
+			     "../test-files/test-result.sgf",
+			     "../test-files/test-output.txt");
+}
+END_TEST
+
+
+START_TEST (test_keep_head)
+{
+	const char *path = "keep-head-test.sgf";
+	FILE *file = fopen(path, "wb");
+	ck_assert_msg(!!file, "could not create file %s", path);
+	fputs("Header \xc3\xa4\n(;FF[4]C[\xc3\xa4])", file);
+	fclose(file);
+
+	sgfc->options->keep_head = true;
+	sgfc->options->forced_encoding = "UTF-8";
+	int ret = LoadSGF(sgfc, path);
+	remove(path);
+	ck_assert_int_eq(ret, true);
+	ParseSGF(sgfc);
+
+	expected_output = "Header \xc3\xa4\n\n(;FF[4]CA[UTF-8]GM[1]SZ[19]AP[SGFC:2.0]C[\xc3\xa4])\n";
+	ret = SaveSGF(sgfc, SetupSaveTestIO, "outfile");
+	ck_assert_int_eq(ret, true);
+	expected_output = NULL;
+}
+END_TEST
+
+
 TCase *sgfc_tc_test_files(void)
 {
 	TCase *tc;
@@ -157,5 +196,7 @@ TCase *sgfc_tc_test_files(void)
 	tcase_add_test(tc, test_reverse_reorder_sgf);
 	tcase_add_test(tc, test_mixed_encoding_sgf);
 	tcase_add_test(tc, test_escaping_sgf);
+	tcase_add_test(tc, test_reset_sgfinfo);
+	tcase_add_test(tc, test_keep_head);
 	return tc;
 }
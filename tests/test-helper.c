@@ -21,17 +21,47 @@ int Test_BufferIO_Close(struct SaveFileHandler *sfh, U_LONG error)
 	return SaveBufferIO_close(sfh, E_NO_ERROR);
 }
 
+/* appends whole file to buffer (realloc) and 0-terminates it; returns new length */
+size_t AppendFile(char **buffer, size_t len, FILE *file)
+{
+	long size;
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	rewind(file);
+	*buffer = realloc(*buffer, len + (size_t)size + 1);
+	len += fread(*buffer + len, 1, (size_t)size, file);
+	(*buffer)[len] = 0;
+	return len;
+}
+
+/* measuring pass of SaveSGF() has to be exact */
+int Test_ExactSizeIO_Close(struct SaveFileHandler *sfh, U_LONG error)
+{
+	ck_assert_uint_ne(sfh->size_hint, 0);
+	ck_assert_uint_eq(sfh->fh.memh.pos - sfh->fh.memh.buffer, sfh->size_hint);
+	ck_assert_uint_eq(sfh->fh.memh.buffer_size, sfh->size_hint + 1);
+	return Test_BufferIO_Close(sfh, error);
+}
+
 struct SaveFileHandler *SetupSaveTestIO(void)
 {
 	return SetupSaveBufferIO(SaveBufferIO_open, Test_BufferIO_Close);
 }
 
+struct SaveFileHandler *SetupSaveExactSizeTestIO(void)
+{
+	struct SaveFileHandler *sfh = SetupSaveBufferIO(SaveBufferIO_open, Test_ExactSizeIO_Close);
+	sfh->exact_size = true;
+	return sfh;
+}
+
 void common_setup(void)
 {
 	sgfc = SetupSGFInfo(NULL);
 	sgfc->options->add_sgfc_ap_property = false;
 	/* run tests without PrintError (makes setup easier) */
-	print_error_handler = NULL;
+	sgfc->print_error_handler = NULL;
 }
 
 void common_teardown(void)
@@ -39,5 +69,4 @@ void common_teardown(void)
 	/* buffer is assumed to be string literal, hence free() must not be called */
 	sgfc->buffer = NULL;
 	FreeSGFInfo(sgfc);
-	print_error_handler = PrintErrorHandler;
 }
@@ -10,15 +10,20 @@
 #include <stdlib.h>
 #include <check.h>
 
+TCase *sgfc_tc_batch(void);
 TCase *sgfc_tc_check_value(void);
 TCase *sgfc_tc_delete_node(void);
 TCase *sgfc_tc_encoding(void);
 TCase *sgfc_tc_load_properties(void);
 TCase *sgfc_tc_options(void);
 TCase *sgfc_tc_other_games(void);
+TCase *sgfc_tc_parallel(void);
 TCase *sgfc_tc_parse_text(void);
 TCase *sgfc_tc_position(void);
+TCase *sgfc_tc_save_io(void);
+TCase *sgfc_tc_snapshot(void);
 TCase *sgfc_tc_test_files(void);
+TCase *sgfc_tc_threads(void);
 TCase *sgfc_tc_trigger_errors(void);
 TCase *sgfc_tc_value_length(void);
 
@@ -26,15 +31,20 @@ TCase *sgfc_tc_value_length(void);
 Suite *sgfc_suite(void)
 {
 	Suite *s = suite_create("SGFC");
+	suite_add_tcase(s, sgfc_tc_batch());
 	suite_add_tcase(s, sgfc_tc_check_value());
 	suite_add_tcase(s, sgfc_tc_delete_node());
 	suite_add_tcase(s, sgfc_tc_encoding());
 	suite_add_tcase(s, sgfc_tc_load_properties());
 	suite_add_tcase(s, sgfc_tc_options());
 	suite_add_tcase(s, sgfc_tc_other_games());
+	suite_add_tcase(s, sgfc_tc_parallel());
 	suite_add_tcase(s, sgfc_tc_parse_text());
 	suite_add_tcase(s, sgfc_tc_position());
+	suite_add_tcase(s, sgfc_tc_save_io());
+	suite_add_tcase(s, sgfc_tc_snapshot());
 	suite_add_tcase(s, sgfc_tc_test_files());
+	suite_add_tcase(s, sgfc_tc_threads());
 	suite_add_tcase(s, sgfc_tc_trigger_errors());
 	suite_add_tcase(s, sgfc_tc_value_length());
 	return s;
@@ -0,0 +1,119 @@
+/**************************************************************************
+*** Project: SGF Syntax Checker & Converter
+***	File:	 tests/threads.c
+***
+*** Copyright (C) 1996-2021 by Arno Hollosi
+*** (see 'main.c' for more copyright information)
+***
+**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "test-common.h"
+
+#define NUM_THREADS	16
+#define NUM_ROUNDS	8
+#define NUM_JOBS	7
+
+/* same calls as 'make test-files' */
+static const char *jobs[NUM_JOBS][3] =
+{
+	{"-c",		"../test-files/test.sgf",			"threads-%02d.sgf"},
+	{"-roun",	"../test-files/test.sgf",			"threads-%02d.sgf"},
+	{"-rc",		"../test-files/strict.sgf",			"threads-%02d.sgf"},
+	{"-v",		"../test-files/reorder.sgf",		"threads-%02d.sgf"},
+	{"-vz",		"../test-files/reorder.sgf",		"threads-%02d.sgf"},
+	{"-ct",		"../test-files/escaping.sgf",		"threads-%02d.sgf"},
+	{"-cE2",	"../test-files/mixed-encoding.sgf",	"threads-%02d.sgf"},
+};
+
+static char *expected[NUM_JOBS];
+static char *results[NUM_THREADS][NUM_ROUNDS];
+
+
+static void ThreadTestOutput(struct SGFInfo *sgfc, struct SGFCError *error)
+{
+	CommonPrintErrorOutputHook(error, sgfc->user_data);
+}
+
+/* like main(): messages, status line, and saved file in one buffer */
+static char *RunJob(int job, int thread)
+{
+	char outfile[32], *buffer = NULL;
+	const char *argv[4] = {"sgfc", jobs[job][0], jobs[job][1], outfile};
+	struct SGFInfo *s = SetupSGFInfo(NULL);
+	FILE *out = tmpfile(), *saved;
+	size_t len = 0;
+
+	sprintf(outfile, jobs[job][2], thread);
+	s->options->add_sgfc_ap_property = false;
+	s->print_error_output_hook = ThreadTestOutput;
+	s->user_data = out;
+
+	if(ParseArgs(s, 4, argv) && LoadSGF(s, s->options->infile) && ParseSGF(s))
+	{
+		if(s->options->write_critical || !s->critical_count)
+			SaveSGF(s, SetupSaveFileIO, s->options->outfile);
+		PrintStatusLine(s, out);
+	}
+	FreeSGFInfo(s);
+
+	len = AppendFile(&buffer, len, out);
+	fclose(out);
+	if((saved = fopen(outfile, "rb")))
+	{
+		AppendFile(&buffer, len, saved);
+		fclose(saved);
+		remove(outfile);
+	}
+	return buffer;
+}
+
+static void *StressThread(void *arg)
+{
+	int thread = (int)(size_t)arg;
+
+	for(int round = 0; round < NUM_ROUNDS; round++)
+		results[thread][round] = RunJob((thread + round) % NUM_JOBS, thread);
+	return NULL;
+}
+
+
+START_TEST (test_concurrent_instances)
+{
+	pthread_t threads[NUM_THREADS];
+	int i, round;
+
+	for(i = 0; i < NUM_JOBS; i++)				/* single-threaded reference */
+	{
+		expected[i] = RunJob(i, 0);
+		ck_assert_ptr_ne(strstr(expected[i], jobs[i][1]), NULL);
+	}
+
+	for(i = 0; i < NUM_THREADS; i++)
+		ck_assert_int_eq(pthread_create(&threads[i], NULL, StressThread, (void *)(size_t)i), 0);
+	for(i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	for(i = 0; i < NUM_THREADS; i++)
+		for(round = 0; round < NUM_ROUNDS; round++)
+		{
+			ck_assert_str_eq(results[i][round], expected[(i + round) % NUM_JOBS]);
+			free(results[i][round]);
+		}
+	for(i = 0; i < NUM_JOBS; i++)
+		free(expected[i]);
+}
+END_TEST
+
+
+TCase *sgfc_tc_threads(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("threads");
+	tcase_add_test(tc, test_concurrent_instances);
+	return tc;
+}
@@ -30,7 +30,7 @@ static bool mock_error_handler(U_LONG type, struct SGFInfo *sgfi, va_list arglis
 static void setup(void)
 {
 	common_setup();
-	print_error_handler = mock_error_handler;
+	sgfc->print_error_handler = mock_error_handler;
 	expected_error_occurred = false;
 	allowed_error = E_NO_ERROR;
 }
@@ -21,14 +21,16 @@ void VerifyTreeValueLength(struct Node *n, int phase)
 			struct PropValue *v = p->value;
 			while(v)
 			{
+				U_LONG row, col;
+				ResolvePosition(sgfc, v->pos, &row, &col);
 				/* brittle test: row=22, col=2: prop value with \00 byte, still present after load */
-				ck_assert_msg(strlen(v->value) == v->value_len || (phase == 1 && v->row == 22 && v->col == 2),
+				ck_assert_msg(strlen(v->value) == v->value_len || (phase == 1 && row == 22 && col == 2),
 				  			  "phase %d: %s_v1 at %ld:%ld, strlen=%ld != value_len=%ld",
-				   			  phase, p->idstr, v->row, v->col, strlen(v->value), v->value_len);
+				   			  phase, p->idstr, row, col, strlen(v->value), v->value_len);
 				if(v->value2)
 					ck_assert_msg(strlen(v->value2) == v->value2_len,
 								  "phase %d: %s_v2 at %ld:%ld, strlen=%ld != value_len=%ld",
-								  phase, p->idstr, v->row, v->col, strlen(v->value2), v->value2_len);
+								  phase, p->idstr, row, col, strlen(v->value2), v->value2_len);
 				v = v->next;
 			}
 			p = p->next;
@@ -47,7 +49,19 @@ START_TEST (test_length_with_test_sgf)
 
 	ParseSGF(sgfc);
 	VerifyTreeValueLength(sgfc->root, 2);
-	free(sgfc->buffer);		/* common_teardown doesn't free buffer */
+	FreeSGFBuffer(sgfc);	/* common_teardown doesn't free buffer */
+}
+END_TEST
+
+START_TEST (test_length_with_corrected_values)
+{
+	char sgf[] = "(;FF[4]GM[1]SZ[9:9]FG[fig];B[aa]FG[x3:three]AB[cc:cc];W[bb]FG[x:y])";
+
+	sgfc->buffer = sgf;
+	sgfc->b_end = sgf + strlen(sgf);
+	ck_assert_int_eq(LoadSGFFromFileBuffer(sgfc), true);
+	ck_assert_int_eq(ParseSGF(sgfc), true);
+	VerifyTreeValueLength(sgfc->root, 2);
 }
 END_TEST
 
@@ -60,5 +74,6 @@ TCase *sgfc_tc_value_length(void)
 	tcase_add_checked_fixture(tc, common_setup, common_teardown);
 
 	tcase_add_test(tc, test_length_with_test_sgf);
+	tcase_add_test(tc, test_length_with_corrected_values);
 	return tc;
 }